@@ -1,6 +1,7 @@
 #pragma once
 
 #include "GameObject.hpp"
+#include <cmath>
 
 class BallObject : public GameObject
 {
@@ -17,35 +18,28 @@ public:
 		
 	}
 
-	//Move ball
-	void Move(float dt, float window_width)
+	//Keep the ball inside the window (left, right and top wall), the movement itself is done by Game with continuous collision
+	void BounceOffWindow(float window_width)
 	{
-		if (!_stuck)
+		//Left
+		if (_position.x <= 0.0f)
 		{
-			//Move the ball
-			_position += _velocity * dt;
+			_velocity.x = std::abs(_velocity.x);
+			_position.x = 0.0f;
+		}
 
-			//Check window bounds		
-			//Left
-			if (_position.x <= 0.0f)
-			{
-				_velocity.x = -_velocity.x;
-				_position.x = 0.0f;
-			}
-
-			//Right
-			if (_position.x + _size.x >= window_width)
-			{
-				_velocity.x = -_velocity.x;
-				_position.x = window_width - _size.x;
-			}
+		//Right
+		if (_position.x + _size.x >= window_width)
+		{
+			_velocity.x = -std::abs(_velocity.x);
+			_position.x = window_width - _size.x;
+		}
 
-			//Top
-			if (_position.y <= 0.0f)
-			{
-				_velocity.y = -_velocity.y;
-				_position.y = 0.0f;
-			}
-		}		
+		//Top
+		if (_position.y <= 0.0f)
+		{
+			_velocity.y = std::abs(_velocity.y);
+			_position.y = 0.0f;
+		}
 	}
 };
\ No newline at end of file
@@ -0,0 +1,327 @@
+#pragma once
+
+#include "BrickStore.hpp"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+//Earliest contact of a moving circle along its displacement
+struct SweepHit
+{
+	float _time = 1.0f; //Fraction of the displacement until the contact
+	glm::vec2 _normal = glm::vec2(0.0f); //Points from the box towards the circle
+	int _brick = -1;
+};
+
+//Continuous circle vs box test: the circle moves from center to center + displacement
+//Returns false if it doesn't touch the box on the way (or already overlaps it and moves away from it)
+static bool sweepCircleBox(const glm::vec2& center, const glm::vec2& displacement, float radius, const glm::vec2& boxMin, const glm::vec2& boxMax, float& time, glm::vec2& normal)
+{
+	//Already overlapping -> contact right away, unless the circle is on its way out
+	const glm::vec2 closest = glm::clamp(center, boxMin, boxMax);
+	const glm::vec2 offset = center - closest;
+	const float distance2 = glm::dot(offset, offset);
+	if (distance2 < radius * radius)
+	{
+		if (distance2 > 1e-8f)
+			normal = offset / std::sqrt(distance2);
+		else
+		{
+			//Center inside the box -> out through the nearest side
+			const glm::vec2 toMin = center - boxMin, toMax = boxMax - center;
+			const float side = std::min(std::min(toMin.x, toMax.x), std::min(toMin.y, toMax.y));
+			if (side == toMin.x)
+				normal = glm::vec2(-1.0f, 0.0f);
+			else if (side == toMax.x)
+				normal = glm::vec2(1.0f, 0.0f);
+			else if (side == toMin.y)
+				normal = glm::vec2(0.0f, -1.0f);
+			else
+				normal = glm::vec2(0.0f, 1.0f);
+		}
+
+		time = 0.0f;
+		return glm::dot(displacement, normal) < 0.0f;
+	}
+
+	//Ray against the box grown by the radius (slab test)
+	const glm::vec2 grownMin = boxMin - radius, grownMax = boxMax + radius;
+	float enter = 0.0f, exit = 1.0f;
+	int enterAxis = -1;
+	for (int axis = 0; axis < 2; axis++)
+	{
+		if (std::abs(displacement[axis]) < 1e-8f)
+		{
+			if (center[axis] < grownMin[axis] || center[axis] > grownMax[axis])
+				return false;
+			continue;
+		}
+
+		const float inverse = 1.0f / displacement[axis];
+		float t0 = (grownMin[axis] - center[axis]) * inverse;
+		float t1 = (grownMax[axis] - center[axis]) * inverse;
+		if (t0 > t1)
+			std::swap(t0, t1);
+
+		if (t0 > enter)
+		{
+			enter = t0;
+			enterAxis = axis;
+		}
+		exit = std::min(exit, t1);
+		if (enter > exit)
+			return false;
+	}
+
+	if (enterAxis < 0)
+		return false;
+
+	//Hit on a side of the grown box -> flat side of the real box
+	const glm::vec2 point = center + displacement * enter;
+	const int otherAxis = 1 - enterAxis;
+	if (point[otherAxis] >= boxMin[otherAxis] && point[otherAxis] <= boxMax[otherAxis])
+	{
+		time = enter;
+		normal = glm::vec2(0.0f);
+		normal[enterAxis] = displacement[enterAxis] > 0.0f ? -1.0f : 1.0f;
+		return true;
+	}
+
+	//Hit in a rounded corner -> ray against the circle around the corner
+	const glm::vec2 corner = glm::clamp(point, boxMin, boxMax);
+	const glm::vec2 relative = center - corner;
+	const float a = glm::dot(displacement, displacement);
+	const float b = glm::dot(relative, displacement);
+	const float c = glm::dot(relative, relative) - radius * radius;
+	const float discriminant = b * b - a * c;
+	if (discriminant < 0.0f)
+		return false;
+
+	const float t = (-b - std::sqrt(discriminant)) / a;
+	if (t < 0.0f || t > 1.0f)
+		return false;
+
+	time = t;
+	normal = (relative + displacement * t) / radius;
+	return true;
+}
+
+//Static uniform grid over the bricks of a level -> a moving ball only gets tested against the bricks near the cells its center passes
+//Each cell lists the bricks that overlap it (one array for all cells, an offset per cell), destroyed bricks stay in the grid and get skipped
+//The bricks of a visited cell and its neighbours first go through the 8-wide circle test of the BrickStore (circle around the whole movement), only the ones inside get swept exactly
+class BrickGrid
+{
+private:
+	glm::vec2 _origin = glm::vec2(0.0f), _cellSize = glm::vec2(1.0f);
+	int _columns = 0, _rows = 0;
+	std::vector<unsigned int> _cellStart; //_columns * _rows + 1 offsets into _cellBricks
+	std::vector<unsigned int> _cellBricks;
+
+	//Bricks tested by the current query (a brick can be in several of the visited cells)
+	std::vector<unsigned int> _brickStamps;
+	unsigned int _stamp = 0;
+
+	unsigned int _brickTests = 0;
+
+	//Candidates of the current query and the ones that passed the circle test
+	std::vector<unsigned int> _candidates, _overlapping;
+
+	//Exact sweeps of the candidates that overlap the circle around the whole movement (8 at a time)
+	void testCandidates(const BrickStore& bricks, const glm::vec2& center, const glm::vec2& displacement, float radius, SweepHit& hit)
+	{
+		if (_candidates.empty())
+			return;
+
+		_brickTests += (unsigned int)_candidates.size();
+		_overlapping.resize(_candidates.size());
+		const float halfLength = 0.5f * glm::length(displacement);
+		unsigned int count = bricks.overlapCircle(&_candidates[0], (unsigned int)_candidates.size(), center + 0.5f * displacement, radius + halfLength, &_overlapping[0]);
+		for (unsigned int i = 0; i < count; i++)
+			sweepBrick(bricks, _overlapping[i], center, displacement, radius, hit);
+		_candidates.clear();
+	}
+
+	static void sweepBrick(const BrickStore& bricks, unsigned int index, const glm::vec2& center, const glm::vec2& displacement, float radius, SweepHit& hit)
+	{
+		float time;
+		glm::vec2 normal;
+		const glm::vec2 position = bricks.getPosition(index);
+		if (sweepCircleBox(center, displacement, radius, position, position + bricks.getSize(index), time, normal) && time < hit._time)
+		{
+			hit._time = time;
+			hit._normal = normal;
+			hit._brick = (int)index;
+		}
+	}
+
+public:
+	//Cell size = the biggest brick -> a brick overlaps at most 4 cells
+	void build(const BrickStore& bricks)
+	{
+		_columns = _rows = 0;
+		_cellStart.assign(1, 0);
+		_cellBricks.clear();
+		_brickStamps.assign(bricks.getCount(), 0);
+		if (bricks.getCount() == 0)
+			return;
+
+		glm::vec2 min(bricks.getPosition(0)), max(bricks.getPosition(0) + bricks.getSize(0));
+		_cellSize = glm::vec2(0.0f);
+		for (unsigned int index = 0; index < bricks.getCount(); index++)
+		{
+			min = glm::min(min, bricks.getPosition(index));
+			max = glm::max(max, bricks.getPosition(index) + bricks.getSize(index));
+			_cellSize = glm::max(_cellSize, bricks.getSize(index));
+		}
+		_cellSize = glm::max(_cellSize, glm::vec2(1.0f));
+		_origin = min;
+		_columns = std::max(1, (int)std::ceil((max.x - min.x) / _cellSize.x));
+		_rows = std::max(1, (int)std::ceil((max.y - min.y) / _cellSize.y));
+
+		//Count the bricks per cell, prefix sum, then fill
+		_cellStart.assign(_columns * _rows + 1, 0);
+		for (int pass = 0; pass < 2; pass++)
+		{
+			std::vector<unsigned int> fill(_cellStart.begin(), _cellStart.end() - 1);
+			for (unsigned int index = 0; index < bricks.getCount(); index++)
+			{
+				const glm::vec2 position = bricks.getPosition(index);
+				const glm::ivec2 first = glm::clamp(glm::ivec2(glm::floor((position - _origin) / _cellSize)), glm::ivec2(0), glm::ivec2(_columns - 1, _rows - 1));
+				const glm::ivec2 last = glm::clamp(glm::ivec2(glm::ceil((position + bricks.getSize(index) - _origin) / _cellSize)) - 1, first, glm::ivec2(_columns - 1, _rows - 1));
+				for (int y = first.y; y <= last.y; y++)
+				{
+					for (int x = first.x; x <= last.x; x++)
+					{
+						if (pass == 0)
+							_cellStart[y * _columns + x + 1]++;
+						else
+							_cellBricks[fill[y * _columns + x]++] = index;
+					}
+				}
+			}
+
+			if (pass == 0)
+			{
+				for (unsigned int cell = 0; cell < (unsigned int)(_columns * _rows); cell++)
+					_cellStart[cell + 1] += _cellStart[cell];
+				_cellBricks.resize(_cellStart.back());
+			}
+		}
+	}
+
+	//Earliest brick the circle touches on its way from center to center + displacement
+	//Walks the cells of the center line (DDA) in order and tests the bricks of the cells around each one
+	bool sweep(const BrickStore& bricks, const glm::vec2& center, const glm::vec2& displacement, float radius, SweepHit& hit)
+	{
+		hit = SweepHit();
+		if (_columns == 0)
+			return false;
+
+		//Cells around the visited one that the circle can reach
+		const glm::ivec2 reach = glm::ivec2(glm::ceil(glm::vec2(radius) / _cellSize));
+
+		//Clip the center line to the grid grown by the reach -> nothing to do for a ball below the bricks
+		const glm::vec2 gridMin = _origin - glm::vec2(reach) * _cellSize;
+		const glm::vec2 gridMax = _origin + glm::vec2(_columns + reach.x, _rows + reach.y) * _cellSize;
+		float enter = 0.0f, exit = 1.0f;
+		for (int axis = 0; axis < 2; axis++)
+		{
+			if (std::abs(displacement[axis]) < 1e-8f)
+			{
+				if (center[axis] < gridMin[axis] || center[axis] > gridMax[axis])
+					return false;
+				continue;
+			}
+
+			float t0 = (gridMin[axis] - center[axis]) / displacement[axis];
+			float t1 = (gridMax[axis] - center[axis]) / displacement[axis];
+			if (t0 > t1)
+				std::swap(t0, t1);
+			enter = std::max(enter, t0);
+			exit = std::min(exit, t1);
+		}
+		if (enter > exit)
+			return false;
+
+		if (++_stamp == 0)
+		{
+			std::fill(_brickStamps.begin(), _brickStamps.end(), 0);
+			_stamp = 1;
+		}
+
+		//DDA setup (Amanatides & Woo)
+		const glm::vec2 start = (center + displacement * enter - _origin) / _cellSize;
+		glm::ivec2 cell = glm::ivec2(glm::floor(start));
+		const glm::ivec2 step(displacement.x >= 0.0f ? 1 : -1, displacement.y >= 0.0f ? 1 : -1);
+		glm::vec2 next, delta;
+		for (int axis = 0; axis < 2; axis++)
+		{
+			const float cellsPerStep = displacement[axis] / _cellSize[axis];
+			if (std::abs(cellsPerStep) < 1e-8f)
+			{
+				next[axis] = 2.0f;
+				delta[axis] = 2.0f;
+				continue;
+			}
+
+			const float boundary = (float)(step[axis] > 0 ? cell[axis] + 1 : cell[axis]);
+			next[axis] = enter + (boundary - start[axis]) / cellsPerStep;
+			delta[axis] = std::abs(1.0f / cellsPerStep);
+		}
+
+		//The circle touches a brick while its center is within reach of it -> a brick of a later cell can't be hit before that cell gets entered
+		//-> stop once the best hit is earlier than the next cell
+		float cellEnter = enter;
+		while (cellEnter <= exit && cellEnter <= hit._time)
+		{
+			const int minX = std::max(cell.x - reach.x, 0), maxX = std::min(cell.x + reach.x, _columns - 1);
+			const int minY = std::max(cell.y - reach.y, 0), maxY = std::min(cell.y + reach.y, _rows - 1);
+			for (int y = minY; y <= maxY; y++)
+			{
+				for (int x = minX; x <= maxX; x++)
+				{
+					//Live bricks of the cell that weren't tested by this query yet
+					const unsigned int cellIndex = y * _columns + x;
+					for (unsigned int i = _cellStart[cellIndex]; i < _cellStart[cellIndex + 1]; i++)
+					{
+						const unsigned int index = _cellBricks[i];
+						if (_brickStamps[index] != _stamp && !bricks.isDestroyed(index))
+							_candidates.push_back(index);
+						_brickStamps[index] = _stamp;
+					}
+				}
+			}
+			testCandidates(bricks, center, displacement, radius, hit);
+
+			//Next cell along the line
+			const int axis = next.x < next.y ? 0 : 1;
+			cellEnter = next[axis];
+			next[axis] += delta[axis];
+			cell[axis] += step[axis];
+		}
+
+		return hit._brick >= 0;
+	}
+
+	//Same result as sweep() by testing every live brick -> the cost the grid saves
+	bool sweepAll(const BrickStore& bricks, const glm::vec2& center, const glm::vec2& displacement, float radius, SweepHit& hit)
+	{
+		hit = SweepHit();
+		_brickTests += bricks.getLiveCount();
+		_overlapping.clear();
+		const float halfLength = 0.5f * glm::length(displacement);
+		bricks.overlapCircle(center + 0.5f * displacement, radius + halfLength, _overlapping);
+		for (unsigned int index : _overlapping)
+			sweepBrick(bricks, index, center, displacement, radius, hit);
+		return hit._brick >= 0;
+	}
+
+	//Bricks that went through the circle test since the last call
+	unsigned int popBrickTests()
+	{
+		unsigned int tests = _brickTests;
+		_brickTests = 0;
+		return tests;
+	}
+};
\ No newline at end of file
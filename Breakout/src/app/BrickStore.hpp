@@ -0,0 +1,306 @@
+#pragma once
+
+#include "CpuFeatures.hpp"
+#include "SpriteBatch.hpp"
+#include <glm/glm.hpp>
+#include <immintrin.h>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+//All bricks of a level in parallel arrays: position and size as floats, colour packed to RGBA8, the tile code of the level file as type
+//Destroyed bricks stay in the arrays (indices never change) and get a bit in the destroyed bitset
+//-> loops over the live bricks skip 64 destroyed ones with one compare, the circle test runs on 8 bricks at a time with AVX2
+class BrickStore
+{
+public:
+	static const unsigned char SOLID = 1; //Tile code of the indestructible bricks
+
+	//Padding behind every array -> the SIMD test can always load full blocks of 8
+	static const unsigned int PADDING = 8;
+
+private:
+	unsigned int _count = 0, _liveCount = 0;
+	bool _simd;
+
+	std::vector<float> _x, _y, _width, _height;
+	std::vector<uint32_t> _colors;
+	std::vector<unsigned char> _types;
+	std::vector<uint64_t> _destroyed;
+
+	static unsigned int countTrailingZeros(uint64_t value)
+	{
+		#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanForward64(&index, value);
+			return (unsigned int)index;
+		#else
+			return (unsigned int)__builtin_ctzll(value);
+		#endif
+	}
+
+	//Live bricks of a bitset word as set bits, bits behind the last brick are cleared
+	uint64_t liveBits(unsigned int word) const
+	{
+		uint64_t live = ~_destroyed[word];
+		unsigned int end = _count - word * 64;
+		if (end < 64)
+			live &= (1ull << end) - 1;
+		return live;
+	}
+
+	bool overlapsScalar(unsigned int index, const glm::vec2& center, float radius) const
+	{
+		//Distance from the center to the closest point of the box
+		float dx = std::max(std::max(_x[index] - center.x, center.x - (_x[index] + _width[index])), 0.0f);
+		float dy = std::max(std::max(_y[index] - center.y, center.y - (_y[index] + _height[index])), 0.0f);
+		return dx * dx + dy * dy <= radius * radius;
+	}
+
+	//Lanes of 8 boxes that overlap the circle as a bitmask
+	TARGET_AVX2 static int overlapMask(__m256 x, __m256 y, __m256 width, __m256 height, __m256 centerX, __m256 centerY, __m256 radius2)
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		__m256 dx = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(x, centerX), _mm256_sub_ps(centerX, _mm256_add_ps(x, width))), zero);
+		__m256 dy = _mm256_max_ps(_mm256_max_ps(_mm256_sub_ps(y, centerY), _mm256_sub_ps(centerY, _mm256_add_ps(y, height))), zero);
+		__m256 distance2 = _mm256_fmadd_ps(dx, dx, _mm256_mul_ps(dy, dy));
+		return _mm256_movemask_ps(_mm256_cmp_ps(distance2, radius2, _CMP_LE_OQ));
+	}
+
+	//All bricks in blocks of 8, the live bits of the bitset mask out destroyed ones (and the padding)
+	TARGET_AVX2 unsigned int overlapAllSimd(const glm::vec2& center, float radius, std::vector<unsigned int>& result) const
+	{
+		const __m256 centerX = _mm256_set1_ps(center.x), centerY = _mm256_set1_ps(center.y), radius2 = _mm256_set1_ps(radius * radius);
+		unsigned int found = 0;
+		for (unsigned int word = 0; word < _destroyed.size(); word++)
+		{
+			uint64_t live = liveBits(word);
+			for (unsigned int block = 0; live != 0 && block < 8; block++, live >>= 8)
+			{
+				unsigned int lanes = (unsigned int)(live & 0xFF);
+				if (lanes == 0)
+					continue;
+
+				unsigned int first = word * 64 + block * 8;
+				lanes &= (unsigned int)overlapMask(_mm256_loadu_ps(&_x[first]), _mm256_loadu_ps(&_y[first]), _mm256_loadu_ps(&_width[first]), _mm256_loadu_ps(&_height[first]), centerX, centerY, radius2);
+				for (; lanes != 0; lanes &= lanes - 1)
+				{
+					result.push_back(first + countTrailingZeros(lanes));
+					found++;
+				}
+			}
+		}
+		return found;
+	}
+
+	//Gathers 8 bricks by index per iteration, the rest gets tested one by one
+	TARGET_AVX2 unsigned int overlapListSimd(const unsigned int* indices, unsigned int count, const glm::vec2& center, float radius, unsigned int* result) const
+	{
+		const __m256 centerX = _mm256_set1_ps(center.x), centerY = _mm256_set1_ps(center.y), radius2 = _mm256_set1_ps(radius * radius);
+		unsigned int found = 0, i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			const __m256i index = _mm256_loadu_si256((const __m256i*)(indices + i));
+			int lanes = overlapMask(_mm256_i32gather_ps(&_x[0], index, 4), _mm256_i32gather_ps(&_y[0], index, 4), _mm256_i32gather_ps(&_width[0], index, 4), _mm256_i32gather_ps(&_height[0], index, 4), centerX, centerY, radius2);
+			for (; lanes != 0; lanes &= lanes - 1)
+				result[found++] = indices[i + countTrailingZeros((uint64_t)lanes)];
+		}
+
+		for (; i < count; i++)
+		{
+			if (overlapsScalar(indices[i], center, radius))
+				result[found++] = indices[i];
+		}
+		return found;
+	}
+
+public:
+	//simd = use the AVX2 circle tests if the CPU supports it
+	BrickStore(bool simd = true)
+		: _simd(simd && CpuFeatures::hasAvx2())
+	{
+		clear();
+	}
+
+	void clear()
+	{
+		_count = _liveCount = 0;
+		for (std::vector<float>* array : { &_x, &_y, &_width, &_height })
+			array->assign(PADDING, 0.0f);
+		_colors.clear();
+		_types.clear();
+		_destroyed.clear();
+	}
+
+	void reserve(unsigned int count)
+	{
+		for (std::vector<float>* array : { &_x, &_y, &_width, &_height })
+			array->reserve(count + PADDING);
+		_colors.reserve(count);
+		_types.reserve(count);
+		_destroyed.reserve((count + 63) / 64);
+	}
+
+	//Returns the index of the new brick
+	unsigned int add(const glm::vec2& position, const glm::vec2& size, const glm::vec3& color, unsigned char type)
+	{
+		return add(position, size, SpriteBatch::packColor(glm::vec4(color, 1.0f)), type);
+	}
+
+	//Colour from SpriteBatch::packColor() -> bulk loads pack each colour once
+	unsigned int add(const glm::vec2& position, const glm::vec2& size, uint32_t packedColor, unsigned char type)
+	{
+		//The new brick takes the first padding entry
+		unsigned int index = _count++;
+		_x[index] = position.x;
+		_y[index] = position.y;
+		_width[index] = size.x;
+		_height[index] = size.y;
+		_x.push_back(0.0f);
+		_y.push_back(0.0f);
+		_width.push_back(0.0f);
+		_height.push_back(0.0f);
+
+		_colors.push_back(packedColor);
+		_types.push_back(type);
+		if (_destroyed.size() * 64 < _count)
+			_destroyed.push_back(0);
+
+		_liveCount++;
+		return index;
+	}
+
+	//count bricks of a grid row (level tiles) starting at column, all of the same size, type and colour
+	//Returns the index of the first one
+	unsigned int addRow(unsigned int column, float y, const glm::vec2& size, unsigned int count, uint32_t packedColor, unsigned char type)
+	{
+		unsigned int first = _count;
+		_count += count;
+		_liveCount += count;
+		for (std::vector<float>* array : { &_x, &_y, &_width, &_height })
+			array->resize(_count + PADDING, 0.0f);
+		_colors.resize(_count, packedColor);
+		_types.resize(_count, type);
+		_destroyed.resize((_count + 63) / 64, 0);
+
+		for (unsigned int i = 0; i < count; i++)
+			_x[first + i] = (float)(column + i) * size.x;
+		std::fill(&_y[first], &_y[first] + count, y);
+		std::fill(&_width[first], &_width[first] + count, size.x);
+		std::fill(&_height[first], &_height[first] + count, size.y);
+		return first;
+	}
+
+	//Returns false if the brick was destroyed already
+	bool destroy(unsigned int index)
+	{
+		uint64_t& word = _destroyed[index / 64];
+		uint64_t bit = 1ull << (index % 64);
+		if (word & bit)
+			return false;
+
+		word |= bit;
+		_liveCount--;
+		return true;
+	}
+
+	bool isDestroyed(unsigned int index) const
+	{
+		return (_destroyed[index / 64] >> (index % 64)) & 1;
+	}
+
+	bool isSolid(unsigned int index) const
+	{
+		return _types[index] == SOLID;
+	}
+
+	//Calls function(index) for every live brick in index order
+	template<typename Function>
+	void forEachLive(Function function) const
+	{
+		for (unsigned int word = 0; word < _destroyed.size(); word++)
+		{
+			for (uint64_t live = liveBits(word); live != 0; live &= live - 1)
+				function(word * 64 + countTrailingZeros(live));
+		}
+	}
+
+	//Appends the live bricks that overlap the circle to result, returns how many
+	unsigned int overlapCircle(const glm::vec2& center, float radius, std::vector<unsigned int>& result) const
+	{
+		if (_simd)
+			return overlapAllSimd(center, radius, result);
+
+		unsigned int found = 0;
+		forEachLive([&](unsigned int index)
+		{
+			if (overlapsScalar(index, center, radius))
+			{
+				result.push_back(index);
+				found++;
+			}
+		});
+		return found;
+	}
+
+	//Writes the bricks of indices that overlap the circle to result (room for count entries), returns how many
+	//Doesn't look at the destroyed bits, the candidates come filtered already
+	unsigned int overlapCircle(const unsigned int* indices, unsigned int count, const glm::vec2& center, float radius, unsigned int* result) const
+	{
+		if (_simd)
+			return overlapListSimd(indices, count, center, radius, result);
+
+		unsigned int found = 0;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			if (overlapsScalar(indices[i], center, radius))
+				result[found++] = indices[i];
+		}
+		return found;
+	}
+
+	unsigned int getCount() const
+	{
+		return _count;
+	}
+
+	unsigned int getLiveCount() const
+	{
+		return _liveCount;
+	}
+
+	bool usesSimd() const
+	{
+		return _simd;
+	}
+
+	glm::vec2 getPosition(unsigned int index) const
+	{
+		return glm::vec2(_x[index], _y[index]);
+	}
+
+	glm::vec2 getSize(unsigned int index) const
+	{
+		return glm::vec2(_width[index], _height[index]);
+	}
+
+	uint32_t getPackedColor(unsigned int index) const
+	{
+		return _colors[index];
+	}
+
+	glm::vec3 getColor(unsigned int index) const
+	{
+		uint32_t color = _colors[index];
+		return glm::vec3(color & 0xFF, (color >> 8) & 0xFF, (color >> 16) & 0xFF) / 255.0f;
+	}
+
+	unsigned char getType(unsigned int index) const
+	{
+		return _types[index];
+	}
+};
\ No newline at end of file
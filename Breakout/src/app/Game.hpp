@@ -4,19 +4,16 @@
 #include "ResourceManager.hpp"
 #include "GameLevelCreator.hpp"
 #include "BallObject.hpp"
-#include "ParticleGenerator.hpp"
+#include "BrickGrid.hpp"
+#include "ParticleSystem.hpp"
+#include "ParticleRenderer.hpp"
 #include "Random.hpp"
 #include "PowerUpManager.hpp"
 #include "AudioManager.hpp"
 #include "TextRenderer.hpp"
-
-enum CollisionSide
-{
-    LEFT,
-	RIGHT,
-	TOP,
-	BOTTOM
-};
+#include "FrameArena.hpp"
+#include <algorithm>
+#include <chrono>
 
 enum GameState
 {
@@ -42,6 +39,13 @@ unsigned int ACTIVE_STICKY_EFFECTS = 0;
 unsigned int ACTIVE_PASSTHROUGH_EFFECTS = 0;
 unsigned int ACTIVE_PADINREASE_EFFECTS = 0;
 unsigned int DESTROYED_BLOCKS = 0;
+std::string LEVEL_FILE = "../res/levels/basic.level"; //Text or binary level (--level)
+unsigned int GENERATED_BRICKS = 0; //Random level with this many bricks instead of the level file (--bricks)
+const unsigned int MAX_PARTICLES = 200000;
+const unsigned int BRICK_SPARKS = 60; //Particles per destroyed brick
+const unsigned int MAX_BALL_CONTACTS = 8; //Bounces of one ball per frame, the rest of the step gets dropped after that
+const unsigned int MULTIBALL_COUNT = 1000; //Balls per press of M
+const float MULTIBALL_RADIUS = 6.0f;
 
 class Game
 {
@@ -61,118 +65,111 @@ private:
         return collisionOnX && collisionOnY;
     }
 	
-    bool CollisionOccured(BallObject& Ball, GameObject& GO, bool isPlayer = false) const
+    //Moves a ball by velocity * dt with continuous collision against the bricks and the paddle -> fast balls can't tunnel through anything
+    //The bricks come from the grid (or all of them with the brute force check), the ball bounces off the earliest hit and moves on with the rest of the step
+    void MoveBall(BallObject& ball, float dt, bool playSounds)
     {
-    	//Collision detection based on axis-aligned bounding boxes
-        const glm::vec2 ball_center(Ball._position + Ball._radius);
-        const glm::vec2 box_half(GO._size.x / 2, GO._size.y / 2);
-        const glm::vec2 box_center(GO._position + box_half);
-        glm::vec2 diff = ball_center - box_center;
-        const glm::vec2 clamped = glm::clamp(diff, -box_half, box_half);
-        const glm::vec2 closest_point = box_center + clamped;
-        diff = closest_point - ball_center;                
-            	
-        if (glm::length(diff) < Ball._radius)
+        if (ball._stuck)
+            return;
+
+        BrickStore& bricks = _gameLevelCreator->_bricks;
+        glm::vec2 center = ball._position + ball._radius;
+        float remaining = dt;
+
+        for (unsigned int contact = 0; contact < MAX_BALL_CONTACTS && remaining > 0.0f; contact++)
         {
-        	//Which side of the quad did the ball hit
-            const float left_line = GO._position.x;
-            const float right_line = GO._position.x + GO._size.x;
-            const float top_line = GO._position.y;
-            const float bottom_line = GO._position.y + GO._size.y;
-
-            //Repositioning
-            const float penetration_depth = Ball._radius - glm::length(diff);
-        	
-        	if (!isPlayer) //Check for collision with boxes
-        	{
-                if (!_ball->_passThrough)
-                {
-                    if ((int)closest_point.x == (int)left_line)
-                    {
-                        ChangeDirection(LEFT);
-                        Ball._position.x += penetration_depth;
-                    }
-                    else if ((int)closest_point.x == (int)right_line)
-                    {
-                        ChangeDirection(RIGHT);
-                        Ball._position.x -= penetration_depth;
-                    }
-                    else if ((int)closest_point.y == (int)top_line)
-                    {
-                        ChangeDirection(TOP);
-                        Ball._position.y -= penetration_depth;
-                    }
-                    else if ((int)closest_point.y == (int)bottom_line)
-                    {
-                        ChangeDirection(BOTTOM);
-                        Ball._position.y += penetration_depth;
-                    }
-                }                                 
-        	}
-            else         //Check for collision with player paddle
+            const glm::vec2 displacement = ball._velocity * remaining;
+
+            SweepHit hit;
+            if (_bruteForceCollisions)
+                _brickGrid.sweepAll(bricks, center, displacement, ball._radius, hit);
+            else
+                _brickGrid.sweep(bricks, center, displacement, ball._radius, hit);
+
+            float paddleTime;
+            glm::vec2 paddleNormal;
+            const bool paddleHit = sweepCircleBox(center, displacement, ball._radius, _player->_position, _player->_position + _player->_size, paddleTime, paddleNormal) && paddleTime < hit._time;
+
+            if (!paddleHit && hit._brick < 0)
+            {
+                center += displacement;
+                break;
+            }
+
+            //Move to the contact
+            const float time = paddleHit ? paddleTime : hit._time;
+            center += displacement * time;
+            remaining -= remaining * time;
+
+            if (paddleHit)
             {
-				if ((int)closest_point.y == (int)top_line)
-				{
-					//Calculate where the ball hit the paddle and change velocity based on the distance to the center
-                    const float paddle_center = GO._position.x + GO._size.x / 2.0f;
-                    const float distance_to_center = (Ball._position.x + Ball._radius) - paddle_center;
-                    float percentage = distance_to_center / (GO._size.x / 2.0f);
+                if (paddleNormal.y < -0.5f) //Top of the paddle
+                {
+                    //Calculate where the ball hit the paddle and change velocity based on the distance to the center
+                    const float paddle_center = _player->_position.x + _player->_size.x / 2.0f;
+                    const float distance_to_center = center.x - paddle_center;
                     const float strength = 4.0f;
-                    const glm::vec2 oldVelocity = Ball._velocity;
-                    Ball._velocity.x = oldVelocity.x + distance_to_center * strength;
+                    const glm::vec2 oldVelocity = ball._velocity;
+                    ball._velocity.x = oldVelocity.x + distance_to_center * strength;
+                    ball._velocity.y = -std::abs(oldVelocity.y);
+
+                    //Normalize velocity
+                    ball._velocity = glm::normalize(ball._velocity) * glm::length(oldVelocity);
+                }
+                else
+                    ball._velocity -= 2.0f * glm::dot(ball._velocity, paddleNormal) * paddleNormal;
+
+                if (playSounds)
+                    _audioManager->playSound2D("../res/audio/sounds/Player_hit.wav", false);
+                continue;
+            }
 
-					//Change velocity in the y-direction
-                    ChangeDirection(TOP);
+            const unsigned int brick = (unsigned int)hit._brick;
+            if (!bricks.isSolid(brick) || ball._passThrough)
+            {
+                bricks.destroy(brick);
+                spawnSparks(brick);
+                if (!bricks.isSolid(brick))
+                    _powerUpManager->spawnPowerUps(bricks.getPosition(brick), random::Int(10));
+            }
+            DESTROYED_BLOCKS++;
 
-					//Normalize velocity
-                    Ball._velocity = glm::normalize(Ball._velocity) * glm::length(oldVelocity);
+            //PassThrough balls keep their direction
+            if (!ball._passThrough)
+                ball._velocity -= 2.0f * glm::dot(ball._velocity, hit._normal) * hit._normal;
 
-					//Reset ball after hit based on penetration depth
-                    Ball._position.y -= penetration_depth;
-				}					
-            }     
-        	
-            return true;
+            if (playSounds)
+                _audioManager->playSound2D("../res/audio/sounds/Block_hit.wav", false);
         }
-            
-        return false;
+
+        ball._position = center - ball._radius;
+        ball.BounceOffWindow(_width);
     }
 
-    void ChangeDirection(CollisionSide side) const
+    //Extra balls of the multiball mode, spread upwards from the paddle
+    void SpawnMultiBalls(unsigned int count)
     {
-        if (side == TOP || side == BOTTOM)
-            _ball->_velocity.y = -_ball->_velocity.y;
-        else
-            _ball->_velocity.x = -_ball->_velocity.x;
+        const glm::vec2 position = _player->_position + glm::vec2(_player->_size.x / 2.0f - MULTIBALL_RADIUS, -MULTIBALL_RADIUS * 2.0f);
+        const float speed = glm::length(_ballVelocity);
+        for (unsigned int i = 0; i < count; i++)
+        {
+            const float angle = glm::radians(random::Float() * 140.0f + 20.0f); //20 - 160 degree above the horizon
+            _multiBalls.emplace_back(position, MULTIBALL_RADIUS, glm::vec2(std::cos(angle), -std::sin(angle)) * speed, glm::vec3(1.0f, 0.8f, 0.4f), _ball->_spriteTexture, _spriteRenderer);
+            _multiBalls.back()._stuck = false;
+        }
+    }
+
+    void UpdateMultiBalls(float dt)
+    {
+        for (BallObject& ball : _multiBalls)
+            MoveBall(ball, dt, false);
+
+        //Balls that fell out of the window are gone
+        _multiBalls.erase(std::remove_if(_multiBalls.begin(), _multiBalls.end(), [this](const BallObject& ball) { return ball._position.y > _height; }), _multiBalls.end());
     }
     
     void CheckCollisions()
     {
-	    for (GameObject& box : _gameLevelCreator->_bricks)
-	    {
-		    if (!box._destroyed)
-		    {
-			    if (CollisionOccured(*_ball, box))
-			    {
-                    if (!box._solid)
-                    {
-                    	box._destroyed = true;                    	
-                        _powerUpManager->spawnPowerUps(box._position, random::Int(10));
-                        _audioManager->playSound2D("../res/audio/sounds/Block_hit.wav", false);
-                        DESTROYED_BLOCKS++;
-                    }
-                    else
-                    {
-                        if (_ball->_passThrough)
-                            box._destroyed = true;
-
-                        _audioManager->playSound2D("../res/audio/sounds/Block_hit.wav", false);
-                        DESTROYED_BLOCKS++;
-                    }
-			    }
-		    }
-	    }
-
     	for (auto& powerUp : _powerUpManager->_powerUpsToRender)
     	{
             unsigned int index = 0;
@@ -194,6 +191,17 @@ private:
     	}
     }
 
+    //Burst of particles in the colour of the brick
+    void spawnSparks(unsigned int brick)
+    {
+        const BrickStore& bricks = _gameLevelCreator->_bricks;
+        ParticleEmitter sparks = _sparkEmitter;
+        sparks._position = glm::vec3(bricks.getPosition(brick) + bricks.getSize(brick) * 0.5f, 0.0f);
+        sparks._positionSpread = glm::vec3(bricks.getSize(brick) * 0.5f, 0.0f);
+        sparks._startColor = glm::vec4(bricks.getColor(brick), 1.0f);
+        _particleSystem->burst(sparks, BRICK_SPARKS);
+    }
+
     void CreatePowerUpEffect(std::string& type) const
     {
         if (type == "speed")
@@ -295,8 +303,18 @@ public:
     float _ballRadius;
     glm::vec2 _lastPos;
 
-    //Particles
-    ParticleGenerator* _particleGenerator = nullptr;
+    //Collision (grid over the bricks, multiball stress mode)
+    BrickGrid _brickGrid;
+    bool _bruteForceCollisions = false;
+    std::vector<BallObject> _multiBalls;
+    bool _multiBallKeyPressed = false, _bruteForceKeyPressed = false;
+    unsigned int _brickTests = 0; //Circle vs brick tests of the last frame
+    float _collisionTime = 0.0f; //ms
+
+    //Particles (ball trail and brick sparks)
+    ParticleSystem* _particleSystem = nullptr;
+    ParticleRenderer* _particleRenderer = nullptr;
+    ParticleEmitter _ballTrail, _sparkEmitter;
 
 	//PowerUps
     PowerUpManager* _powerUpManager = nullptr;
@@ -320,7 +338,8 @@ public:
         delete _gameLevelCreator;
         delete _player;
         delete _ball;
-        delete _particleGenerator;
+        delete _particleRenderer;
+        delete _particleSystem;
         delete _powerUpManager;
         delete _audioManager;
         delete _textRenderer;
@@ -340,8 +359,15 @@ public:
         ResourceManager::LoadTexture("../res/textures/Block_solid.jpg", "Block_solid");
         _gameLevelCreator = new GameLevelCreator(_spriteRenderer, _width, _height, ResourceManager::GetTexture("Block"), ResourceManager::GetTexture("Block_solid"));
 
-        //Load level from file
-        _gameLevelCreator->generateLevel("../res/levels/basic.level");
+        //Load level from file (or generate a huge one)
+        if (GENERATED_BRICKS > 0)
+            _gameLevelCreator->generateLevel(GENERATED_BRICKS);
+        else if (!_gameLevelCreator->generateLevel(LEVEL_FILE.c_str()))
+        {
+            spdlog::warn("Playing a generated level instead of {}", LEVEL_FILE);
+            _gameLevelCreator->generateLevel(100u);
+        }
+        _brickGrid.build(_gameLevelCreator->_bricks);
 
         //Background creation
         ResourceManager::LoadTexture("../res/textures/Background_1.jpg", "Background");
@@ -356,11 +382,29 @@ public:
         _ball = new BallObject(_player->_position + glm::vec2(_player->_size.x / 2.0f - _ballRadius, -_ballRadius * 2.0f), _ballRadius, _ballVelocity, glm::vec3(0.7f, 0.7f, 1.0f), ResourceManager::GetTexture("Ball"), _spriteRenderer);
         _lastPos = _ball->_position;
 
-        //ParticleGenerator creation
+        //Particle system creation
         ResourceManager::LoadShader("../res/shader/breakout/particle_vs.glsl", "../res/shader/breakout/particle_fs.glsl", "Particle_Shader");
         ResourceManager::LoadTexture("../res/textures/Particle.png", "Particle");
-        _particleGenerator = new ParticleGenerator(ResourceManager::GetShader("Particle_Shader"), ResourceManager::GetTexture("Particle"), _spriteRenderer->getProjectionMatrix());
-        _particleGenerator->createParticles(glm::vec2(_ball->_position.x + 7.5f, _ball->_position.y + 7.5f), glm::vec2(10.0f, 10.0f), glm::vec4(0.0f, 0.0f, 1.0f, 0.0f), glm::vec4(1.0f, 1.0f, 1.0f, 0.0f));
+        _particleSystem = new ParticleSystem(MAX_PARTICLES);
+        _particleRenderer = new ParticleRenderer(_particleSystem, ResourceManager::GetShader("Particle_Shader"), ResourceManager::GetTexture("Particle"));
+
+        //Ball trail: blue to white, drifting down behind the ball
+        _ballTrail._velocityMin = glm::vec3(-30.0f, 0.0f, 0.0f);
+        _ballTrail._velocityMax = glm::vec3(30.0f, 100.0f, 0.0f);
+        _ballTrail._lifeMin = 0.0f;
+        _ballTrail._lifeMax = 0.5f;
+        _ballTrail._size = 10.0f;
+        _ballTrail._startColor = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+        _ballTrail._endColor = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
+        _ballTrail._rate = 160.0f;
+
+        //Brick sparks: fly apart (mostly upwards) and fade out
+        _sparkEmitter._velocityMin = glm::vec3(-200.0f, -250.0f, 0.0f);
+        _sparkEmitter._velocityMax = glm::vec3(200.0f, 50.0f, 0.0f);
+        _sparkEmitter._lifeMin = 0.3f;
+        _sparkEmitter._lifeMax = 0.9f;
+        _sparkEmitter._size = 6.0f;
+        _sparkEmitter._endColor = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f);
 
         //PowerUp creation
         ResourceManager::LoadTexture("../res/textures/Powerup_speed.png", "Speed");
@@ -381,24 +425,31 @@ public:
 
     void update(float dt)
     {
-    	//Move ball via velocity vector
-        _ball->Move(dt, _width);
+    	//Move the balls, they collide with the bricks and the player on the way
+        auto collisionStart = std::chrono::high_resolution_clock::now();
+        MoveBall(*_ball, dt, true);
+        UpdateMultiBalls(dt);
+        _collisionTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - collisionStart).count();
+        _brickTests = _brickGrid.popBrickTests();
     	
         //Update all powerups
         _powerUpManager->updatePowerUps(dt);
     	
-    	//Check for collisions between ball+boxes and player+powerups
+    	//Check for collisions between player+powerups
         CheckCollisions();
 
     	//Update all active (powerUp) effects   	
         UpdateActiveEffects(dt);
-            	
-        //Check for collision between ball+player
-        if (CollisionOccured(*_ball, *_player, true))
-            _audioManager->playSound2D("../res/audio/sounds/Player_hit.wav", false);
 
-    	//Update Particles
-        _particleGenerator->updateParticles(dt, glm::vec2(_ball->_position.x + 7.5f, _ball->_position.y + 7.5f));    	
+
+    	//Update particles, the trail only grows while the ball moves
+        _particleSystem->update(dt);
+        if (_lastPos != _ball->_position)
+        {
+            _ballTrail._position = glm::vec3(_ball->_position + 12.5f, 0.0f);
+            _particleSystem->emit(_ballTrail, dt);
+        }
+        _lastPos = _ball->_position;
     }
 
     void processInput(float dt)
@@ -430,11 +481,22 @@ public:
         	{
                 _ball->_stuck = false;
         	}
+
+            //M = multiball (stress test), B = test every brick instead of the grid cells
+            if (_keys[GLFW_KEY_M] && !_multiBallKeyPressed)
+                SpawnMultiBalls(MULTIBALL_COUNT);
+            if (_keys[GLFW_KEY_B] && !_bruteForceKeyPressed)
+                _bruteForceCollisions = !_bruteForceCollisions;
+            _multiBallKeyPressed = _keys[GLFW_KEY_M];
+            _bruteForceKeyPressed = _keys[GLFW_KEY_B];
         }
     }
 
     void render()
     {
+        _spriteRenderer->getSpriteBatch()->resetStats();
+        _textRenderer->update();
+
         //Render background
         _background->Draw();
     	
@@ -444,20 +506,24 @@ public:
     	//Render player
         _player->Draw();
     	
-        //Render particles if ball position has changed       
-        if(_lastPos != _ball->_position)
-			_particleGenerator->renderParticles();
-
-    	//Update last ball position
-        _lastPos = _ball->_position;
+        //Render particles between the paddle and the ball (the sprites so far have to be drawn first)
+        _spriteRenderer->flush();
+        _particleRenderer->render(_spriteRenderer->getProjectionMatrix(), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
     	
-    	//Render ball
+    	//Render balls
         _ball->Draw();
+        for (BallObject& ball : _multiBalls)
+            ball.Draw();
 
     	//Render powerups
         _powerUpManager->renderPowerUps();
 
+        //Draw the remaining sprites (the textures share the draw calls)
+        _spriteRenderer->flush();
+
     	//Render text
-        _textRenderer->RenderText("Destroyed: " + std::to_string(DESTROYED_BLOCKS), 5.0f, 5.0f, 1.25f, glm::vec3(1.0f));
+        FrameString destroyedText;
+        destroyedText << "Destroyed: " << DESTROYED_BLOCKS;
+        _textRenderer->RenderText(destroyedText.c_str(), 5.0f, 5.0f, 1.25f, glm::vec3(1.0f));
     }
 };
\ No newline at end of file
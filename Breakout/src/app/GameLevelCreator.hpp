@@ -1,8 +1,15 @@
 #pragma once
 
-#include "GameObject.hpp"
+#include "SpriteRenderer.hpp"
+#include "BrickStore.hpp"
+#include "LevelFile.hpp"
+#include "MappedFile.hpp"
+#include "Random.hpp"
+#include <chrono>
+#include <cmath>
 #include <vector>
 #include <string>
+#include <utility>
 
 class GameLevelCreator
 {
@@ -10,9 +17,88 @@ private:
     SpriteRenderer* _spriteRenderer = nullptr;
     unsigned int _gameWidth, _gameHeight;
     Texture* _block_tex, * _solid_block_tex;
+
+    static glm::vec3 brickColor(unsigned int tileCode)
+    {
+        if (tileCode == 1)
+            return glm::vec3(0.8f, 0.8f, 0.7f);  //Solid
+        else if (tileCode == 2)
+            return glm::vec3(0.2f, 0.6f, 1.0f);  //Blue
+        else if (tileCode == 3)
+            return glm::vec3(0.0f, 0.7f, 0.0f);  //Green
+        else if (tileCode == 4)
+            return glm::vec3(0.9f, 0.9f, 0.2f);  //Yellow
+        else if (tileCode == 5)
+            return glm::vec3(1.0f, 0.5f, 0.0f);  //Orange
+
+        return glm::vec3(1.0f);                  //White
+    }
+
+    //Level file tiles -> bricks, the brick size follows from the number of columns
+    struct BrickBuilder
+    {
+        BrickStore& _bricks;
+        float _gameWidth;
+        glm::vec2 _brickSize;
+        unsigned int _columns = 0, _rows = 0;
+        uint32_t _colors[256]; //Packed colour per tile code
+
+        BrickBuilder(BrickStore& bricks, float gameWidth)
+            : _bricks(bricks), _gameWidth(gameWidth)
+        {
+            for (unsigned int code = 0; code < 256; code++)
+                _colors[code] = SpriteBatch::packColor(glm::vec4(brickColor(code), 1.0f));
+        }
+
+        void begin(unsigned int columns, unsigned int maxTiles)
+        {
+            _columns = columns;
+            _brickSize.x = _gameWidth / columns;
+            _brickSize.y = _brickSize.x / 1.5f;
+            _bricks.clear();
+            _bricks.reserve(maxTiles);
+        }
+
+        void tiles(unsigned int x, unsigned int y, unsigned int count, unsigned int code)
+        {
+            _bricks.addRow(x, (float)y * _brickSize.y, _brickSize, count, _colors[code], (unsigned char)code);
+        }
+
+        void end(unsigned int rows)
+        {
+            _rows = rows;
+        }
+    };
+
+    //Level file tiles -> tile codes row by row (for converting levels)
+    struct TileCollector
+    {
+        std::vector<unsigned char> _tiles;
+        unsigned int _columns = 0, _rows = 0;
+
+        void begin(unsigned int columns, unsigned int maxTiles)
+        {
+            _columns = columns;
+            _tiles.reserve(maxTiles);
+        }
+
+        void tiles(unsigned int x, unsigned int y, unsigned int count, unsigned int code)
+        {
+            size_t cell = (size_t)y * _columns + x;
+            if (_tiles.size() < cell + count)
+                _tiles.resize(cell + count, 0);
+            std::fill(&_tiles[cell], &_tiles[cell] + count, (unsigned char)code);
+        }
+
+        void end(unsigned int rows)
+        {
+            _rows = rows;
+            _tiles.resize((size_t)_columns * _rows, 0);
+        }
+    };
 	
 public:
-    std::vector<GameObject> _bricks;
+    BrickStore _bricks;
 	
 	GameLevelCreator(SpriteRenderer* spriteRenderer, const unsigned int& width, const unsigned int& height, Texture* block_tex, Texture* solid_block_tex)
 		: _spriteRenderer(spriteRenderer), _gameWidth(width), _gameHeight(height), _block_tex(block_tex),  _solid_block_tex(solid_block_tex)
@@ -25,74 +111,67 @@ public:
         
 	}
 	
-    void generateLevel(const char* level_filepath)
-    {		    
-        //Load from file
-        unsigned int tileCode;
-        std::string line;
-        std::ifstream fstream(level_filepath);
-        std::vector<std::vector<unsigned int>> tileData;
-		
-        if (fstream)
+    //Loads a text or binary level (see LevelFile), the file gets mapped into memory and parsed in one pass
+    //Returns false and keeps the current bricks if the file can't be read
+    bool generateLevel(const char* level_filepath)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+
+        //Parsed into a new store -> a broken file leaves the current level as it is
+        MappedFile file(level_filepath);
+        BrickStore bricks(_bricks.usesSimd());
+        BrickBuilder builder(bricks, (float)_gameWidth);
+        if (!file.isOpen() || !LevelFile::read(file.getData(), file.getSize(), builder))
         {
-            while (std::getline(fstream, line)) //Read each line from level file
-            {
-                std::istringstream sstream(line);
-                std::vector<unsigned int> row;
-                while (sstream >> tileCode) //Read each word separated by spaces
-                    row.push_back(tileCode);
-                tileData.push_back(row);
-            }
+            spdlog::error("ERROR! CAN'T LOAD LEVEL {}!", level_filepath);
+            return false;
         }
-		
-        if (!tileData.empty())
-        {
-            float height = tileData.size();
-            float width = tileData[0].size();
-            float brick_width = _gameWidth / width;
-            float brick_height = brick_width / 1.5f;
+        std::swap(_bricks, bricks);
+
+        float loadTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        spdlog::info("Level {} loaded: {} x {} tiles, {} bricks in {:.2f} ms", level_filepath, builder._columns, builder._rows, _bricks.getCount(), loadTime);
+        return true;
+    }
+
+    //Writes a level (text or binary) as a binary level
+    static bool convertLevel(const char* level_filepath, const char* binary_filepath)
+    {
+        MappedFile file(level_filepath);
+        TileCollector collector;
+        if (!file.isOpen() || !LevelFile::read(file.getData(), file.getSize(), collector))
+            return false;
 
-            for (int y = 0; y < height; y++)
+        return LevelFile::writeBinary(binary_filepath, collector._tiles.empty() ? nullptr : &collector._tiles[0], collector._columns, collector._rows);
+    }
+
+    //Random level with about count bricks in the upper half of the window (stress test for huge levels)
+    void generateLevel(unsigned int count)
+    {
+        //Bricks keep the 1.5 : 1 ratio of the file levels -> rows * width / 1.5 = area_height with rows = count / columns
+        float area_height = _gameHeight / 2.0f;
+        unsigned int columns = std::max(1u, (unsigned int)std::sqrt(count * _gameWidth / (1.5f * area_height)));
+        unsigned int rows = std::max(1u, (count + columns - 1) / columns);
+        float brick_width = _gameWidth / (float)columns;
+        float brick_height = brick_width / 1.5f;
+
+        _bricks.clear();
+        _bricks.reserve(columns * rows);
+        for (unsigned int y = 0; y < rows; y++)
+        {
+            for (unsigned int x = 0; x < columns; x++)
             {
-                for (int x = 0; x < width; x++)
-                {
-                    if (tileData[y][x] == 1) //Solid
-                    {
-                        glm::vec2 pos(brick_width * x, brick_height * y);
-                        glm::vec2 size(brick_width, brick_height);
-                    	
-                        _bricks.emplace_back(pos, size, glm::vec2(0.0f, 0.0f), glm::vec3(0.8f, 0.8f, 0.7f), 0.0f, _solid_block_tex, _spriteRenderer, true);
-                    }
-
-                    else if (tileData[y][x] > 1)
-                    {
-                        glm::vec3 color = glm::vec3(1.0f);       //White
-
-                        if (tileData[y][x] == 2)
-                            color = glm::vec3(0.2f, 0.6f, 1.0f); //Blue
-                        else if (tileData[y][x] == 3)
-                            color = glm::vec3(0.0f, 0.7f, 0.0f); //Green
-                        else if (tileData[y][x] == 4)
-                            color = glm::vec3(0.9f, 0.9f, 0.2f); //Yellow
-                        else if (tileData[y][x] == 5)
-                            color = glm::vec3(1.0f, 0.5f, 0.0f); //Orange
-
-                        glm::vec2 pos(brick_width * x, brick_height * y);
-                        glm::vec2 size(brick_width, brick_height);
-
-                        _bricks.emplace_back(pos, size, glm::vec2(0.0f, 0.0f), color, 0.0f, _block_tex, _spriteRenderer);
-                    }
-                }
+                //Every tenth brick is solid
+                unsigned int tileCode = random::Int(10) == 0 ? BrickStore::SOLID : 2 + random::Int(4);
+                _bricks.add(glm::vec2(brick_width * x, brick_height * y), glm::vec2(brick_width, brick_height), brickColor(tileCode), (unsigned char)tileCode);
             }
-        }	        
+        }
     }
 
 	void renderLevel()
 	{
-		for(auto brick: _bricks)
+		_bricks.forEachLive([this](unsigned int index)
 		{
-			if (!brick._destroyed)
-				brick.Draw();
-		}
+			_spriteRenderer->DrawSprite(_bricks.isSolid(index) ? _solid_block_tex : _block_tex, _bricks.getPosition(index), _bricks.getSize(index), _bricks.getPackedColor(index));
+		});
 	}
 };
\ No newline at end of file
@@ -0,0 +1,456 @@
+#pragma once
+
+#include <ft2build.h>
+#include <glm/glm.hpp>
+#include <spdlog/spdlog.h>
+#include "OpenGLErrorManager.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include FT_FREETYPE_H
+
+//Glyphs of one font, rasterized the first time a codepoint gets used at a pixel size
+//-> nothing gets rasterized at startup and the memory grows with the glyphs that are actually on screen
+//The glyphs get packed into shelves of atlas pages (one R8 texture each, created when needed, updated with glTexSubImage2D)
+//Once MAX_PAGES are full the least recently used page gets emptied and its generation counts up -> cached layouts that use it become invalid
+//Pages with glyphs handed out in the current frame never get emptied, new glyphs wait for the next frame instead
+//With async rasterization FreeType runs on a worker thread: getGlyph() returns nullptr until update() uploaded the glyph
+class GlyphCache
+{
+public:
+	static const int PAGE_SIZE = 512;
+	static const unsigned int MAX_PAGES = 4;
+
+	struct Glyph
+	{
+		int _page = -1; //-1 = nothing to draw (space, control characters)
+		glm::vec2 _uvMin = glm::vec2(0.0f), _uvMax = glm::vec2(0.0f); //Top left and bottom right corner in the page
+		glm::ivec2 _size = glm::ivec2(0), _bearing = glm::ivec2(0); //Bitmap size, offset from the baseline to the left/top of the bitmap
+		unsigned int _advance = 0; //1/64 pixels
+	};
+
+private:
+	static const int PADDING = 1; //Empty texels around every glyph -> linear filtering doesn't bleed into the neighbours
+	static const int TOO_BIG = -2, NO_ROOM = -3; //Results of allocate()
+
+	struct Page
+	{
+		unsigned int _texture = 0;
+		int _shelfY = 0, _shelfHeight = 0, _penX = 0; //Current shelf
+		unsigned int _lastUsedFrame = 0;
+		unsigned int _generation = 0;
+	};
+
+	//Output of FreeType for one glyph
+	struct Rasterized
+	{
+		uint64_t _key;
+		Glyph _glyph;
+		std::vector<unsigned char> _pixels; //_size.x * _size.y, rows top to bottom
+	};
+
+	FT_Library _library = nullptr;
+	FT_Face _face = nullptr;
+	unsigned int _facePixelSize = 0;
+
+	std::unordered_map<uint64_t, Glyph> _glyphs;
+	std::vector<Page> _pages;
+	unsigned int _frame = 0;
+	unsigned int _evictions = 0;
+
+	//Worker thread: requests in, rasterized glyphs out
+	bool _async;
+	std::thread _worker;
+	std::mutex _mutex;
+	std::condition_variable _wakeUp;
+	std::deque<uint64_t> _requests;
+	std::vector<Rasterized> _finished;
+	std::unordered_set<uint64_t> _pending; //Requested and not uploaded yet (main thread only)
+	bool _quit = false;
+
+	std::vector<unsigned char> _uploadBuffer;
+
+	static uint64_t makeKey(uint32_t codepoint, unsigned int pixelSize)
+	{
+		return ((uint64_t)pixelSize << 32) | codepoint;
+	}
+
+	//Only ever called by one thread at a time (the worker with async rasterization, the main thread without)
+	void rasterize(uint64_t key, Rasterized& out)
+	{
+		uint32_t codepoint = (uint32_t)key;
+		unsigned int pixelSize = (unsigned int)(key >> 32);
+		out._key = key;
+		out._glyph = Glyph();
+		out._pixels.clear();
+
+		if (pixelSize != _facePixelSize)
+		{
+			FT_Set_Pixel_Sizes(_face, 0, pixelSize);
+			_facePixelSize = pixelSize;
+		}
+
+		//Codepoints the font doesn't have become its "missing glyph" box (glyph index 0)
+		if (FT_Load_Glyph(_face, FT_Get_Char_Index(_face, codepoint), FT_LOAD_RENDER))
+		{
+			spdlog::error("Failed to rasterize glyph U+{:04X} at {} px", codepoint, pixelSize);
+			return;
+		}
+
+		const FT_Bitmap& bitmap = _face->glyph->bitmap;
+		out._glyph._size = glm::ivec2(bitmap.width, bitmap.rows);
+		out._glyph._bearing = glm::ivec2(_face->glyph->bitmap_left, _face->glyph->bitmap_top);
+		out._glyph._advance = (unsigned int)_face->glyph->advance.x;
+
+		//Copy the rows, the pitch of FreeType can be bigger than the width
+		out._pixels.resize(bitmap.width * bitmap.rows);
+		for (unsigned int row = 0; row < bitmap.rows; row++)
+			std::memcpy(&out._pixels[row * bitmap.width], bitmap.buffer + row * bitmap.pitch, bitmap.width);
+	}
+
+	void workerLoop()
+	{
+		Rasterized rasterized;
+		while (true)
+		{
+			uint64_t key;
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_wakeUp.wait(lock, [&]() { return _quit || !_requests.empty(); });
+				if (_quit)
+					return;
+
+				key = _requests.front();
+				_requests.pop_front();
+			}
+
+			rasterize(key, rasterized);
+
+			std::lock_guard<std::mutex> lock(_mutex);
+			_finished.push_back(std::move(rasterized));
+		}
+	}
+
+	void startWorker()
+	{
+		if (!_async || _worker.joinable())
+			return;
+
+		_quit = false;
+		_worker = std::thread(&GlyphCache::workerLoop, this);
+	}
+
+	void stopWorker()
+	{
+		if (!_worker.joinable())
+			return;
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_quit = true;
+		}
+		_wakeUp.notify_one();
+		_worker.join();
+
+		//The worker can still have pushed the glyph it was working on, clear after it's gone
+		_requests.clear();
+		_finished.clear();
+		_pending.clear();
+	}
+
+	void evictPage(unsigned int index)
+	{
+		for (std::unordered_map<uint64_t, Glyph>::iterator it = _glyphs.begin(); it != _glyphs.end();)
+		{
+			if (it->second._page == (int)index)
+				it = _glyphs.erase(it);
+			else
+				++it;
+		}
+
+		Page& page = _pages[index];
+		page._shelfY = 0;
+		page._shelfHeight = 0;
+		page._penX = 0;
+		page._generation++;
+		_evictions++;
+	}
+
+	//Finds room for a width x height block (padding included) on the current shelf of a page, a new shelf or a new page
+	//Returns the page, TOO_BIG if the block is bigger than a page, NO_ROOM if all pages are full and used in this frame
+	int allocate(int width, int height, glm::ivec2& position)
+	{
+		if (width > PAGE_SIZE || height > PAGE_SIZE)
+			return TOO_BIG;
+
+		for (unsigned int i = 0; i < _pages.size(); i++)
+		{
+			Page& page = _pages[i];
+			if (page._penX + width > PAGE_SIZE)
+			{
+				//Next shelf
+				page._shelfY += page._shelfHeight;
+				page._shelfHeight = 0;
+				page._penX = 0;
+			}
+
+			if (page._shelfY + height <= PAGE_SIZE)
+			{
+				position = glm::ivec2(page._penX, page._shelfY);
+				page._penX += width;
+				page._shelfHeight = std::max(page._shelfHeight, height);
+				page._lastUsedFrame = _frame;
+				return (int)i;
+			}
+		}
+
+		//All pages are full -> a new one or the least recently used one gets emptied
+		unsigned int index;
+		if (_pages.size() < MAX_PAGES)
+		{
+			index = (unsigned int)_pages.size();
+			_pages.emplace_back();
+			Page& page = _pages.back();
+
+			std::vector<unsigned char> empty(PAGE_SIZE * PAGE_SIZE, 0);
+			GLCall(glGenTextures(1, &page._texture));
+			GLCall(glBindTexture(GL_TEXTURE_2D, page._texture));
+			GLCall(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+			GLCall(glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, PAGE_SIZE, PAGE_SIZE, 0, GL_RED, GL_UNSIGNED_BYTE, &empty[0]));
+			GLCall(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+			GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE));
+			GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE));
+			GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR));
+			GLCall(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR));
+			GLCall(glBindTexture(GL_TEXTURE_2D, 0));
+		}
+		else
+		{
+			//Glyphs of pages used in this frame can still be in layouts that get drawn
+			index = MAX_PAGES;
+			for (unsigned int i = 0; i < _pages.size(); i++)
+			{
+				if (_pages[i]._lastUsedFrame != _frame && (index == MAX_PAGES || _pages[i]._lastUsedFrame < _pages[index]._lastUsedFrame))
+					index = i;
+			}
+			if (index == MAX_PAGES)
+				return NO_ROOM;
+			evictPage(index);
+		}
+
+		Page& page = _pages[index];
+		position = glm::ivec2(0, 0);
+		page._penX = width;
+		page._shelfHeight = height;
+		page._lastUsedFrame = _frame;
+		return (int)index;
+	}
+
+	//Packs a rasterized glyph into a page and uploads just its block
+	//Returns nullptr if there's no room in this frame (the glyph has to be inserted again in a later frame)
+	const Glyph* insert(Rasterized& rasterized)
+	{
+		//The block includes the padding -> the texels around the glyph get cleared as well (the page can hold an evicted glyph there)
+		const Glyph& rasterizedGlyph = rasterized._glyph;
+		int width = rasterizedGlyph._size.x + 2 * PADDING, height = rasterizedGlyph._size.y + 2 * PADDING;
+		glm::ivec2 position;
+		int page = rasterizedGlyph._size.x == 0 || rasterizedGlyph._size.y == 0 ? -1 : allocate(width, height, position);
+		if (page == NO_ROOM)
+			return nullptr;
+
+		Glyph& glyph = _glyphs[rasterized._key];
+		glyph = rasterizedGlyph;
+		if (page == -1)
+			return &glyph;
+		if (page == TOO_BIG)
+		{
+			spdlog::error("Glyph U+{:04X} at {} px doesn't fit into an atlas page", (uint32_t)rasterized._key, (unsigned int)(rasterized._key >> 32));
+			glyph._size = glm::ivec2(0);
+			return &glyph;
+		}
+
+		_uploadBuffer.assign(width * height, 0);
+		for (int row = 0; row < glyph._size.y; row++)
+			std::memcpy(&_uploadBuffer[(row + PADDING) * width + PADDING], &rasterized._pixels[row * glyph._size.x], glyph._size.x);
+
+		GLCall(glBindTexture(GL_TEXTURE_2D, _pages[page]._texture));
+		GLCall(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+		GLCall(glTexSubImage2D(GL_TEXTURE_2D, 0, position.x, position.y, width, height, GL_RED, GL_UNSIGNED_BYTE, &_uploadBuffer[0]));
+		GLCall(glPixelStorei(GL_UNPACK_ALIGNMENT, 4));
+		GLCall(glBindTexture(GL_TEXTURE_2D, 0));
+
+		glyph._page = page;
+		glyph._uvMin = glm::vec2(position + PADDING) / (float)PAGE_SIZE;
+		glyph._uvMax = glm::vec2(position + PADDING + glyph._size) / (float)PAGE_SIZE;
+		return &glyph;
+	}
+
+public:
+	GlyphCache(bool asyncRasterization = true)
+		: _async(asyncRasterization)
+	{
+
+	}
+
+	~GlyphCache()
+	{
+		stopWorker();
+
+		for (Page& page : _pages)
+		{
+			GLCall(glDeleteTextures(1, &page._texture));
+		}
+
+		if (_face)
+			FT_Done_Face(_face);
+		if (_library)
+			FT_Done_FreeType(_library);
+	}
+
+	//Opens the font, rasterizes nothing yet
+	bool loadFont(const std::string& font)
+	{
+		stopWorker();
+		clear();
+
+		if (!_library && FT_Init_FreeType(&_library))
+		{
+			spdlog::error("Could not init FreeType Library");
+			_library = nullptr;
+			return false;
+		}
+
+		if (_face)
+			FT_Done_Face(_face);
+		_face = nullptr;
+		_facePixelSize = 0;
+
+		if (FT_New_Face(_library, font.c_str(), 0, &_face))
+		{
+			spdlog::error("Failed to load font: {}", font);
+			_face = nullptr;
+			return false;
+		}
+
+		startWorker();
+		spdlog::info("Font loaded successfully: {}", font);
+		return true;
+	}
+
+	//Forgets all glyphs, the pages stay allocated and count up their generation
+	void clear()
+	{
+		_glyphs.clear();
+		for (unsigned int i = 0; i < _pages.size(); i++)
+			evictPage(i);
+	}
+
+	//The glyph or nullptr if it's still being rasterized on the worker (then it's there after one of the next update() calls)
+	//The page of the glyph counts as used in this frame -> it stays valid until the next update()
+	//The pointer stays valid until the next getGlyph() or update()
+	const Glyph* getGlyph(uint32_t codepoint, unsigned int pixelSize)
+	{
+		uint64_t key = makeKey(codepoint, pixelSize);
+		std::unordered_map<uint64_t, Glyph>::const_iterator it = _glyphs.find(key);
+		if (it != _glyphs.end())
+		{
+			if (it->second._page >= 0)
+				touchPage(it->second._page);
+			return &it->second;
+		}
+
+		if (!_face)
+			return nullptr;
+
+		if (!_async)
+		{
+			Rasterized rasterized;
+			rasterize(key, rasterized);
+			return insert(rasterized);
+		}
+
+		if (_pending.insert(key).second)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_requests.push_back(key);
+			_wakeUp.notify_one();
+		}
+		return nullptr;
+	}
+
+	//Uploads the glyphs the worker finished since the last call, once per frame
+	void update()
+	{
+		_frame++;
+		if (!_async)
+			return;
+
+		std::vector<Rasterized> finished;
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			finished.swap(_finished);
+		}
+
+		//Glyphs without room in this frame get inserted in the next one
+		std::vector<Rasterized> deferred;
+		for (Rasterized& rasterized : finished)
+		{
+			if (insert(rasterized))
+				_pending.erase(rasterized._key);
+			else
+				deferred.push_back(std::move(rasterized));
+		}
+
+		if (!deferred.empty())
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			std::move(deferred.begin(), deferred.end(), std::back_inserter(_finished));
+		}
+	}
+
+	//Marks the page as used in this frame -> it's the last one to get evicted
+	void touchPage(int page)
+	{
+		_pages[page]._lastUsedFrame = _frame;
+	}
+
+	unsigned int getPageTexture(int page) const
+	{
+		return _pages[page]._texture;
+	}
+
+	unsigned int getPageGeneration(int page) const
+	{
+		return _pages[page]._generation;
+	}
+
+	unsigned int getGlyphCount() const
+	{
+		return (unsigned int)_glyphs.size();
+	}
+
+	unsigned int getPageCount() const
+	{
+		return (unsigned int)_pages.size();
+	}
+
+	unsigned int getPendingCount() const
+	{
+		return (unsigned int)_pending.size();
+	}
+
+	unsigned int getEvictions() const
+	{
+		return _evictions;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+//Level files hold a grid of tile codes (0 = empty, 1 = solid, 2+ = coloured bricks) in one of two formats:
+//- Text: the numbers of a row separated by spaces, one row per line (basic.level)
+//- Binary: LevelFileHeader followed by run length encoded tiles, row by row -> a few bytes for the empty and repeated areas of big levels
+//Both get read in one pass over the bytes (e.g. of a MappedFile) without allocations, the tiles go straight to a builder:
+//   builder.begin(columns, maxTiles) -> builder.tiles(x, y, count, code) for every span of equal tiles in a row that aren't empty -> builder.end(rows)
+struct LevelFileHeader
+{
+	char _magic[4]; //"BLVL"
+	uint32_t _version;
+	uint32_t _columns, _rows;
+	uint32_t _runs; //Number of runs behind the header
+};
+
+class LevelFile
+{
+public:
+	static const uint32_t VERSION = 1;
+
+	//A run is one uint32: tile code in the upper 8 bits, number of tiles in the lower 24 (little endian like the header)
+	static const uint32_t MAX_RUN_LENGTH = 0xFFFFFF;
+
+	static bool isBinary(const char* data, size_t size)
+	{
+		return size >= sizeof(LevelFileHeader) && std::memcmp(data, "BLVL", 4) == 0;
+	}
+
+	//Picks the format by the magic at the start of the data
+	template<typename Builder>
+	static bool read(const char* data, size_t size, Builder& builder)
+	{
+		if (isBinary(data, size))
+			return readBinary(data, size, builder);
+		return readText(data, size, builder);
+	}
+
+	//The first line with numbers sets the number of columns, numbers behind that in longer lines are ignored
+	//Blank lines don't count as rows, codes above 255 become 255
+	template<typename Builder>
+	static bool readText(const char* data, size_t size, Builder& builder)
+	{
+		const char* c = data;
+		const char* end = data + size;
+
+		//Columns = numbers in the first row
+		while (c != end && (*c == ' ' || *c == '\t' || *c == '\r' || *c == '\n'))
+			c++;
+		unsigned int columns = 0;
+		for (const char* line = c; line != end && *line != '\n'; )
+		{
+			if (*line >= '0' && *line <= '9')
+			{
+				columns++;
+				while (line != end && *line >= '0' && *line <= '9')
+					line++;
+			}
+			else
+				line++;
+		}
+
+		if (columns == 0)
+		{
+			spdlog::error("ERROR! LEVEL HAS NO TILES!");
+			return false;
+		}
+
+		//Every tile takes at least two characters
+		builder.begin(columns, (unsigned int)std::min<size_t>((size_t)(end - c) / 2 + 1, 0xFFFFFFFF));
+
+		//Equal neighbours of a row go to the builder as one span
+		unsigned int x = 0, y = 0;
+		unsigned int spanX = 0, spanCount = 0, spanCode = 0;
+		while (c != end)
+		{
+			const char character = *c;
+			if (character >= '0' && character <= '9')
+			{
+				unsigned int code = 0;
+				while (c != end && *c >= '0' && *c <= '9')
+				{
+					code = std::min(code * 10 + (unsigned int)(*c - '0'), 255u);
+					c++;
+				}
+
+				if (x < columns)
+				{
+					if (code != spanCode)
+					{
+						if (spanCode != 0)
+							builder.tiles(spanX, y, spanCount, spanCode);
+						spanX = x;
+						spanCount = 0;
+						spanCode = code;
+					}
+					spanCount++;
+				}
+				x++;
+			}
+			else if (character == '\n')
+			{
+				if (spanCode != 0)
+					builder.tiles(spanX, y, spanCount, spanCode);
+				spanCode = 0;
+
+				if (x > 0)
+					y++;
+				x = 0;
+				c++;
+			}
+			else if (character == ' ' || character == '\t' || character == '\r')
+				c++;
+			else
+			{
+				spdlog::error("ERROR! UNEXPECTED CHARACTER '{}' IN LEVEL (ROW {})!", character, y + 1);
+				return false;
+			}
+		}
+
+		if (spanCode != 0)
+			builder.tiles(spanX, y, spanCount, spanCode);
+		builder.end(x > 0 ? y + 1 : y);
+		return true;
+	}
+
+	template<typename Builder>
+	static bool readBinary(const char* data, size_t size, Builder& builder)
+	{
+		LevelFileHeader header;
+		if (!isBinary(data, size))
+		{
+			spdlog::error("ERROR! NOT A BINARY LEVEL!");
+			return false;
+		}
+		std::memcpy(&header, data, sizeof(header));
+
+		if (header._version != VERSION || header._columns == 0 || size != sizeof(header) + (size_t)header._runs * sizeof(uint32_t))
+		{
+			spdlog::error("ERROR! BROKEN BINARY LEVEL (VERSION {}, {} RUNS, {} BYTES)!", header._version, header._runs, size);
+			return false;
+		}
+
+		//Runs are 4 byte aligned behind the 20 byte header, memcpy keeps it legal for any buffer
+		const char* runs = data + sizeof(header);
+		const uint64_t cells = (uint64_t)header._columns * header._rows;
+
+		//Bricks = tiles of the runs that aren't empty
+		uint64_t tiles = 0;
+		for (uint32_t i = 0; i < header._runs; i++)
+		{
+			uint32_t run;
+			std::memcpy(&run, runs + i * sizeof(uint32_t), sizeof(run));
+			if ((run >> 24) != 0)
+				tiles += run & MAX_RUN_LENGTH;
+		}
+		builder.begin(header._columns, (unsigned int)std::min<uint64_t>(tiles, cells));
+
+		uint64_t cell = 0;
+		for (uint32_t i = 0; i < header._runs && cell < cells; i++)
+		{
+			uint32_t run;
+			std::memcpy(&run, runs + i * sizeof(uint32_t), sizeof(run));
+			const unsigned int code = run >> 24;
+			const uint64_t length = std::min<uint64_t>(run & MAX_RUN_LENGTH, cells - cell);
+
+			//Runs can wrap around the end of a row
+			unsigned int x = (unsigned int)(cell % header._columns), y = (unsigned int)(cell / header._columns);
+			for (uint64_t left = length; code != 0 && left > 0; x = 0, y++)
+			{
+				unsigned int count = (unsigned int)std::min<uint64_t>(left, header._columns - x);
+				builder.tiles(x, y, count, code);
+				left -= count;
+			}
+			cell += length;
+		}
+
+		if (cell != cells)
+			spdlog::warn("Binary level ends after {} of {} tiles", cell, cells);
+
+		builder.end(header._rows);
+		return true;
+	}
+
+	//tiles = columns * rows codes row by row
+	static bool writeBinary(const char* filepath, const unsigned char* tiles, unsigned int columns, unsigned int rows)
+	{
+		std::vector<uint32_t> runs;
+		const uint64_t cells = (uint64_t)columns * rows;
+		for (uint64_t cell = 0; cell < cells; )
+		{
+			const unsigned char code = tiles[cell];
+			uint64_t length = 1;
+			while (cell + length < cells && tiles[cell + length] == code && length < MAX_RUN_LENGTH)
+				length++;
+
+			runs.push_back(((uint32_t)code << 24) | (uint32_t)length);
+			cell += length;
+		}
+
+		LevelFileHeader header = { { 'B', 'L', 'V', 'L' }, VERSION, columns, rows, (uint32_t)runs.size() };
+
+		FILE* file = std::fopen(filepath, "wb");
+		if (!file)
+		{
+			spdlog::error("Unable to open file! | Path: {}", filepath);
+			return false;
+		}
+
+		bool written = std::fwrite(&header, sizeof(header), 1, file) == 1;
+		if (!runs.empty())
+			written = written && std::fwrite(&runs[0], sizeof(uint32_t), runs.size(), file) == runs.size();
+		std::fclose(file);
+
+		if (!written)
+			spdlog::error("Unable to write level! | Path: {}", filepath);
+		return written;
+	}
+};
\ No newline at end of file
@@ -57,7 +57,7 @@ public:
 	//Render all PowerUps
 	void renderPowerUps()
 	{
-		for (PowerUpObject power : _powerUpsToRender)
+		for (PowerUpObject& power : _powerUpsToRender)
 		{
 			power.Draw();
 		}
@@ -1,162 +1,301 @@
 #pragma once
 
-#include <ft2build.h>
-#include <iostream>
-#include <map>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include <glm/vec2.hpp>
+#include <spdlog/spdlog.h>
 #include "OpenGLErrorManager.hpp"
 #include "Shader.hpp"
+#include "GlyphCache.hpp"
 
-#include FT_FREETYPE_H
-
-// Holds all state information relevant to a character as loaded using FreeType
-struct Character {
-    unsigned int TextureID; // ID handle of the glyph texture
-    glm::ivec2   Size;      // size of glyph
-    glm::ivec2   Bearing;   // offset from baseline to left/top of glyph
-    unsigned int Advance;   // horizontal offset to advance to next glyph
+// One corner of a glyph quad, relative to the start of the string
+struct TextVertex {
+    glm::vec2 Position;
+    glm::vec2 TexCoords;
 };
 
+// Draws UTF-8 strings with one draw call per atlas page they use (normally one):
+// - glyphs come from a GlyphCache -> rasterized on a worker thread the first time they show up, at any pixel size
+// - every string gets laid out once into a shared vertex buffer, the layout is cached by its text, scale and pixel size
+//   -> strings that didn't change since the last frame (HUD) cost one draw call and no layout
+// - position and colour are uniforms, a cached layout can be drawn anywhere in any colour
+// - strings with glyphs that are still being rasterized get drawn without them and laid out again in the next frame
 class TextRenderer
 {
+private:
+    static const unsigned int MAX_VERTICES = 6 * 16384; // Size of the layout buffer, it gets cleared once it's full
+
+    // Vertices of a layout that use one atlas page
+    struct PageRange {
+        int Page;
+        unsigned int Generation; // The range is stale once the page got evicted
+        unsigned int First, Count;
+    };
+
+    struct Layout {
+        std::string Text;
+        float Scale;
+        unsigned int PixelSize;
+        std::vector<PageRange> Ranges;
+    };
+
+    GlyphCache _glyphCache;
+    unsigned int _pixelSize = 0; // Size of RenderText() calls without one
+
+    // A layout per text hash, the text gets compared on a hit
+    std::unordered_map<uint64_t, Layout> _layouts;
+    Layout _uncachedLayout; // Layout of a string with missing glyphs, only used for one draw
+    std::vector<std::vector<TextVertex>> _pageVertices; // Scratch buffers of a new layout
+    std::vector<unsigned int> _pageGenerations; // Generation of every page when its first glyph of the new layout got fetched
+    unsigned int _usedVertices = 0;
+    unsigned int _drawCalls = 0, _layoutsBuilt = 0;
+
+    static uint64_t hashText(const char* text, float scale, unsigned int pixelSize)
+    {
+        // FNV-1a over the characters, the scale and the pixel size
+        uint64_t hash = 14695981039346656037ull;
+        for (const char* c = text; *c != '\0'; c++)
+            hash = (hash ^ (unsigned char)*c) * 1099511628211ull;
+
+        uint32_t scaleBits;
+        std::memcpy(&scaleBits, &scale, sizeof(scaleBits));
+        hash = (hash ^ scaleBits) * 1099511628211ull;
+        return (hash ^ pixelSize) * 1099511628211ull;
+    }
+
+    // Next codepoint of a UTF-8 string, invalid sequences become U+FFFD
+    static uint32_t decodeUtf8(const char*& text)
+    {
+        unsigned char lead = (unsigned char)*text++;
+        if (lead < 0x80)
+            return lead;
+
+        int length;
+        uint32_t codepoint;
+        if ((lead & 0xE0) == 0xC0)      { length = 1; codepoint = lead & 0x1F; }
+        else if ((lead & 0xF0) == 0xE0) { length = 2; codepoint = lead & 0x0F; }
+        else if ((lead & 0xF8) == 0xF0) { length = 3; codepoint = lead & 0x07; }
+        else
+            return 0xFFFD;
+
+        for (int i = 0; i < length; i++)
+        {
+            unsigned char next = (unsigned char)*text;
+            if ((next & 0xC0) != 0x80) // also stops at the terminating 0
+                return 0xFFFD;
+            codepoint = (codepoint << 6) | (next & 0x3F);
+            text++;
+        }
+        return codepoint;
+    }
+
+    bool isValid(const Layout& layout) const
+    {
+        for (const PageRange& range : layout.Ranges)
+        {
+            if (_glyphCache.getPageGeneration(range.Page) != range.Generation)
+                return false;
+        }
+        return true;
+    }
+
+    // Lays out the text into the layout buffer, clears the cache first if the buffer is full
+    // Strings with glyphs that aren't rasterized yet don't get cached
+    const Layout& buildLayout(uint64_t hash, const char* text, float scale, unsigned int pixelSize)
+    {
+        for (std::vector<TextVertex>& vertices : _pageVertices)
+            vertices.clear();
+
+        // the top of the string lines up with the top of capital letters
+        const GlyphCache::Glyph* capital = _glyphCache.getGlyph('H', pixelSize);
+        bool complete = capital != nullptr;
+        float ascent = capital ? (float)capital->_bearing.y : 0.0f;
+
+        float x = 0.0f;
+        for (const char* c = text; *c != '\0';)
+        {
+            const GlyphCache::Glyph* ch = _glyphCache.getGlyph(decodeUtf8(c), pixelSize);
+            if (!ch)
+            {
+                complete = false;
+                continue;
+            }
+
+            float xpos = x + ch->_bearing.x * scale;
+            float ypos = (ascent - ch->_bearing.y) * scale;
+            float w = ch->_size.x * scale;
+            float h = ch->_size.y * scale;
+
+            if (ch->_page >= 0)
+            {
+                TextVertex quad[6] = {
+                    { glm::vec2(xpos,     ypos + h), glm::vec2(ch->_uvMin.x, ch->_uvMax.y) },
+                    { glm::vec2(xpos + w, ypos),     glm::vec2(ch->_uvMax.x, ch->_uvMin.y) },
+                    { glm::vec2(xpos,     ypos),     ch->_uvMin },
+
+                    { glm::vec2(xpos,     ypos + h), glm::vec2(ch->_uvMin.x, ch->_uvMax.y) },
+                    { glm::vec2(xpos + w, ypos + h), ch->_uvMax },
+                    { glm::vec2(xpos + w, ypos),     glm::vec2(ch->_uvMax.x, ch->_uvMin.y) }
+                };
+                if (_pageVertices.size() <= (size_t)ch->_page)
+                {
+                    _pageVertices.resize(ch->_page + 1);
+                    _pageGenerations.resize(ch->_page + 1);
+                }
+                if (_pageVertices[ch->_page].empty())
+                    _pageGenerations[ch->_page] = _glyphCache.getPageGeneration(ch->_page);
+                _pageVertices[ch->_page].insert(_pageVertices[ch->_page].end(), quad, quad + 6);
+            }
+
+            // now advance cursors for next glyph
+            x += (ch->_advance >> 6) * scale; // bitshift by 6 to get value in pixels (1/64th times 2^6 = 64)
+        }
+
+        unsigned int count = 0;
+        for (const std::vector<TextVertex>& vertices : _pageVertices)
+            count += (unsigned int)vertices.size();
+        count = std::min(count, MAX_VERTICES);
+
+        if (_usedVertices + count > MAX_VERTICES)
+        {
+            // Orphan the buffer, all cached layouts have to be built again
+            _layouts.clear();
+            _usedVertices = 0;
+            GLCall(glBindBuffer(GL_ARRAY_BUFFER, this->VBO));
+            GLCall(glBufferData(GL_ARRAY_BUFFER, MAX_VERTICES * sizeof(TextVertex), nullptr, GL_DYNAMIC_DRAW));
+        }
+
+        Layout& layout = complete ? _layouts[hash] : _uncachedLayout;
+        layout.Text = complete ? text : "";
+        layout.Scale = scale;
+        layout.PixelSize = pixelSize;
+        layout.Ranges.clear();
+
+        GLCall(glBindBuffer(GL_ARRAY_BUFFER, this->VBO));
+        for (int page = 0; page < (int)_pageVertices.size(); page++)
+        {
+            unsigned int pageCount = std::min((unsigned int)_pageVertices[page].size(), MAX_VERTICES - _usedVertices);
+            if (pageCount == 0)
+                continue;
+
+            GLCall(glBufferSubData(GL_ARRAY_BUFFER, _usedVertices * sizeof(TextVertex), pageCount * sizeof(TextVertex), &_pageVertices[page][0]));
+            layout.Ranges.push_back({ page, _pageGenerations[page], _usedVertices, pageCount });
+            _usedVertices += pageCount;
+        }
+        GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
+
+        _layoutsBuilt++;
+        return layout;
+    }
+
 public:
-    // holds a list of pre-compiled Characters
-    std::map<char, Character> Characters;
-	
     // shader used for text rendering
     Shader* TextShader = nullptr;
-	
+
     // render state
     unsigned int VAO, VBO;
     glm::mat4 _projectionMatrix;
-	
-    TextRenderer(Shader* shader, glm::mat4 projectionMatrix)
-	    : TextShader(shader), _projectionMatrix(projectionMatrix)
+
+    // asyncRasterization = rasterize new glyphs on a worker thread instead of in RenderText()
+    TextRenderer(Shader* shader, glm::mat4 projectionMatrix, bool asyncRasterization = true)
+	    : _glyphCache(asyncRasterization), TextShader(shader), _projectionMatrix(projectionMatrix)
     {
         init();
     }
 
+    ~TextRenderer()
+    {
+        GLCall(glDeleteBuffers(1, &this->VBO));
+        GLCall(glDeleteVertexArrays(1, &this->VAO));
+    }
+
     void init()
     {
-        // configure VAO/VBO for texture quads
-        glGenVertexArrays(1, &this->VAO);
-        glGenBuffers(1, &this->VBO);
-        glBindVertexArray(this->VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+        // configure VAO/VBO for the layouts of all strings
+        GLCall(glGenVertexArrays(1, &this->VAO));
+        GLCall(glGenBuffers(1, &this->VBO));
+        GLCall(glBindVertexArray(this->VAO));
+        GLCall(glBindBuffer(GL_ARRAY_BUFFER, this->VBO));
+        GLCall(glBufferData(GL_ARRAY_BUFFER, MAX_VERTICES * sizeof(TextVertex), NULL, GL_DYNAMIC_DRAW));
+        GLCall(glEnableVertexAttribArray(0));
+        GLCall(glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(TextVertex), 0));
+        GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
+        GLCall(glBindVertexArray(0));
     }
-	
+
+    // Opens the font, the glyphs get rasterized when they are used
+    // fontSize = pixel size of RenderText() calls without one
     void Load(std::string font, unsigned int fontSize)
     {
-        // first clear the previously loaded Characters
-        this->Characters.clear();
-        // then initialize and load the FreeType library
-        FT_Library ft;
-        if (FT_Init_FreeType(&ft)) // all functions return a value different than 0 whenever an error occurred
-            std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
-        // load font as face
-        FT_Face face;
-        if (FT_New_Face(ft, font.c_str(), 0, &face))
-            std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
-        // set size to load glyphs as
-        FT_Set_Pixel_Sizes(face, 0, fontSize);
-        // disable byte-alignment restriction
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-        // then for the first 128 ASCII characters, pre-load/compile their characters and store them
-        for (GLubyte c = 0; c < 128; c++) // lol see what I did there 
-        {
-            // load character glyph 
-            if (FT_Load_Char(face, c, FT_LOAD_RENDER))
-            {
-                std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
-                continue;
-            }
-            // generate texture
-            unsigned int texture;
-            glGenTextures(1, &texture);
-            glBindTexture(GL_TEXTURE_2D, texture);
-            glTexImage2D(
-                GL_TEXTURE_2D,
-                0,
-                GL_RED,
-                face->glyph->bitmap.width,
-                face->glyph->bitmap.rows,
-                0,
-                GL_RED,
-                GL_UNSIGNED_BYTE,
-                face->glyph->bitmap.buffer
-            );
-            // set texture options
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-            // now store character for later use
-            Character character = {
-                texture,
-                glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-                glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-                face->glyph->advance.x
-            };
-            Characters.insert(std::pair<char, Character>(c, character));
-        }
-        glBindTexture(GL_TEXTURE_2D, 0);
-        // destroy FreeType once we're finished
-        FT_Done_Face(face);
-        FT_Done_FreeType(ft);
+        // the layouts of the previous font are useless now
+        _layouts.clear();
+        _usedVertices = 0;
+
+        _pixelSize = fontSize;
+        _glyphCache.loadFont(font);
+    }
+
+    // Uploads the glyphs the worker rasterized since the last frame and resets the statistics, once per frame before the text
+    void update()
+    {
+        _glyphCache.update();
+        _drawCalls = 0;
+        _layoutsBuilt = 0;
     }
 
-    void RenderText(std::string text, float x, float y, float scale, glm::vec3 color)
+    // text = UTF-8, pixelSize 0 = size of Load()
+    void RenderText(const char* text, float x, float y, float scale, const glm::vec3& color, unsigned int pixelSize = 0)
     {
-        // activate corresponding render state	
+        if (pixelSize == 0)
+            pixelSize = _pixelSize;
+
+        // cached layout of the same text, scale and size or a new one
+        uint64_t hash = hashText(text, scale, pixelSize);
+        std::unordered_map<uint64_t, Layout>::const_iterator cached = _layouts.find(hash);
+        bool hit = cached != _layouts.end() && cached->second.Scale == scale && cached->second.PixelSize == pixelSize && cached->second.Text == text && isValid(cached->second);
+        const Layout& layout = hit ? cached->second : buildLayout(hash, text, scale, pixelSize);
+        if (layout.Ranges.empty())
+            return;
+
+        // activate corresponding render state
         TextShader->bind();
 
     	// set uniforms
         TextShader->SetUniformVec3("textColor", color);
         TextShader->SetUniformMat4f("projection", _projectionMatrix);
-        
-        glActiveTexture(GL_TEXTURE0);
-        glBindVertexArray(this->VAO);
+        TextShader->SetUniform2f("offset", x, y);
 
-        // iterate through all characters
-        std::string::const_iterator c;
-        for (c = text.begin(); c != text.end(); c++)
+        // render the string with one call per atlas page
+        GLCall(glActiveTexture(GL_TEXTURE0));
+        GLCall(glBindVertexArray(this->VAO));
+        for (const PageRange& range : layout.Ranges)
         {
-            Character ch = Characters[*c];
-
-            float xpos = x + ch.Bearing.x * scale;
-            float ypos = y + (this->Characters['H'].Bearing.y - ch.Bearing.y) * scale;
-
-            float w = ch.Size.x * scale;
-            float h = ch.Size.y * scale;
-            // update VBO for each character
-            float vertices[6][4] = {
-                { xpos,     ypos + h,   0.0f, 1.0f },
-                { xpos + w, ypos,       1.0f, 0.0f },
-                { xpos,     ypos,       0.0f, 0.0f },
-
-                { xpos,     ypos + h,   0.0f, 1.0f },
-                { xpos + w, ypos + h,   1.0f, 1.0f },
-                { xpos + w, ypos,       1.0f, 0.0f }
-            };
-            // render glyph texture over quad
-            glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-            // update content of VBO memory
-            glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-            glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // be sure to use glBufferSubData and not glBufferData
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
-            // render quad
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-            // now advance cursors for next glyph
-            x += (ch.Advance >> 6) * scale; // bitshift by 6 to get value in pixels (1/64th times 2^6 = 64)
+            _glyphCache.touchPage(range.Page);
+            GLCall(glBindTexture(GL_TEXTURE_2D, _glyphCache.getPageTexture(range.Page)));
+            GLCall(glDrawArrays(GL_TRIANGLES, range.First, range.Count));
+            _drawCalls++;
         }
-        glBindVertexArray(0);
-        glBindTexture(GL_TEXTURE_2D, 0);
+        GLCall(glBindVertexArray(0));
+        GLCall(glBindTexture(GL_TEXTURE_2D, 0));
+    }
+
+    unsigned int getDrawCalls() const
+    {
+        return _drawCalls;
+    }
+
+    // Strings that had to be laid out since update(), 0 for a frame with only cached strings
+    unsigned int getLayoutsBuilt() const
+    {
+        return _layoutsBuilt;
+    }
+
+    const GlyphCache& getGlyphCache() const
+    {
+        return _glyphCache;
     }
 };
\ No newline at end of file
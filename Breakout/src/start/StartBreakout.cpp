@@ -1,5 +1,7 @@
 #define DEBUG
+//FRAME_ALLOCATION_TRACKING in the preprocessor definitions of the project counts heap allocations per frame and warns about every frame that allocates
 
+#include "AllocationTracker.hpp"
 #include "GameDisplayManager.hpp"
 
 #ifdef DEBUG
@@ -8,8 +10,24 @@
 	#include <imgui/imgui_impl_opengl3.h>
 #endif
 
-int main()
+int main(int argc, char* argv[])
 {	
+	//Command line options
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+
+		//Write a level as a binary level instead of starting the game
+		if (arg == "--convert-level" && i + 2 < argc)
+			return GameLevelCreator::convertLevel(argv[i + 1], argv[i + 2]) ? 0 : 1;
+		//Text or binary level
+		else if (arg == "--level" && i + 1 < argc)
+			LEVEL_FILE = argv[++i];
+		//Random level with this many bricks (e.g. 100000)
+		else if (arg == "--bricks" && i + 1 < argc)
+			GENERATED_BRICKS = (unsigned int)std::max(1, std::atoi(argv[++i]));
+	}
+
 	//Display-Management
 	GameDisplayManager gameDisplayManager(WIDTH, HEIGHT);
 	gameDisplayManager.printVersion();
@@ -63,6 +81,16 @@ int main()
 			ImGui::Text("Sticky: %d", ACTIVE_STICKY_EFFECTS);
 			ImGui::Text("PassThrough: %d", ACTIVE_PASSTHROUGH_EFFECTS);
 			ImGui::Text("PadIncrease: %d", ACTIVE_PADINREASE_EFFECTS);
+			ImGui::Text("Sprites: %d in %d draw calls", breakout._spriteRenderer->getSpriteBatch()->getSpriteCount(), breakout._spriteRenderer->getSpriteBatch()->getDrawCalls());
+			ImGui::Text("Text: %d draw calls, %d new layouts", breakout._textRenderer->getDrawCalls(), breakout._textRenderer->getLayoutsBuilt());
+			ImGui::Text("Glyphs: %d in %d atlas pages (%d rasterizing, %d evictions)", breakout._textRenderer->getGlyphCache().getGlyphCount(), breakout._textRenderer->getGlyphCache().getPageCount(),
+				breakout._textRenderer->getGlyphCache().getPendingCount(), breakout._textRenderer->getGlyphCache().getEvictions());
+			ImGui::Text("Bricks: %d / %d (%s circle tests)", breakout._gameLevelCreator->_bricks.getLiveCount(), breakout._gameLevelCreator->_bricks.getCount(), breakout._gameLevelCreator->_bricks.usesSimd() ? "AVX2" : "scalar");
+			ImGui::Text("Balls: %d, %d brick tests in %.3f ms (%s)", 1 + (int)breakout._multiBalls.size(), breakout._brickTests, breakout._collisionTime, breakout._bruteForceCollisions ? "all bricks" : "grid");
+			ImGui::Text("Particles: %d / %d (%s)", breakout._particleSystem->getCount(), breakout._particleSystem->getCapacity(), breakout._particleSystem->usesSimd() ? "AVX2" : "scalar");
+			ImGui::Text("Frame arena: %d KB", (int)(FrameArena::get().getUsedBytes() / 1024));
+			if (AllocationTracker::isEnabled())
+				ImGui::Text("Heap allocations (last frame): %d", AllocationTracker::getLastFrameAllocations());
 			ImGui::End();
 		}
 		#endif
@@ -75,6 +103,10 @@ int main()
 			#endif
 			gameDisplayManager.updateDisplay();
 		}
+
+		//Release per-frame memory
+		FrameArena::get().reset();
+		AllocationTracker::endFrame();
 	}
 
 	//CleanUP Stuff
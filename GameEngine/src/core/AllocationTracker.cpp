@@ -0,0 +1,55 @@
+#include "AllocationTracker.hpp"
+#include <cstdlib>
+#include <new>
+
+#ifdef FRAME_ALLOCATION_TRACKING
+
+//Replace the global allocation functions so every new/delete in the program gets counted
+//Has to be in exactly one translation unit of the program -> this file is compiled by every project that uses the tracker
+void* operator new(size_t size)
+{
+	AllocationTracker::recordAllocation(size);
+
+	if (void* ptr = std::malloc(size ? size : 1))
+		return ptr;
+
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	AllocationTracker::recordAllocation(size);
+	return std::malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept
+{
+	return operator new(size, tag);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+	std::free(ptr);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <spdlog/spdlog.h>
+#include <atomic>
+#include <cstddef>
+
+//Debug mode that counts every global heap allocation per frame and flags frames that allocate
+//Activate it by defining FRAME_ALLOCATION_TRACKING in the preprocessor definitions of the project, the replaced new/delete live in AllocationTracker.cpp
+class AllocationTracker
+{
+private:
+	//Function-local statics -> one instance across all translation units, ready before the first allocation of any static initializer
+	struct State
+	{
+		std::atomic<unsigned long long> _allocations{ 0 };
+		std::atomic<unsigned long long> _bytes{ 0 };
+		unsigned int _frame = 0;
+		unsigned int _warmupFrames = 10;
+		unsigned int _lastFrameAllocations = 0;
+		unsigned long long _lastFrameBytes = 0;
+		unsigned int _allocatingFrames = 0;
+	};
+
+	static State& state()
+	{
+		static State s_State;
+		return s_State;
+	}
+
+public:
+	static void recordAllocation(size_t size)
+	{
+		State& s = state();
+		s._allocations.fetch_add(1, std::memory_order_relaxed);
+		s._bytes.fetch_add(size, std::memory_order_relaxed);
+	}
+
+	//Loading and the first few frames (driver, ImGui, lazily created caches) are allowed to allocate
+	static void setWarmupFrames(unsigned int frames)
+	{
+		state()._warmupFrames = frames;
+	}
+
+	//Call once per frame after everything else is done
+	static void endFrame()
+	{
+		State& s = state();
+		s._lastFrameAllocations = (unsigned int)s._allocations.exchange(0, std::memory_order_relaxed);
+		s._lastFrameBytes = s._bytes.exchange(0, std::memory_order_relaxed);
+
+		if (s._frame >= s._warmupFrames && s._lastFrameAllocations > 0)
+		{
+			s._allocatingFrames++;
+			spdlog::warn("Frame {} allocated {} times on the heap ({} bytes)", s._frame, s._lastFrameAllocations, s._lastFrameBytes);
+
+			//Don't count the allocations of the warning itself to the next frame
+			s._allocations.store(0, std::memory_order_relaxed);
+			s._bytes.store(0, std::memory_order_relaxed);
+		}
+
+		s._frame++;
+	}
+
+	static unsigned int getLastFrameAllocations()
+	{
+		return state()._lastFrameAllocations;
+	}
+
+	static unsigned long long getLastFrameBytes()
+	{
+		return state()._lastFrameBytes;
+	}
+
+	static unsigned int getAllocatingFrames()
+	{
+		return state()._allocatingFrames;
+	}
+
+	static bool isEnabled()
+	{
+		#ifdef FRAME_ALLOCATION_TRACKING
+			return true;
+		#else
+			return false;
+		#endif
+	}
+};
\ No newline at end of file
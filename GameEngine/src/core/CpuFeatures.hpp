@@ -0,0 +1,67 @@
+#pragma once
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#else
+	#include <cpuid.h>
+#endif
+
+//Functions with AVX2/FMA intrinsics need this in front -> GCC and Clang compile just these functions for AVX2, MSVC allows the intrinsics anywhere
+//Only call them after CpuFeatures::hasAvx2() returned true
+#if defined(_MSC_VER)
+	#define TARGET_AVX2
+#else
+	#define TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+
+//Instruction sets of the CPU the program runs on -> SIMD code gets picked at runtime instead of requiring AVX2 for the whole build
+class CpuFeatures
+{
+private:
+	static void cpuid(int leaf, int subleaf, unsigned int registers[4])
+	{
+		#if defined(_MSC_VER)
+			__cpuidex((int*)registers, leaf, subleaf);
+		#else
+			__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+		#endif
+	}
+
+	static unsigned long long xgetbv()
+	{
+		#if defined(_MSC_VER)
+			return _xgetbv(0);
+		#else
+			unsigned int eax, edx;
+			__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+			return ((unsigned long long)edx << 32) | eax;
+		#endif
+	}
+
+	static bool detectAvx2()
+	{
+		unsigned int registers[4] = {};
+		cpuid(0, 0, registers);
+		if (registers[0] < 7)
+			return false;
+
+		//FMA, OSXSAVE and AVX in leaf 1, the OS has to save the YMM registers as well
+		cpuid(1, 0, registers);
+		bool fma = (registers[2] & (1u << 12)) != 0;
+		bool osxsave = (registers[2] & (1u << 27)) != 0;
+		bool avx = (registers[2] & (1u << 28)) != 0;
+		if (!fma || !osxsave || !avx || (xgetbv() & 0x6) != 0x6)
+			return false;
+
+		cpuid(7, 0, registers);
+		return (registers[1] & (1u << 5)) != 0;
+	}
+
+public:
+	//AVX2 and FMA (always together on real CPUs), detected once
+	static bool hasAvx2()
+	{
+		static const bool s_Avx2 = detectAvx2();
+		return s_Avx2;
+	}
+};
\ No newline at end of file
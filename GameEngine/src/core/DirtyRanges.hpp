@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+//Collects dirty element indices in a bitset and turns them into a few coalesced ranges for buffer sub-uploads
+class DirtyRanges
+{
+public:
+	struct Range
+	{
+		unsigned int _begin, _end; //[begin, end)
+	};
+
+private:
+	std::vector<uint64_t> _bits;
+	std::vector<Range> _ranges;
+	unsigned int _dirtyCount = 0;
+
+	static unsigned int countTrailingZeros(uint64_t value)
+	{
+		#if defined(_MSC_VER)
+			unsigned long index;
+			_BitScanForward64(&index, value);
+			return (unsigned int)index;
+		#else
+			return (unsigned int)__builtin_ctzll(value);
+		#endif
+	}
+
+	static unsigned int popCount(uint64_t value)
+	{
+		#if defined(_MSC_VER)
+			return (unsigned int)__popcnt64(value);
+		#else
+			return (unsigned int)__builtin_popcountll(value);
+		#endif
+	}
+
+public:
+	DirtyRanges(unsigned int capacity = 0)
+	{
+		resize(capacity);
+	}
+
+	//Elements beyond the old capacity start clean
+	void resize(unsigned int capacity)
+	{
+		_bits.resize((capacity + 63) / 64, 0);
+	}
+
+	void mark(unsigned int index)
+	{
+		uint64_t& word = _bits[index / 64];
+		uint64_t bit = 1ull << (index % 64);
+
+		if (!(word & bit))
+		{
+			word |= bit;
+			_dirtyCount++;
+		}
+	}
+
+	//Marks [begin, end) word by word
+	void markRange(unsigned int begin, unsigned int end)
+	{
+		while (begin < end && begin % 64 != 0)
+			mark(begin++);
+
+		for (; begin + 64 <= end; begin += 64)
+		{
+			uint64_t& word = _bits[begin / 64];
+			_dirtyCount += 64 - popCount(word);
+			word = ~0ull;
+		}
+
+		while (begin < end)
+			mark(begin++);
+	}
+
+	bool empty() const
+	{
+		return _dirtyCount == 0;
+	}
+
+	unsigned int getDirtyCount() const
+	{
+		return _dirtyCount;
+	}
+
+	//Builds the ranges of all dirty elements in ascending order and clears the dirty state
+	//Ranges that are at most maxGap clean elements apart get merged, more than maxRanges ranges get merged into a single one (a few bigger uploads are cheaper than many small ones)
+	const std::vector<Range>& coalesce(unsigned int maxGap, unsigned int maxRanges)
+	{
+		_ranges.clear();
+		if (_dirtyCount == 0)
+			return _ranges;
+
+		for (size_t w = 0; w < _bits.size(); w++)
+		{
+			uint64_t word = _bits[w];
+			if (!word)
+				continue;
+
+			_bits[w] = 0;
+
+			//Walk all set bits of the word
+			while (word)
+			{
+				unsigned int index = (unsigned int)(w * 64) + countTrailingZeros(word);
+				word &= word - 1;
+
+				if (!_ranges.empty() && index <= _ranges.back()._end + maxGap)
+					_ranges.back()._end = index + 1;
+				else
+					_ranges.push_back({ index, index + 1 });
+			}
+		}
+
+		if (_ranges.size() > maxRanges)
+		{
+			Range merged = { _ranges.front()._begin, _ranges.back()._end };
+			_ranges.clear();
+			_ranges.push_back(merged);
+		}
+
+		_dirtyCount = 0;
+		return _ranges;
+	}
+};
\ No newline at end of file
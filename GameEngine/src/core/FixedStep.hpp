@@ -0,0 +1,78 @@
+#pragma once
+
+#include "CpuFeatures.hpp"
+#include <immintrin.h>
+#include <chrono>
+
+//Fixed substeps for the CPU simulations (SPH fluid, N-body) -> the result doesn't depend on the frame rate
+//Time that is left over goes to the next update, more than maxSubsteps per update get dropped (slow motion instead of a spiral of death when the CPU can't keep up)
+class FixedStep
+{
+private:
+	float _timeStep;
+	unsigned int _maxSubsteps;
+	float _accumulator = 0.0f;
+
+public:
+	FixedStep(float timeStep, unsigned int maxSubsteps)
+		: _timeStep(timeStep), _maxSubsteps(maxSubsteps)
+	{
+
+	}
+
+	//Calls step() for every whole timeStep in frameTime, returns the number of substeps
+	template<typename Step>
+	unsigned int update(float frameTime, const Step& step)
+	{
+		_accumulator += frameTime;
+
+		unsigned int substeps = 0;
+		while (_accumulator >= _timeStep && substeps < _maxSubsteps)
+		{
+			step();
+			_accumulator -= _timeStep;
+			substeps++;
+		}
+
+		//Time that didn't fit is dropped
+		if (substeps == _maxSubsteps)
+			_accumulator = 0.0f;
+
+		return substeps;
+	}
+
+	float getTimeStep() const
+	{
+		return _timeStep;
+	}
+
+	//ms since start, start moves on to now -> back to back calls time the phases of a step
+	static float elapsed(std::chrono::high_resolution_clock::time_point& start)
+	{
+		auto now = std::chrono::high_resolution_clock::now();
+		float ms = std::chrono::duration<float, std::milli>(now - start).count();
+		start = now;
+		return ms;
+	}
+};
+
+//Helpers of the 8 wide AVX2 kernels, only call them after CpuFeatures::hasAvx2() returned true
+class Simd8
+{
+public:
+	TARGET_AVX2 static float horizontalSum(__m256 value)
+	{
+		__m128 sum = _mm_add_ps(_mm256_castps256_ps128(value), _mm256_extractf128_ps(value, 1));
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+		return _mm_cvtss_f32(sum);
+	}
+
+	//1 / sqrt(x) from the approximate reciprocal square root with one Newton step (about 22 instead of 12 bits), every lane of x has to be > 0
+	TARGET_AVX2 static __m256 inverseSqrt(__m256 x)
+	{
+		const __m256 half = _mm256_set1_ps(0.5f), three = _mm256_set1_ps(3.0f);
+		__m256 inverse = _mm256_rsqrt_ps(x);
+		return _mm256_mul_ps(_mm256_mul_ps(half, inverse), _mm256_fnmadd_ps(_mm256_mul_ps(x, inverse), inverse, three));
+	}
+};
\ No newline at end of file
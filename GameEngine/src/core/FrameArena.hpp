@@ -0,0 +1,344 @@
+#pragma once
+
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//Linear allocator for data that only lives for one frame -> every allocation is a pointer bump, everything gets released at once via reset() at the end of the frame
+class FrameArena
+{
+private:
+	static const size_t DEFAULT_CAPACITY = 1024 * 1024;
+	static const size_t RESERVED_OVERFLOW_BLOCKS = 32;
+
+	char* _buffer = nullptr;
+	size_t _capacity, _offset, _peak;
+
+	//If a frame needs more than the capacity, the rest goes into overflow blocks (freed at reset, the main buffer gets grown to the peak size instead)
+	std::vector<char*> _overflowBlocks;
+	size_t _overflowBytes;
+
+	//Last allocation -> can be grown in place (used by the string builder)
+	char* _lastAllocation = nullptr;
+
+	static size_t alignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	//Callers write to the memory right away -> running out of memory aborts instead of returning nullptr
+	static char* allocateBlock(size_t size)
+	{
+		//malloc already returns memory aligned for every fundamental type
+		char* block = (char*)std::malloc(std::max(size, (size_t)1));
+		if (!block)
+		{
+			spdlog::critical("FrameArena: Out of memory, {} bytes requested", size);
+			std::abort();
+		}
+		return block;
+	}
+
+	void* allocateOverflow(size_t size)
+	{
+		char* block = allocateBlock(size);
+		_overflowBlocks.push_back(block);
+		_overflowBytes += size;
+		return block;
+	}
+
+public:
+	FrameArena(size_t capacity = DEFAULT_CAPACITY)
+		: _capacity(capacity), _offset(0), _peak(0), _overflowBytes(0)
+	{
+		_buffer = allocateBlock(_capacity);
+		_overflowBlocks.reserve(RESERVED_OVERFLOW_BLOCKS);
+	}
+
+	~FrameArena()
+	{
+		for (char* block : _overflowBlocks)
+			std::free(block);
+
+		std::free(_buffer);
+	}
+
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	//Arena of the calling thread
+	static FrameArena& get()
+	{
+		static thread_local FrameArena s_Arena;
+		return s_Arena;
+	}
+
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+	{
+		size_t start = alignUp(_offset, alignment);
+
+		if (start + size > _capacity)
+		{
+			_lastAllocation = nullptr;
+			_peak = std::max(_peak, _offset + _overflowBytes + size);
+			return allocateOverflow(size);
+		}
+
+		_offset = start + size;
+		_peak = std::max(_peak, _offset + _overflowBytes);
+		_lastAllocation = _buffer + start;
+		return _lastAllocation;
+	}
+
+	//Grow the last allocation without moving it (returns false if that isn't possible)
+	bool tryExtend(void* ptr, size_t oldSize, size_t newSize)
+	{
+		if (ptr != _lastAllocation || (char*)ptr + oldSize != _buffer + _offset)
+			return false;
+
+		size_t start = (char*)ptr - _buffer;
+		if (start + newSize > _capacity)
+			return false;
+
+		_offset = start + newSize;
+		_peak = std::max(_peak, _offset + _overflowBytes);
+		return true;
+	}
+
+	template<typename T>
+	T* allocateArray(size_t count)
+	{
+		return (T*)allocate(count * sizeof(T), alignof(T));
+	}
+
+	//Releases everything allocated in this frame -> call once per frame after the frame is done
+	void reset()
+	{
+		if (!_overflowBlocks.empty())
+		{
+			for (char* block : _overflowBlocks)
+				std::free(block);
+
+			//Grow the buffer so the next frame fits without overflowing
+			size_t newCapacity = alignUp(_peak + _peak / 2, 4096);
+			spdlog::warn("FrameArena: Frame needed {} bytes, growing arena from {} to {} bytes", _peak, _capacity, newCapacity);
+			std::free(_buffer);
+			_buffer = allocateBlock(newCapacity);
+			_capacity = newCapacity;
+
+			_overflowBlocks.clear();
+			_overflowBytes = 0;
+		}
+
+		_offset = 0;
+		_peak = 0;
+		_lastAllocation = nullptr;
+	}
+
+	size_t getUsedBytes() const
+	{
+		return _offset + _overflowBytes;
+	}
+
+	size_t getCapacity() const
+	{
+		return _capacity;
+	}
+};
+
+//STL-compatible allocator on top of the frame arena (deallocate is a no-op, memory is released on reset)
+template<typename T>
+class FrameAllocator
+{
+public:
+	typedef T value_type;
+
+	FrameArena* _arena;
+
+	FrameAllocator()
+		: _arena(&FrameArena::get())
+	{
+
+	}
+
+	FrameAllocator(FrameArena& arena)
+		: _arena(&arena)
+	{
+
+	}
+
+	template<typename U>
+	FrameAllocator(const FrameAllocator<U>& other)
+		: _arena(other._arena)
+	{
+
+	}
+
+	T* allocate(size_t n)
+	{
+		return _arena->allocateArray<T>(n);
+	}
+
+	void deallocate(T*, size_t)
+	{
+
+	}
+
+	template<typename U>
+	bool operator==(const FrameAllocator<U>& other) const
+	{
+		return _arena == other._arena;
+	}
+
+	template<typename U>
+	bool operator!=(const FrameAllocator<U>& other) const
+	{
+		return _arena != other._arena;
+	}
+};
+
+//Frame-local containers -> must not outlive the frame they were created in
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+using FrameStdString = std::basic_string<char, std::char_traits<char>, FrameAllocator<char>>;
+
+//String builder that writes into the frame arena (replacement for std::string + std::to_string in per-frame code)
+class FrameString
+{
+private:
+	FrameArena* _arena;
+	char* _data;
+	size_t _size, _capacity;
+
+	void reserve(size_t required)
+	{
+		if (required + 1 <= _capacity)
+			return;
+
+		size_t newCapacity = std::max(required + 1, _capacity * 2);
+		if (_data && _arena->tryExtend(_data, _capacity, newCapacity))
+		{
+			_capacity = newCapacity;
+			return;
+		}
+
+		char* newData = _arena->allocateArray<char>(newCapacity);
+		if (_data)
+			std::memcpy(newData, _data, _size + 1);
+		_data = newData;
+		_capacity = newCapacity;
+	}
+
+public:
+	FrameString(size_t capacity = 64)
+		: _arena(&FrameArena::get()), _data(nullptr), _size(0), _capacity(0)
+	{
+		reserve(capacity);
+		_data[0] = '\0';
+	}
+
+	FrameString(const char* str)
+		: FrameString(std::strlen(str))
+	{
+		append(str);
+	}
+
+	FrameString& append(const char* str, size_t length)
+	{
+		reserve(_size + length);
+		std::memcpy(_data + _size, str, length);
+		_size += length;
+		_data[_size] = '\0';
+		return *this;
+	}
+
+	FrameString& append(const char* str)
+	{
+		return append(str, std::strlen(str));
+	}
+
+	FrameString& append(char c)
+	{
+		return append(&c, 1);
+	}
+
+	FrameString& append(int value)
+	{
+		char tmp[16];
+		int length = std::snprintf(tmp, sizeof(tmp), "%d", value);
+		return append(tmp, length);
+	}
+
+	FrameString& append(unsigned int value)
+	{
+		char tmp[16];
+		int length = std::snprintf(tmp, sizeof(tmp), "%u", value);
+		return append(tmp, length);
+	}
+
+	//long is 32 bit on Windows and 64 bit on Linux, size_t is unsigned long long or unsigned long -> every integer type gets its own overload
+	FrameString& append(long value)
+	{
+		return append((long long)value);
+	}
+
+	FrameString& append(unsigned long value)
+	{
+		return append((unsigned long long)value);
+	}
+
+	FrameString& append(long long value)
+	{
+		char tmp[24];
+		int length = std::snprintf(tmp, sizeof(tmp), "%lld", value);
+		return append(tmp, length);
+	}
+
+	FrameString& append(unsigned long long value)
+	{
+		char tmp[24];
+		int length = std::snprintf(tmp, sizeof(tmp), "%llu", value);
+		return append(tmp, length);
+	}
+
+	FrameString& append(float value, int precision = 2)
+	{
+		return append((double)value, precision);
+	}
+
+	FrameString& append(double value, int precision = 2)
+	{
+		//Big values need up to 309 digits in front of the point
+		char tmp[352];
+		int length = std::snprintf(tmp, sizeof(tmp), "%.*f", precision, value);
+		return append(tmp, std::min((size_t)length, sizeof(tmp) - 1));
+	}
+
+	template<typename T>
+	FrameString& operator<<(const T& value)
+	{
+		return append(value);
+	}
+
+	void clear()
+	{
+		_size = 0;
+		_data[0] = '\0';
+	}
+
+	const char* c_str() const
+	{
+		return _data;
+	}
+
+	size_t size() const
+	{
+		return _size;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+//View frustum as six planes, extracted from a (projection * view) matrix
+class Frustum
+{
+private:
+	glm::vec4 _planes[6]; //xyz = normal pointing inside, w = distance
+
+public:
+	Frustum()
+		: Frustum(glm::mat4(1.0f))
+	{
+
+	}
+
+	Frustum(const glm::mat4& viewProjection)
+	{
+		set(viewProjection);
+	}
+
+	//Planes are sums/differences of the matrix rows (left, right, bottom, top, near, far)
+	void set(const glm::mat4& viewProjection)
+	{
+		glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+		glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+		glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+		glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+		_planes[0] = row3 + row0;
+		_planes[1] = row3 - row0;
+		_planes[2] = row3 + row1;
+		_planes[3] = row3 - row1;
+		_planes[4] = row3 + row2;
+		_planes[5] = row3 - row2;
+
+		//Normalized -> the plane test gives real distances
+		for (glm::vec4& plane : _planes)
+			plane /= glm::length(glm::vec3(plane));
+	}
+
+	//Conservative: spheres near the corners can count as visible although they are outside
+	bool intersectsSphere(const glm::vec3& center, float radius) const
+	{
+		for (const glm::vec4& plane : _planes)
+		{
+			if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+				return false;
+		}
+		return true;
+	}
+};
\ No newline at end of file
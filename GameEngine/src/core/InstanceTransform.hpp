@@ -0,0 +1,49 @@
+#pragma once
+
+#include "VertexArray.hpp"
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+//Compact per-instance transform for rigid, uniformly scaled objects -> 24 bytes instead of the 64 bytes of a mat4
+//The vertex shader rebuilds the transform: worldPos = position + scale * rotate(rotation, localPos)
+struct InstanceTransform
+{
+	glm::vec3 _position;
+	float _scale;
+	int16_t _rotation[4]; //Unit quaternion (x, y, z, w) as normalized shorts -> about 3e-5 precision per component
+
+	static int16_t packUnit(float value)
+	{
+		return (int16_t)std::lround(std::min(std::max(value, -1.0f), 1.0f) * 32767.0f);
+	}
+
+	void setRotation(float x, float y, float z, float w)
+	{
+		_rotation[0] = packUnit(x);
+		_rotation[1] = packUnit(y);
+		_rotation[2] = packUnit(z);
+		_rotation[3] = packUnit(w);
+	}
+
+	void set(const glm::vec3& position, const glm::quat& rotation, float scale = 1.0f)
+	{
+		_position = position;
+		_scale = scale;
+		setRotation(rotation.x, rotation.y, rotation.z, rotation.w);
+	}
+
+	//Position + scale go to location, the rotation to location + 1 (both advance once per instance)
+	//The instance buffer has to be bound
+	static void defineAttributes(VertexArray* vao, GLuint location)
+	{
+		vao->DefineAttributes(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceTransform), (void*)0);
+		vao->AttributeDivisor(location, 1);
+		vao->DefineAttributes(location + 1, 4, GL_SHORT, GL_TRUE, sizeof(InstanceTransform), (void*)offsetof(InstanceTransform, _rotation));
+		vao->AttributeDivisor(location + 1, 1);
+	}
+};
+
+static_assert(sizeof(InstanceTransform) == 24, "InstanceTransform has to be tightly packed for the instance buffer");
\ No newline at end of file
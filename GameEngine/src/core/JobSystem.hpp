@@ -0,0 +1,192 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Pool of persistent worker threads that split loops into chunks -> the calling thread works on the loop as well and returns once every chunk is done
+class JobSystem
+{
+private:
+	static const unsigned int SPIN_COUNT = 4000; //Workers poll this often for new work before they go to sleep
+
+	struct Batch
+	{
+		void (*_invoke)(const void* body, int begin, int end) = nullptr;
+		const void* _body = nullptr;
+		int _end = 0;
+		int _grainSize = 1;
+		std::atomic<int> _next{ 0 };
+		std::atomic<int> _remaining{ 0 };
+	};
+
+	std::vector<std::thread> _workers;
+	Batch _batch;
+
+	std::mutex _mutex;
+	std::condition_variable _wakeUp;
+	std::atomic<unsigned int> _generation{ 0 };
+	std::atomic<int> _busyWorkers{ 0 };
+	std::atomic<bool> _inParallelFor{ false };
+	unsigned int _activeThreads;
+	bool _quit = false;
+
+	static unsigned int& threadIndexStorage()
+	{
+		static thread_local unsigned int s_ThreadIndex = 0;
+		return s_ThreadIndex;
+	}
+
+	template<typename Body>
+	static void invokeBody(const void* body, int begin, int end)
+	{
+		(*(const Body*)body)(begin, end);
+	}
+
+	//Grabs chunks of the current batch until there are none left
+	void work()
+	{
+		while (true)
+		{
+			int begin = _batch._next.fetch_add(_batch._grainSize, std::memory_order_relaxed);
+			if (begin >= _batch._end)
+				return;
+
+			int end = std::min(begin + _batch._grainSize, _batch._end);
+			_batch._invoke(_batch._body, begin, end);
+			_batch._remaining.fetch_sub(end - begin, std::memory_order_acq_rel);
+		}
+	}
+
+	void workerLoop(unsigned int threadIndex)
+	{
+		threadIndexStorage() = threadIndex;
+		unsigned int seenGeneration = 0;
+
+		while (true)
+		{
+			//Spin a little first, loops are often issued back to back (e.g. every phase of a physics step)
+			for (unsigned int i = 0; i < SPIN_COUNT && _generation.load(std::memory_order_acquire) == seenGeneration; i++)
+				std::this_thread::yield();
+
+			{
+				std::unique_lock<std::mutex> lock(_mutex);
+				_wakeUp.wait(lock, [&]() { return _quit || _generation.load(std::memory_order_relaxed) != seenGeneration; });
+
+				if (_quit)
+					return;
+
+				seenGeneration = _generation.load(std::memory_order_relaxed);
+
+				//Workers beyond the configured thread count stay idle
+				if (threadIndex >= _activeThreads)
+					continue;
+
+				_busyWorkers.fetch_add(1, std::memory_order_acq_rel);
+			}
+
+			work();
+			_busyWorkers.fetch_sub(1, std::memory_order_acq_rel);
+		}
+	}
+
+public:
+	//workerCount threads get spawned in addition to the thread that calls parallelFor
+	JobSystem(unsigned int workerCount)
+		: _activeThreads(workerCount + 1)
+	{
+		_workers.reserve(workerCount);
+		for (unsigned int i = 0; i < workerCount; i++)
+			_workers.emplace_back(&JobSystem::workerLoop, this, i + 1);
+	}
+
+	~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_quit = true;
+		}
+		_wakeUp.notify_all();
+
+		for (std::thread& worker : _workers)
+			worker.join();
+	}
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	//Hardware threads minus the main thread
+	static unsigned int getDefaultWorkerCount()
+	{
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	//0 for the main thread (and every other thread that is not part of a job system), 1..N for the workers
+	static unsigned int getThreadIndex()
+	{
+		return threadIndexStorage();
+	}
+
+	//Calls body(begin, end) for chunks of at most grainSize iterations, iterations can run in any order
+	//Calls from inside a running loop (or from a second thread at the same time) get executed serially on the calling thread
+	template<typename Body>
+	void parallelFor(int begin, int end, int grainSize, const Body& body)
+	{
+		if (begin >= end)
+			return;
+
+		grainSize = std::max(grainSize, 1);
+
+		bool expected = false;
+		if (_activeThreads <= 1 || end - begin <= grainSize || !_inParallelFor.compare_exchange_strong(expected, true, std::memory_order_acquire))
+		{
+			body(begin, end);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			//Workers that woke up late for the previous loop have to leave it before the batch gets reused
+			while (_busyWorkers.load(std::memory_order_acquire) > 0)
+				std::this_thread::yield();
+
+			_batch._invoke = &invokeBody<Body>;
+			_batch._body = &body;
+			_batch._end = end;
+			_batch._grainSize = grainSize;
+			_batch._remaining.store(end - begin, std::memory_order_relaxed);
+			_batch._next.store(begin, std::memory_order_relaxed);
+			_generation.fetch_add(1, std::memory_order_release);
+		}
+		_wakeUp.notify_all();
+
+		work();
+
+		while (_batch._remaining.load(std::memory_order_acquire) > 0)
+			std::this_thread::yield();
+
+		_inParallelFor.store(false, std::memory_order_release);
+	}
+
+	//Limits how many threads (including the calling thread) work on a loop
+	void setThreadCount(unsigned int threads)
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_activeThreads = std::max(1u, std::min(threads, getMaxThreadCount()));
+	}
+
+	unsigned int getThreadCount() const
+	{
+		return _activeThreads;
+	}
+
+	unsigned int getMaxThreadCount() const
+	{
+		return (unsigned int)_workers.size() + 1;
+	}
+};
\ No newline at end of file
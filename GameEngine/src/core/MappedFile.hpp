@@ -0,0 +1,141 @@
+#pragma once
+
+#include <spdlog/spdlog.h>
+#include <cstddef>
+
+#if defined(_WIN32)
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+//Read-only view of a whole file in memory (file mapping) -> parsers can work on the bytes directly without reading them into a buffer first
+//The pages get loaded by the OS on first access, an empty file is open with getSize() == 0
+class MappedFile
+{
+private:
+	const char* _data = nullptr;
+	size_t _size = 0;
+	bool _open = false;
+
+	#if defined(_WIN32)
+		HANDLE _file = INVALID_HANDLE_VALUE, _mapping = nullptr;
+	#else
+		int _file = -1;
+	#endif
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+public:
+	MappedFile()
+	{
+
+	}
+
+	explicit MappedFile(const char* filepath)
+	{
+		open(filepath);
+	}
+
+	~MappedFile()
+	{
+		close();
+	}
+
+	bool open(const char* filepath)
+	{
+		close();
+
+		#if defined(_WIN32)
+			_file = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			LARGE_INTEGER size;
+			if (_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(_file, &size))
+			{
+				spdlog::error("Unable to open file! | Path: {}", filepath);
+				close();
+				return false;
+			}
+			_size = (size_t)size.QuadPart;
+
+			if (_size > 0)
+			{
+				_mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+				_data = _mapping ? (const char*)MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+			}
+		#else
+			_file = ::open(filepath, O_RDONLY);
+			struct stat status;
+			if (_file < 0 || fstat(_file, &status) != 0)
+			{
+				spdlog::error("Unable to open file! | Path: {}", filepath);
+				close();
+				return false;
+			}
+			_size = (size_t)status.st_size;
+
+			if (_size > 0)
+			{
+				void* data = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _file, 0);
+				_data = data != MAP_FAILED ? (const char*)data : nullptr;
+				if (_data)
+					madvise(data, _size, MADV_SEQUENTIAL);
+			}
+		#endif
+
+		if (_size > 0 && !_data)
+		{
+			spdlog::error("Unable to map file! | Path: {}", filepath);
+			close();
+			return false;
+		}
+
+		_open = true;
+		return true;
+	}
+
+	void close()
+	{
+		#if defined(_WIN32)
+			if (_data)
+				UnmapViewOfFile(_data);
+			if (_mapping)
+				CloseHandle(_mapping);
+			if (_file != INVALID_HANDLE_VALUE)
+				CloseHandle(_file);
+			_mapping = nullptr;
+			_file = INVALID_HANDLE_VALUE;
+		#else
+			if (_data)
+				munmap((void*)_data, _size);
+			if (_file >= 0)
+				::close(_file);
+			_file = -1;
+		#endif
+
+		_data = nullptr;
+		_size = 0;
+		_open = false;
+	}
+
+	bool isOpen() const
+	{
+		return _open;
+	}
+
+	const char* getData() const
+	{
+		return _data;
+	}
+
+	size_t getSize() const
+	{
+		return _size;
+	}
+};
\ No newline at end of file
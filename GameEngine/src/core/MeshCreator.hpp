@@ -5,6 +5,7 @@
 #include <assimp/postprocess.h>     //Post processing flags
 #include <glm/vec2.hpp>
 #include <glm/vec3.hpp>
+#include <cmath>
 #include "Data.hpp"
 
 class MeshCreator
@@ -129,4 +130,42 @@ public:
 		
 		return data;
 	}
+
+	//UV sphere with radius 1 around the origin -> few rings and segments are enough for small particles
+	static Data* createSphere(const unsigned int& rings, const unsigned int& segments)
+	{
+		Data* data = new Data();
+		const float pi = 3.14159265358979f;
+
+		for (unsigned int j = 0; j <= rings; ++j)
+		{
+			float v = (float)j / rings;
+			float theta = v * pi;
+
+			for (unsigned int i = 0; i <= segments; ++i)
+			{
+				float u = (float)i / segments;
+				float phi = u * 2.0f * pi;
+
+				glm::vec3 position(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+				data->_vertices.emplace_back(position);
+				data->_texCoords.emplace_back(glm::vec2(u, v));
+				data->_normals.emplace_back(position);
+
+				if ((j != rings) && (i != segments))
+				{
+					const unsigned int row1 = j * (segments + 1);
+					const unsigned int row2 = (j + 1) * (segments + 1);
+
+					//Triangle 1
+					data->_indices.emplace_back(glm::uvec3(row1 + i, row2 + i + 1, row1 + i + 1));
+
+					//Triangle 2
+					data->_indices.emplace_back(glm::uvec3(row1 + i, row2 + i, row2 + i + 1));
+				}
+			}
+		}
+
+		return data;
+	}
 };
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+//Fixed-size object pool -> objects live in chunks that are never released until the pool dies, freed slots get reused by the next create()
+template<typename T, size_t ChunkSize = 256>
+class ObjectPool
+{
+private:
+	union Slot
+	{
+		Slot* _next;
+		alignas(T) unsigned char _storage[sizeof(T)];
+	};
+
+	std::vector<void*> _chunks; //Raw allocations (unaligned)
+	Slot* _freeList = nullptr;
+	size_t _liveObjects = 0;
+
+	void allocateChunk()
+	{
+		//Over-allocate so the slots can be aligned manually (Bullet types need 16 byte alignment)
+		void* raw = std::malloc(ChunkSize * sizeof(Slot) + alignof(Slot));
+		if (!raw)
+			throw std::bad_alloc();
+
+		uintptr_t aligned = ((uintptr_t)raw + alignof(Slot) - 1) & ~(uintptr_t)(alignof(Slot) - 1);
+		Slot* slots = (Slot*)aligned;
+		_chunks.push_back(raw);
+
+		//Chain all new slots into the free list
+		for (size_t i = 0; i < ChunkSize; i++)
+		{
+			slots[i]._next = _freeList;
+			_freeList = &slots[i];
+		}
+	}
+
+public:
+	ObjectPool()
+	{
+
+	}
+
+	~ObjectPool()
+	{
+		//Objects have to be destroyed by their owner, the pool only releases the memory
+		for (void* chunk : _chunks)
+			std::free(chunk);
+	}
+
+	ObjectPool(const ObjectPool&) = delete;
+	ObjectPool& operator=(const ObjectPool&) = delete;
+
+	template<typename... Args>
+	T* create(Args&&... args)
+	{
+		if (!_freeList)
+			allocateChunk();
+
+		Slot* slot = _freeList;
+		_freeList = slot->_next;
+		_liveObjects++;
+
+		return ::new (slot->_storage) T(std::forward<Args>(args)...);
+	}
+
+	void destroy(T* object)
+	{
+		if (!object)
+			return;
+
+		object->~T();
+
+		Slot* slot = (Slot*)object;
+		slot->_next = _freeList;
+		_freeList = slot;
+		_liveObjects--;
+	}
+
+	//Preallocate memory for at least count objects
+	void reserve(size_t count)
+	{
+		while (_chunks.size() * ChunkSize < count)
+			allocateChunk();
+	}
+
+	size_t size() const
+	{
+		return _liveObjects;
+	}
+
+	size_t capacity() const
+	{
+		return _chunks.size() * ChunkSize;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "ParticleSystem.hpp"
+#include "VertexArray.hpp"
+#include "VertexBuffer.hpp"
+#include "Shader.hpp"
+#include "Texture.hpp"
+#include <glm/glm.hpp>
+
+//Draws all live particles of a ParticleSystem with one instanced call
+//The instance buffer holds the parallel arrays of the system back to back (x, y, z, size, r, g, b, a), each one its own attribute
+//-> the upload is 8 copies of contiguous floats, no interleaving on the CPU
+//Particles are camera facing quads: position + (right * corner.x + up * corner.y) * size
+class ParticleRenderer
+{
+private:
+	static const unsigned int ATTRIBUTES = 8;
+
+	ParticleSystem* _particleSystem = nullptr;
+	Shader* _shader = nullptr;
+	Texture* _texture = nullptr;
+	VertexArray* _vao = nullptr;
+	VertexBuffer* _quadVbo = nullptr, * _instanceVbo = nullptr;
+
+public:
+	ParticleRenderer(ParticleSystem* particleSystem, Shader* shader, Texture* texture)
+		: _particleSystem(particleSystem), _shader(shader), _texture(texture)
+	{
+		//Create and bind vao
+		_vao = new VertexArray();
+		_vao->bind();
+
+		//Quad corners as a triangle strip
+		float corners[] =
+		{
+			-0.5f, -0.5f,
+			 0.5f, -0.5f,
+			-0.5f,  0.5f,
+			 0.5f,  0.5f
+		};
+		_quadVbo = new VertexBuffer(corners, sizeof(corners));
+		_vao->DefineAttributes(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+
+		//One float attribute per array, the arrays sit back to back with room for every particle
+		unsigned int capacity = _particleSystem->getCapacity();
+		_instanceVbo = new VertexBuffer(nullptr, ATTRIBUTES * capacity * sizeof(float), true);
+		for (unsigned int i = 0; i < ATTRIBUTES; i++)
+		{
+			_vao->DefineAttributes(1 + i, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)(i * capacity * sizeof(float)));
+			_vao->AttributeDivisor(1 + i, 1);
+		}
+
+		//Unbind vao and vbo
+		_vao->unbind();
+		_instanceVbo->unbind();
+	}
+
+	~ParticleRenderer()
+	{
+		delete _vao;
+		delete _quadVbo;
+		delete _instanceVbo;
+	}
+
+	//right/up = camera axes the quads get spanned with (screen axes for 2D)
+	//additive = GL_ONE as destination factor -> overlapping particles glow, the normal alpha blending gets restored afterwards
+	void render(const glm::mat4& viewProjection, const glm::vec3& right, const glm::vec3& up, bool additive = true)
+	{
+		unsigned int count = _particleSystem->getCount();
+		if (count == 0)
+			return;
+
+		//Orphan the buffer and upload the live part of every array
+		unsigned int capacity = _particleSystem->getCapacity();
+		const float* arrays[ATTRIBUTES] = { _particleSystem->getPositionsX(), _particleSystem->getPositionsY(), _particleSystem->getPositionsZ(), _particleSystem->getSizes(),
+			_particleSystem->getRed(), _particleSystem->getGreen(), _particleSystem->getBlue(), _particleSystem->getAlpha() };
+
+		_instanceVbo->bind();
+		GLCall(glBufferData(GL_ARRAY_BUFFER, ATTRIBUTES * capacity * sizeof(float), nullptr, GL_DYNAMIC_DRAW));
+		for (unsigned int i = 0; i < ATTRIBUTES; i++)
+			_instanceVbo->updateData(arrays[i], count * sizeof(float), i * capacity * sizeof(float));
+		_instanceVbo->unbind();
+
+		//Bind shader and set uniforms
+		_shader->bind();
+		_shader->SetUniformMat4f("viewProjection", viewProjection);
+		_shader->SetUniformVec3("right", right);
+		_shader->SetUniformVec3("up", up);
+
+		if (additive)
+		{
+			GLCall(glBlendFunc(GL_SRC_ALPHA, GL_ONE));
+		}
+
+		//Set texture and render instanced
+		_texture->bind();
+		_vao->bind();
+		GLCall(glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count));
+		_vao->unbind();
+
+		if (additive)
+		{
+			GLCall(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
+		}
+	}
+};
\ No newline at end of file
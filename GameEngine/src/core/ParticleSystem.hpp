@@ -0,0 +1,318 @@
+#pragma once
+
+#include "CpuFeatures.hpp"
+#include "Random.hpp"
+#include <glm/glm.hpp>
+#include <immintrin.h>
+#include <algorithm>
+#include <vector>
+
+//Where and how a ParticleSystem spawns particles
+//Continuous emitters get emitted every frame with emit(emitter, dt), bursts (impacts, explosions) with burst(emitter, count)
+struct ParticleEmitter
+{
+	glm::vec3 _position = glm::vec3(0.0f);
+	glm::vec3 _positionSpread = glm::vec3(0.0f); //Particles spawn in position +- spread
+	glm::vec3 _velocityMin = glm::vec3(-1.0f), _velocityMax = glm::vec3(1.0f);
+	float _lifeMin = 0.5f, _lifeMax = 1.0f; //Seconds
+	float _size = 1.0f;
+	glm::vec4 _startColor = glm::vec4(1.0f), _endColor = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f); //Lerped over the lifetime
+	float _rate = 100.0f; //Particles per second of a continuous emitter
+	float _accumulator = 0.0f; //Fraction of a particle left over from the last emit()
+};
+
+//Fixed capacity particle pool in parallel arrays (position, velocity, life, colours) -> the update walks 8 particles at a time with AVX2
+//Live particles are always the first getCount() entries, dead ones get replaced by the last live particle (swap-remove)
+//The arrays can be uploaded as they are, see ParticleRenderer
+class ParticleSystem
+{
+public:
+	//Padding behind every array -> the SIMD update can always process full blocks of 8
+	static const unsigned int PADDING = 8;
+
+private:
+	unsigned int _capacity;
+	unsigned int _count = 0;
+	bool _simd;
+	glm::vec3 _gravity = glm::vec3(0.0f);
+
+	std::vector<float> _px, _py, _pz, _vx, _vy, _vz;
+	std::vector<float> _life, _inverseLifeTime; //Remaining seconds, 1 / total seconds
+	std::vector<float> _size;
+	std::vector<float> _startR, _startG, _startB, _startA, _endR, _endG, _endB, _endA;
+	std::vector<float> _r, _g, _b, _a; //Current colour
+
+	//Scratch buffers for the random values of an emit
+	std::vector<glm::vec3> _randomPositions, _randomVelocities;
+	std::vector<float> _randomLives;
+
+	void copyParticle(unsigned int from, unsigned int to)
+	{
+		for (std::vector<float>* array : { &_px, &_py, &_pz, &_vx, &_vy, &_vz, &_life, &_inverseLifeTime, &_size,
+			&_startR, &_startG, &_startB, &_startA, &_endR, &_endG, &_endB, &_endA, &_r, &_g, &_b, &_a })
+		{
+			(*array)[to] = (*array)[from];
+		}
+	}
+
+	void updateScalar(unsigned int begin, unsigned int end, float dt)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			_vx[i] += _gravity.x * dt;
+			_vy[i] += _gravity.y * dt;
+			_vz[i] += _gravity.z * dt;
+			_px[i] += _vx[i] * dt;
+			_py[i] += _vy[i] * dt;
+			_pz[i] += _vz[i] * dt;
+			_life[i] -= dt;
+
+			//Start colour at the beginning of the life, end colour at the end
+			float t = std::max(_life[i] * _inverseLifeTime[i], 0.0f);
+			_r[i] = _endR[i] + (_startR[i] - _endR[i]) * t;
+			_g[i] = _endG[i] + (_startG[i] - _endG[i]) * t;
+			_b[i] = _endB[i] + (_startB[i] - _endB[i]) * t;
+			_a[i] = _endA[i] + (_startA[i] - _endA[i]) * t;
+		}
+	}
+
+	TARGET_AVX2 static void lerpSimd(float* out, const float* start, const float* end, __m256 t)
+	{
+		__m256 e = _mm256_loadu_ps(end);
+		_mm256_storeu_ps(out, _mm256_fmadd_ps(_mm256_sub_ps(_mm256_loadu_ps(start), e), t, e));
+	}
+
+	TARGET_AVX2 static void integrateSimd(float* position, float* velocity, __m256 acceleration, __m256 dt)
+	{
+		__m256 v = _mm256_fmadd_ps(acceleration, dt, _mm256_loadu_ps(velocity));
+		_mm256_storeu_ps(velocity, v);
+		_mm256_storeu_ps(position, _mm256_fmadd_ps(v, dt, _mm256_loadu_ps(position)));
+	}
+
+	//Same as updateScalar for 8 particles per iteration, end gets rounded up into the padding
+	//The FMAs round once instead of twice -> positions and colours can differ from the scalar loop in the last bit
+	TARGET_AVX2 void updateSimd(unsigned int begin, unsigned int end, float dt)
+	{
+		const __m256 timeStep = _mm256_set1_ps(dt);
+		const __m256 gx = _mm256_set1_ps(_gravity.x), gy = _mm256_set1_ps(_gravity.y), gz = _mm256_set1_ps(_gravity.z);
+		const __m256 zero = _mm256_setzero_ps();
+
+		for (unsigned int i = begin; i < end; i += 8)
+		{
+			integrateSimd(&_px[i], &_vx[i], gx, timeStep);
+			integrateSimd(&_py[i], &_vy[i], gy, timeStep);
+			integrateSimd(&_pz[i], &_vz[i], gz, timeStep);
+
+			__m256 life = _mm256_sub_ps(_mm256_loadu_ps(&_life[i]), timeStep);
+			_mm256_storeu_ps(&_life[i], life);
+
+			__m256 t = _mm256_max_ps(_mm256_mul_ps(life, _mm256_loadu_ps(&_inverseLifeTime[i])), zero);
+			lerpSimd(&_r[i], &_startR[i], &_endR[i], t);
+			lerpSimd(&_g[i], &_startG[i], &_endG[i], t);
+			lerpSimd(&_b[i], &_startB[i], &_endB[i], t);
+			lerpSimd(&_a[i], &_startA[i], &_endA[i], t);
+		}
+	}
+
+	//Index of the first particle with life <= 0 at or after begin (blocks of 8 with live particles only get skipped with one compare)
+	TARGET_AVX2 unsigned int findDeadSimd(unsigned int begin) const
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		unsigned int i = begin;
+		for (; i + 8 <= _count; i += 8)
+		{
+			int dead = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(&_life[i]), zero, _CMP_LE_OQ));
+			if (dead != 0)
+			{
+				unsigned int lane = 0;
+				while ((dead & (1 << lane)) == 0)
+					lane++;
+				return i + lane;
+			}
+		}
+
+		for (; i < _count; i++)
+		{
+			if (_life[i] <= 0.0f)
+				return i;
+		}
+		return _count;
+	}
+
+	unsigned int findDead(unsigned int begin) const
+	{
+		if (_simd)
+			return findDeadSimd(begin);
+
+		for (unsigned int i = begin; i < _count; i++)
+		{
+			if (_life[i] <= 0.0f)
+				return i;
+		}
+		return _count;
+	}
+
+	//Swap-remove of all dead particles, the order of the live ones changes
+	void removeDead()
+	{
+		unsigned int i = findDead(0);
+		while (i < _count)
+		{
+			copyParticle(--_count, i);
+			if (_life[i] <= 0.0f) //The moved particle can be dead as well
+				continue;
+			i = findDead(i + 1);
+		}
+	}
+
+public:
+	//simd = use the AVX2 update if the CPU supports it
+	ParticleSystem(unsigned int capacity, bool simd = true)
+		: _capacity(capacity), _simd(simd && CpuFeatures::hasAvx2())
+	{
+		for (std::vector<float>* array : { &_px, &_py, &_pz, &_vx, &_vy, &_vz, &_life, &_inverseLifeTime, &_size,
+			&_startR, &_startG, &_startB, &_startA, &_endR, &_endG, &_endB, &_endA, &_r, &_g, &_b, &_a })
+		{
+			array->resize(_capacity + PADDING, 0.0f);
+		}
+	}
+
+	void setGravity(const glm::vec3& gravity)
+	{
+		_gravity = gravity;
+	}
+
+	//Spawns count particles, as many as fit if the pool is full
+	//Returns the number of spawned particles
+	unsigned int burst(const ParticleEmitter& emitter, unsigned int count)
+	{
+		count = std::min(count, _capacity - _count);
+		if (count == 0)
+			return 0;
+
+		//Randomize positions, velocities and lifetimes in one batch each
+		_randomPositions.resize(count);
+		_randomVelocities.resize(count);
+		_randomLives.resize(count);
+		random::Generator& generator = random::ThreadGenerator();
+		generator.fillVec3(&_randomPositions[0], count, emitter._position - emitter._positionSpread, emitter._position + emitter._positionSpread);
+		generator.fillVec3(&_randomVelocities[0], count, emitter._velocityMin, emitter._velocityMax);
+		generator.fillFloats(&_randomLives[0], count, emitter._lifeMin, emitter._lifeMax);
+
+		for (unsigned int n = 0; n < count; n++)
+		{
+			unsigned int i = _count + n;
+			_px[i] = _randomPositions[n].x;
+			_py[i] = _randomPositions[n].y;
+			_pz[i] = _randomPositions[n].z;
+			_vx[i] = _randomVelocities[n].x;
+			_vy[i] = _randomVelocities[n].y;
+			_vz[i] = _randomVelocities[n].z;
+
+			float life = std::max(_randomLives[n], 1e-4f);
+			_life[i] = life;
+			_inverseLifeTime[i] = 1.0f / life;
+			_size[i] = emitter._size;
+
+			_startR[i] = emitter._startColor.r;
+			_startG[i] = emitter._startColor.g;
+			_startB[i] = emitter._startColor.b;
+			_startA[i] = emitter._startColor.a;
+			_endR[i] = emitter._endColor.r;
+			_endG[i] = emitter._endColor.g;
+			_endB[i] = emitter._endColor.b;
+			_endA[i] = emitter._endColor.a;
+			_r[i] = emitter._startColor.r;
+			_g[i] = emitter._startColor.g;
+			_b[i] = emitter._startColor.b;
+			_a[i] = emitter._startColor.a;
+		}
+
+		_count += count;
+		return count;
+	}
+
+	//Continuous emission: spawns _rate * dt particles (the fraction carries over to the next call)
+	unsigned int emit(ParticleEmitter& emitter, float dt)
+	{
+		emitter._accumulator += emitter._rate * dt;
+		unsigned int count = (unsigned int)emitter._accumulator;
+		emitter._accumulator -= (float)count;
+		return burst(emitter, count);
+	}
+
+	//Moves all particles, fades their colours and removes the ones whose life ran out
+	void update(float dt)
+	{
+		if (_count == 0)
+			return;
+
+		if (_simd)
+			updateSimd(0, _count, dt);
+		else
+			updateScalar(0, _count, dt);
+
+		removeDead();
+	}
+
+	void clear()
+	{
+		_count = 0;
+	}
+
+	unsigned int getCount() const
+	{
+		return _count;
+	}
+
+	unsigned int getCapacity() const
+	{
+		return _capacity;
+	}
+
+	bool usesSimd() const
+	{
+		return _simd;
+	}
+
+	//Live particles are the first getCount() entries of every array
+	const float* getPositionsX() const
+	{
+		return &_px[0];
+	}
+
+	const float* getPositionsY() const
+	{
+		return &_py[0];
+	}
+
+	const float* getPositionsZ() const
+	{
+		return &_pz[0];
+	}
+
+	const float* getSizes() const
+	{
+		return &_size[0];
+	}
+
+	const float* getRed() const
+	{
+		return &_r[0];
+	}
+
+	const float* getGreen() const
+	{
+		return &_g[0];
+	}
+
+	const float* getBlue() const
+	{
+		return &_b[0];
+	}
+
+	const float* getAlpha() const
+	{
+		return &_a[0];
+	}
+};
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+
+#if defined(_WIN32)
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+	#include <psapi.h>
+#else
+	#include <sys/resource.h>
+	#include <unistd.h>
+	#include <cstdio>
+#endif
+
+//Memory of the whole process as the OS sees it (working set / resident set), 0 if it can't be queried
+class ProcessMemory
+{
+public:
+	static size_t getCurrentBytes()
+	{
+		#if defined(_WIN32)
+			PROCESS_MEMORY_COUNTERS counters;
+			if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+				return counters.WorkingSetSize;
+			return 0;
+		#else
+			//Second value of statm = resident pages
+			size_t pages = 0, residentPages = 0;
+			FILE* file = std::fopen("/proc/self/statm", "r");
+			if (!file)
+				return 0;
+			if (std::fscanf(file, "%zu %zu", &pages, &residentPages) != 2)
+				residentPages = 0;
+			std::fclose(file);
+			return residentPages * (size_t)sysconf(_SC_PAGESIZE);
+		#endif
+	}
+
+	static size_t getPeakBytes()
+	{
+		#if defined(_WIN32)
+			PROCESS_MEMORY_COUNTERS counters;
+			if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+				return counters.PeakWorkingSetSize;
+			return 0;
+		#else
+			struct rusage usage;
+			if (getrusage(RUSAGE_SELF, &usage) != 0)
+				return 0;
+			return (size_t)usage.ru_maxrss * 1024; //KB on Linux
+		#endif
+	}
+};
\ No newline at end of file
@@ -1,22 +1,309 @@
 #pragma once
 
+#include <glm/glm.hpp>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
 #include <random>
+#include <emmintrin.h>
 
 namespace random
 {
-	static std::mt19937 s_RandomEngine;
-	static std::uniform_int_distribution<std::mt19937::result_type> s_Distribution;
-	
-	static float Float()
-	{
-		s_RandomEngine.seed(std::random_device()());
-		
-		return (float)s_Distribution(s_RandomEngine) / (float)std::numeric_limits<uint32_t>::max();
+	//Turns any seed (also 0 or consecutive numbers) into well mixed generator state
+	inline uint64_t SplitMix64(uint64_t& state)
+	{
+		uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	//xoshiro128** generator with 16 bytes of state -> no syscalls, no locks, one instance per thread or per system
+	//The same seed and stream produce the same numbers on every platform (no std distributions involved)
+	class Generator
+	{
+	private:
+		uint32_t _state[4];
+
+		//4 xoshiro128+ streams side by side in SSE registers for the batch functions
+		struct Lanes
+		{
+			__m128i _s0, _s1, _s2, _s3;
+		};
+
+		static uint32_t rotl(uint32_t x, int k)
+		{
+			return (x << k) | (x >> (32 - k));
+		}
+
+		//The lanes get seeded from this generator -> batches are deterministic as well and the generator state stays 16 bytes
+		Lanes createLanes()
+		{
+			uint32_t seeds[16];
+			for (int i = 0; i < 16; i++)
+				seeds[i] = next();
+
+			//The lowest bit of the first word is set, so no lane can be all zero
+			Lanes lanes;
+			lanes._s0 = _mm_or_si128(_mm_set_epi32(seeds[3], seeds[2], seeds[1], seeds[0]), _mm_set1_epi32(1));
+			lanes._s1 = _mm_set_epi32(seeds[7], seeds[6], seeds[5], seeds[4]);
+			lanes._s2 = _mm_set_epi32(seeds[11], seeds[10], seeds[9], seeds[8]);
+			lanes._s3 = _mm_set_epi32(seeds[15], seeds[14], seeds[13], seeds[12]);
+			return lanes;
+		}
+
+		//4 floats in [0, 1)
+		static __m128 nextFloat4(Lanes& lanes)
+		{
+			__m128i result = _mm_add_epi32(lanes._s0, lanes._s3);
+			__m128i t = _mm_slli_epi32(lanes._s1, 9);
+
+			lanes._s2 = _mm_xor_si128(lanes._s2, lanes._s0);
+			lanes._s3 = _mm_xor_si128(lanes._s3, lanes._s1);
+			lanes._s1 = _mm_xor_si128(lanes._s1, lanes._s2);
+			lanes._s0 = _mm_xor_si128(lanes._s0, lanes._s3);
+			lanes._s2 = _mm_xor_si128(lanes._s2, t);
+			lanes._s3 = _mm_or_si128(_mm_slli_epi32(lanes._s3, 11), _mm_srli_epi32(lanes._s3, 21));
+
+			//Upper 23 bits become the mantissa of a float in [1, 2)
+			__m128i bits = _mm_or_si128(_mm_srli_epi32(result, 9), _mm_set1_epi32(0x3F800000));
+			return _mm_sub_ps(_mm_castsi128_ps(bits), _mm_set1_ps(1.0f));
+		}
+
+		//sin(x) for x in [-pi, pi] (parabola with one refinement step, max error about 0.001)
+		static __m128 sin4(__m128 x)
+		{
+			const __m128 B = _mm_set1_ps(4.0f / 3.14159265f);
+			const __m128 C = _mm_set1_ps(-4.0f / (3.14159265f * 3.14159265f));
+			const __m128 P = _mm_set1_ps(0.225f);
+			const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+			__m128 y = _mm_add_ps(_mm_mul_ps(B, x), _mm_mul_ps(_mm_mul_ps(C, x), _mm_and_ps(x, absMask)));
+			return _mm_add_ps(_mm_mul_ps(P, _mm_sub_ps(_mm_mul_ps(y, _mm_and_ps(y, absMask)), y)), y);
+		}
+
+	public:
+		Generator(uint64_t seed = 0, uint64_t stream = 0)
+		{
+			this->seed(seed, stream);
+		}
+
+		//Different streams of the same seed are independent sequences (e.g. one per thread or per job)
+		void seed(uint64_t seed, uint64_t stream = 0)
+		{
+			uint64_t state = seed ^ (stream * 0xD1B54A32D192ED03ull);
+			uint64_t a = SplitMix64(state);
+			uint64_t b = SplitMix64(state);
+
+			_state[0] = (uint32_t)a;
+			_state[1] = (uint32_t)(a >> 32);
+			_state[2] = (uint32_t)b;
+			_state[3] = (uint32_t)(b >> 32);
+		}
+
+		uint32_t next()
+		{
+			uint32_t result = rotl(_state[1] * 5, 7) * 9;
+			uint32_t t = _state[1] << 9;
+
+			_state[2] ^= _state[0];
+			_state[3] ^= _state[1];
+			_state[1] ^= _state[2];
+			_state[0] ^= _state[3];
+			_state[2] ^= t;
+			_state[3] = rotl(_state[3], 11);
+
+			return result;
+		}
+
+		//[0, 1)
+		float Float()
+		{
+			return (float)(next() >> 8) * (1.0f / 16777216.0f);
+		}
+
+		//[min, max)
+		float Float(float min, float max)
+		{
+			return min + Float() * (max - min);
+		}
+
+		//[0, max_val)
+		unsigned int Int(int max_val)
+		{
+			return (unsigned int)(((uint64_t)next() * (uint32_t)max_val) >> 32);
+		}
+
+		//---------------------------Batch generation (SSE, 4 numbers per step)---------------------------//
+		void fillFloats(float* out, size_t count, float min = 0.0f, float max = 1.0f)
+		{
+			Lanes lanes = createLanes();
+			__m128 scale = _mm_set1_ps(max - min);
+			__m128 offset = _mm_set1_ps(min);
+
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+				_mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(nextFloat4(lanes), scale), offset));
+
+			for (; i < count; i++)
+				out[i] = Float(min, max);
+		}
+
+		//Every component gets its own range
+		void fillVec2(glm::vec2* out, size_t count, const glm::vec2& min, const glm::vec2& max)
+		{
+			Lanes lanes = createLanes();
+			glm::vec2 range = max - min;
+			__m128 scale = _mm_set_ps(range.y, range.x, range.y, range.x);
+			__m128 offset = _mm_set_ps(min.y, min.x, min.y, min.x);
+
+			if (count == 0)
+				return;
+
+			//Two vectors per step
+			float* data = &out[0].x;
+			size_t i = 0;
+			for (; i + 2 <= count; i += 2)
+				_mm_storeu_ps(data + i * 2, _mm_add_ps(_mm_mul_ps(nextFloat4(lanes), scale), offset));
+
+			for (; i < count; i++)
+				out[i] = glm::vec2(Float(min.x, max.x), Float(min.y, max.y));
+		}
+
+		void fillVec3(glm::vec3* out, size_t count, const glm::vec3& min, const glm::vec3& max)
+		{
+			Lanes lanes = createLanes();
+			glm::vec3 range = max - min;
+
+			//Four vectors are 12 floats -> three SSE registers with the components rotating through the lanes
+			__m128 scale0 = _mm_set_ps(range.x, range.z, range.y, range.x);
+			__m128 scale1 = _mm_set_ps(range.y, range.x, range.z, range.y);
+			__m128 scale2 = _mm_set_ps(range.z, range.y, range.x, range.z);
+			__m128 offset0 = _mm_set_ps(min.x, min.z, min.y, min.x);
+			__m128 offset1 = _mm_set_ps(min.y, min.x, min.z, min.y);
+			__m128 offset2 = _mm_set_ps(min.z, min.y, min.x, min.z);
+
+			if (count == 0)
+				return;
+
+			float* data = &out[0].x;
+			size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				float* block = data + i * 3;
+				_mm_storeu_ps(block + 0, _mm_add_ps(_mm_mul_ps(nextFloat4(lanes), scale0), offset0));
+				_mm_storeu_ps(block + 4, _mm_add_ps(_mm_mul_ps(nextFloat4(lanes), scale1), offset1));
+				_mm_storeu_ps(block + 8, _mm_add_ps(_mm_mul_ps(nextFloat4(lanes), scale2), offset2));
+			}
+
+			for (; i < count; i++)
+				out[i] = glm::vec3(Float(min.x, max.x), Float(min.y, max.y), Float(min.z, max.z));
+		}
+
+		//Directions uniformly distributed on the unit sphere (z uniform in [-1, 1), angle uniform around the z axis)
+		void fillUnitDirections(glm::vec3* out, size_t count)
+		{
+			Lanes lanes = createLanes();
+			const __m128 one = _mm_set1_ps(1.0f);
+			const __m128 two = _mm_set1_ps(2.0f);
+			const __m128 pi = _mm_set1_ps(3.14159265f);
+			const __m128 halfPi = _mm_set1_ps(1.57079633f);
+			const __m128 twoPi = _mm_set1_ps(6.28318531f);
+
+			alignas(16) float x[4], y[4], z[4];
+			for (size_t i = 0; i < count; i += 4)
+			{
+				__m128 height = _mm_sub_ps(_mm_mul_ps(nextFloat4(lanes), two), one);
+				__m128 angle = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(nextFloat4(lanes), two), one), pi);
+				__m128 radius = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(one, _mm_mul_ps(height, height)), _mm_setzero_ps()));
+
+				//cos(a) = sin(a + pi/2), wrapped back into [-pi, pi]
+				__m128 cosAngle = _mm_add_ps(angle, halfPi);
+				cosAngle = _mm_sub_ps(cosAngle, _mm_and_ps(_mm_cmpgt_ps(cosAngle, pi), twoPi));
+
+				//Renormalize the approximations so the results are exactly unit length
+				__m128 s = sin4(angle);
+				__m128 c = sin4(cosAngle);
+				__m128 invLength = _mm_div_ps(radius, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(s, s), _mm_mul_ps(c, c))));
+
+				_mm_store_ps(x, _mm_mul_ps(c, invLength));
+				_mm_store_ps(y, _mm_mul_ps(s, invLength));
+				_mm_store_ps(z, height);
+
+				for (size_t j = 0; j < 4 && i + j < count; j++)
+					out[i + j] = glm::vec3(x[j], y[j], z[j]);
+			}
+		}
+
+		//The whole generator state (for snapshots)
+		void save(std::ostream& stream) const
+		{
+			stream.write((const char*)_state, sizeof(_state));
+		}
+
+		void load(std::istream& stream)
+		{
+			stream.read((char*)_state, sizeof(_state));
+		}
+	};
+
+	//Seed of the per-thread generators, every thread gets its own stream of it
+	struct SeedState
+	{
+		std::atomic<uint64_t> _seed;
+		std::atomic<uint32_t> _epoch{ 0 };
+		std::atomic<uint32_t> _nextStream{ 0 };
+
+		SeedState()
+			: _seed(((uint64_t)std::random_device()() << 32) | std::random_device()())
+		{
+
+		}
+	};
+
+	//Function-local statics of inline functions exist once in the program -> every translation unit sees the same seed and generators
+	inline SeedState& GlobalSeedState()
+	{
+		static SeedState s_State;
+		return s_State;
+	}
+
+	//Generator of the calling thread -> streams get handed out in order of first use (the main thread usually gets stream 0)
+	//Parallel code that has to be reproducible should use own Generators seeded with e.g. the job index instead
+	inline Generator& ThreadGenerator()
+	{
+		SeedState& state = GlobalSeedState();
+		static thread_local Generator s_Generator;
+		static thread_local uint32_t s_Stream = state._nextStream.fetch_add(1, std::memory_order_relaxed);
+		static thread_local uint32_t s_Epoch = ~0u;
+
+		uint32_t epoch = state._epoch.load(std::memory_order_acquire);
+		if (s_Epoch != epoch)
+		{
+			s_Generator.seed(state._seed.load(std::memory_order_relaxed), s_Stream);
+			s_Epoch = epoch;
+		}
+
+		return s_Generator;
+	}
+
+	//Reseeds the generators of all threads (by default they get a random seed at program start)
+	inline void SetSeed(uint64_t seed)
+	{
+		SeedState& state = GlobalSeedState();
+		state._seed.store(seed, std::memory_order_relaxed);
+		state._epoch.fetch_add(1, std::memory_order_release);
+	}
+
+	inline float Float()
+	{
+		return ThreadGenerator().Float();
 	}
 
-	static unsigned int Int(int max_val)
+	inline unsigned int Int(int max_val)
 	{
-		s_RandomEngine.seed(std::random_device()());
-		return s_Distribution(s_RandomEngine) % max_val;
+		return ThreadGenerator().Int(max_val);
 	}
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <string>
 #include <fstream>
 #include <sstream>
+#include <map>
 #include <glm/glm.hpp>
 
 class Shader
@@ -13,7 +14,7 @@ private:
 	std::string _vs_Filepath;
 	std::string _fs_Filepath;
 	unsigned int _RendererID;
-	std::unordered_map<std::string, int> _UniformLocationCache; //Caching for uniforms
+	std::map<std::string, int, std::less<>> _UniformLocationCache; //Caching for uniforms (transparent comparator -> lookup by const char* without building a std::string)
 
 	std::string GraspShader(const std::string& Filepath)
 	{
@@ -86,13 +87,14 @@ private:
 		return program;
 	}
 
-	int GetUniformLocation(const std::string& name)
+	int GetUniformLocation(const char* name)
 	{
-		if (_UniformLocationCache.find(name) != _UniformLocationCache.end())
-			return _UniformLocationCache[name];
+		auto cached = _UniformLocationCache.find(name);
+		if (cached != _UniformLocationCache.end())
+			return cached->second;
 
-		GLCall(int location = glGetUniformLocation(_RendererID, name.c_str()));
-		_UniformLocationCache[name] = location;
+		GLCall(int location = glGetUniformLocation(_RendererID, name));
+		_UniformLocationCache.emplace(name, location);
 
 		return location;
 	}
@@ -121,27 +123,32 @@ public:
 		GLCall(glUseProgram(0));
 	}
 
-	void SetUniform1i(const std::string& name, int value)
+	void SetUniform1i(const char* name, int value)
 	{
 		GLCall(glUniform1i(GetUniformLocation(name), value));
 	}
 
-	void SetUniform1f(const std::string& name, float value)
+	void SetUniform1f(const char* name, float value)
 	{
 		GLCall(glUniform1f(GetUniformLocation(name), value));
 	}
 
-	void SetUniform4f(const std::string& name, float v0, float v1, float v2, float v3)
+	void SetUniform2f(const char* name, float v0, float v1)
+	{
+		GLCall(glUniform2f(GetUniformLocation(name), v0, v1));
+	}
+
+	void SetUniform4f(const char* name, float v0, float v1, float v2, float v3)
 	{
 		GLCall(glUniform4f(GetUniformLocation(name), v0, v1, v2, v3));
 	}
 
-	void SetUniformMat4f(const std::string& name, const glm::mat4& matrix)
+	void SetUniformMat4f(const char* name, const glm::mat4& matrix)
 	{
 		GLCall(glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, &matrix[0][0]));
 	}
 
-	void SetUniformVec3(const std::string& name, const glm::vec3& vec)
+	void SetUniformVec3(const char* name, const glm::vec3& vec)
 	{
 		GLCall(glUniform3fv(GetUniformLocation(name), 1, &vec[0]));
 	}
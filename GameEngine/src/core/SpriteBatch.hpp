@@ -0,0 +1,256 @@
+#pragma once
+
+#include "VertexArray.hpp"
+#include "VertexBuffer.hpp"
+#include "IndexBuffer.hpp"
+#include "Shader.hpp"
+#include "Texture.hpp"
+#include <glm/glm.hpp>
+#include <xmmintrin.h>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+
+//One corner of a sprite quad: screen position, texture coordinates, RGBA8 colour and the slot of the texture it samples
+struct SpriteVertex
+{
+	glm::vec2 _position;
+	glm::vec2 _texCoords;
+	uint32_t _color;
+	float _texture;
+};
+
+//Collects sprites of any texture and draws them with as few draw calls as possible
+//-> corners get transformed on the CPU and appended to a streaming vertex buffer, up to MAX_TEXTURES textures share one draw (one sampler per texture unit)
+//A draw call happens when the batch is full, a 17th texture shows up or on flush()
+class SpriteBatch
+{
+public:
+	static const unsigned int MAX_TEXTURES = 16; //Texture units OpenGL 3.3 guarantees for the fragment shader
+
+private:
+	VertexArray* _vao = nullptr;
+	VertexBuffer* _vbo = nullptr;
+	IndexBuffer* _ib = nullptr;
+	Shader* _shader = nullptr;
+	glm::mat4 _projection;
+
+	unsigned int _maxQuads;
+	std::vector<SpriteVertex> _vertices; //Quads of the current batch
+	unsigned int _quads = 0;
+
+	//Streaming buffer: every batch gets written behind the previous one, the buffer gets orphaned once it's full
+	//-> the GPU can still read older batches while new ones get written
+	unsigned int _bufferQuads, _bufferOffset = 0;
+
+	const Texture* _textures[MAX_TEXTURES] = {};
+	unsigned int _textureCount = 0;
+
+	//Statistics since the last resetStats()
+	unsigned int _drawCalls = 0, _sprites = 0;
+
+	//Slot of the texture in the current batch, flushes first if all slots are taken by other textures
+	float textureSlot(const Texture* texture)
+	{
+		for (unsigned int i = 0; i < _textureCount; i++)
+		{
+			if (_textures[i] == texture)
+				return (float)i;
+		}
+
+		if (_textureCount == MAX_TEXTURES)
+			flush();
+
+		_textures[_textureCount] = texture;
+		return (float)_textureCount++;
+	}
+
+	SpriteVertex* appendQuad(const Texture* texture, float& slot)
+	{
+		if (_quads == _maxQuads)
+			flush();
+
+		slot = textureSlot(texture);
+		_sprites++;
+		return &_vertices[4 * _quads++];
+	}
+
+public:
+	//maxQuads = sprites per draw call, the streaming buffer holds 4 batches
+	SpriteBatch(Shader* shader, const glm::mat4& projection, unsigned int maxQuads = 10000)
+		: _shader(shader), _projection(projection), _maxQuads(maxQuads), _bufferQuads(maxQuads * 4)
+	{
+		_vertices.resize(4 * _maxQuads);
+
+		//Create and bind vao
+		_vao = new VertexArray();
+		_vao->bind();
+
+		//Streaming vbo
+		_vbo = new VertexBuffer(nullptr, _bufferQuads * 4 * sizeof(SpriteVertex), true);
+		_vao->DefineAttributes(0, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, _position));
+		_vao->DefineAttributes(1, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, _texCoords));
+		_vao->DefineAttributes(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, _color));
+		_vao->DefineAttributes(3, 1, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, _texture));
+
+		//Static ib: two triangles per quad, the draw calls move the base vertex through the streaming buffer
+		std::vector<unsigned int> indices(6 * _maxQuads);
+		for (unsigned int i = 0; i < _maxQuads; i++)
+		{
+			unsigned int* quad = &indices[6 * i];
+			quad[0] = 4 * i;
+			quad[1] = 4 * i + 1;
+			quad[2] = 4 * i + 2;
+			quad[3] = 4 * i + 2;
+			quad[4] = 4 * i + 3;
+			quad[5] = 4 * i;
+		}
+		_ib = new IndexBuffer(&indices[0], indices.size() * sizeof(unsigned int));
+
+		//Unbind vao and vbo
+		_vao->unbind();
+		_vbo->unbind();
+
+		//Texture unit i for sampler i
+		_shader->bind();
+		for (unsigned int i = 0; i < MAX_TEXTURES; i++)
+		{
+			char name[16];
+			snprintf(name, sizeof(name), "textures[%u]", i);
+			_shader->SetUniform1i(name, (int)i);
+		}
+	}
+
+	~SpriteBatch()
+	{
+		delete _vao;
+		delete _vbo;
+		delete _ib;
+	}
+
+	//RGBA8 colour of the vertices, colours that don't change can be packed once and drawn with the packed overload
+	static uint32_t packColor(const glm::vec4& color)
+	{
+		glm::vec4 clamped = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+		return (uint32_t)clamped.r | ((uint32_t)clamped.g << 8) | ((uint32_t)clamped.b << 16) | ((uint32_t)clamped.a << 24);
+	}
+
+	//Axis aligned sprite, position = top left corner
+	void draw(const Texture* texture, const glm::vec2& position, const glm::vec2& size, const glm::vec4& color)
+	{
+		draw(texture, position, size, packColor(color));
+	}
+
+	//Axis aligned sprite with a colour from packColor()
+	void draw(const Texture* texture, const glm::vec2& position, const glm::vec2& size, uint32_t packedColor)
+	{
+		float slot;
+		SpriteVertex* quad = appendQuad(texture, slot);
+
+		//Corners clockwise starting top left, texture coordinates follow the position inside the quad
+		const glm::vec2 max = position + size;
+		quad[0] = { position, glm::vec2(0.0f, 0.0f), packedColor, slot };
+		quad[1] = { glm::vec2(max.x, position.y), glm::vec2(1.0f, 0.0f), packedColor, slot };
+		quad[2] = { max, glm::vec2(1.0f, 1.0f), packedColor, slot };
+		quad[3] = { glm::vec2(position.x, max.y), glm::vec2(0.0f, 1.0f), packedColor, slot };
+	}
+
+	//Sprite rotated around its center, rotation in degrees
+	void draw(const Texture* texture, const glm::vec2& position, const glm::vec2& size, float rotation, const glm::vec4& color)
+	{
+		if (rotation == 0.0f)
+		{
+			draw(texture, position, size, color);
+			return;
+		}
+
+		float slot;
+		SpriteVertex* quad = appendQuad(texture, slot);
+		const uint32_t packedColor = packColor(color);
+
+		//All 4 corners at once: corner = center + (dx * cos - dy * sin, dx * sin + dy * cos)
+		const float radians = glm::radians(rotation);
+		const __m128 cosine = _mm_set1_ps(std::cos(radians));
+		const __m128 sine = _mm_set1_ps(std::sin(radians));
+		const glm::vec2 half = 0.5f * size;
+		const __m128 dx = _mm_setr_ps(-half.x, half.x, half.x, -half.x);
+		const __m128 dy = _mm_setr_ps(-half.y, -half.y, half.y, half.y);
+		const __m128 x = _mm_add_ps(_mm_set1_ps(position.x + half.x), _mm_sub_ps(_mm_mul_ps(dx, cosine), _mm_mul_ps(dy, sine)));
+		const __m128 y = _mm_add_ps(_mm_set1_ps(position.y + half.y), _mm_add_ps(_mm_mul_ps(dx, sine), _mm_mul_ps(dy, cosine)));
+
+		alignas(16) float xs[4], ys[4];
+		_mm_store_ps(xs, x);
+		_mm_store_ps(ys, y);
+
+		quad[0] = { glm::vec2(xs[0], ys[0]), glm::vec2(0.0f, 0.0f), packedColor, slot };
+		quad[1] = { glm::vec2(xs[1], ys[1]), glm::vec2(1.0f, 0.0f), packedColor, slot };
+		quad[2] = { glm::vec2(xs[2], ys[2]), glm::vec2(1.0f, 1.0f), packedColor, slot };
+		quad[3] = { glm::vec2(xs[3], ys[3]), glm::vec2(0.0f, 1.0f), packedColor, slot };
+	}
+
+	//Draws everything collected so far, has to be called before anything else gets rendered on top
+	void flush()
+	{
+		if (_quads == 0)
+			return;
+
+		//Write the batch behind the previous ones without waiting for the GPU, orphan the buffer once it's full
+		_vbo->bind();
+		GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+		if (_bufferOffset + _quads > _bufferQuads)
+		{
+			_bufferOffset = 0;
+			access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT;
+		}
+
+		const unsigned int quadBytes = 4 * sizeof(SpriteVertex);
+		void* ptr = _vbo->map(_bufferOffset * quadBytes, _quads * quadBytes, access);
+		if (ptr)
+		{
+			std::memcpy(ptr, &_vertices[0], _quads * quadBytes);
+			_vbo->unmap();
+		}
+		_vbo->unbind();
+
+		//Bind shader and textures
+		_shader->bind();
+		_shader->SetUniformMat4f("projection", _projection);
+		for (unsigned int i = 0; i < _textureCount; i++)
+			_textures[i]->bind(i);
+		GLCall(glActiveTexture(GL_TEXTURE0));
+
+		//Render quads
+		_vao->bind();
+		GLCall(glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)(6 * _quads), GL_UNSIGNED_INT, nullptr, (GLint)(4 * _bufferOffset)));
+		_vao->unbind();
+
+		_drawCalls++;
+		_bufferOffset += _quads;
+		_quads = 0;
+		_textureCount = 0;
+	}
+
+	void resetStats()
+	{
+		_drawCalls = 0;
+		_sprites = 0;
+	}
+
+	unsigned int getDrawCalls() const
+	{
+		return _drawCalls;
+	}
+
+	unsigned int getSpriteCount() const
+	{
+		return _sprites;
+	}
+
+	glm::mat4 getProjectionMatrix() const
+	{
+		return _projection;
+	}
+};
\ No newline at end of file
@@ -40,8 +40,42 @@ public:
 		GLCall(glBindBuffer(GL_ARRAY_BUFFER, 0));
 	}
 
-	void updateData(const void* data, unsigned int size)
+	void updateData(const void* data, unsigned int size, unsigned int offset = 0)
 	{
-		GLCall(glBufferSubData(GL_ARRAY_BUFFER, 0, size, data));
+		GLCall(glBufferSubData(GL_ARRAY_BUFFER, offset, size, data));
+	}
+
+	//Replaces the buffer with a bigger (dynamic) one, the first keepSize bytes get copied over on the GPU
+	//The buffer is bound afterwards -> vertex attributes that point to it have to be defined again
+	void resize(unsigned int size, unsigned int keepSize)
+	{
+		unsigned int newID = 0;
+		GLCall(glGenBuffers(1, &newID));
+		GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, newID));
+		GLCall(glBufferData(GL_COPY_WRITE_BUFFER, size, nullptr, GL_DYNAMIC_DRAW));
+
+		if (keepSize > 0)
+		{
+			GLCall(glBindBuffer(GL_COPY_READ_BUFFER, _RendererID));
+			GLCall(glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, keepSize));
+			GLCall(glBindBuffer(GL_COPY_READ_BUFFER, 0));
+		}
+
+		GLCall(glBindBuffer(GL_COPY_WRITE_BUFFER, 0));
+		GLCall(glDeleteBuffers(1, &_RendererID));
+		_RendererID = newID;
+		GLCall(glBindBuffer(GL_ARRAY_BUFFER, _RendererID));
+	}
+
+	//Maps a range of the (bound) buffer into client memory -> data can be written in place without a CPU-side copy
+	void* map(unsigned int offset, unsigned int size, GLbitfield access = GL_MAP_WRITE_BIT)
+	{
+		GLCall(void* ptr = glMapBufferRange(GL_ARRAY_BUFFER, offset, size, access));
+		return ptr;
+	}
+
+	void unmap()
+	{
+		GLCall(glUnmapBuffer(GL_ARRAY_BUFFER));
 	}
 };
\ No newline at end of file
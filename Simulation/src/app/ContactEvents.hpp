@@ -0,0 +1,62 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+//Kinds of contact events, also used as the per body interest flags
+enum ContactEventType
+{
+	CONTACT_NEW = 1, //The bodies started touching in this step
+	CONTACT_PERSISTING = 2, //The bodies were already touching in the step before
+	CONTACT_ENDED = 4, //The bodies stopped touching (no impulse, point or normal)
+	CONTACT_ALL = CONTACT_NEW | CONTACT_PERSISTING | CONTACT_ENDED
+};
+
+//Contact events of the last simulate call as parallel arrays (event i = entry i of every array)
+//Pairs are sorted by their body indices, _bodyA is always the smaller one
+//The arrays keep their memory between steps, so consuming systems can walk them in bulk without any allocations
+struct ContactEvents
+{
+	std::vector<uint8_t> _types;
+	std::vector<unsigned int> _bodyA, _bodyB;
+	std::vector<float> _impulses; //Sum of the impulses the solver applied over all contact points of the pair
+	std::vector<glm::vec3> _points; //Contact point with the biggest impulse (on body B)
+	std::vector<glm::vec3> _normals; //Points from body B to body A
+	unsigned int _newCount = 0, _persistingCount = 0, _endedCount = 0;
+
+	void clear()
+	{
+		_types.clear();
+		_bodyA.clear();
+		_bodyB.clear();
+		_impulses.clear();
+		_points.clear();
+		_normals.clear();
+		_newCount = 0;
+		_persistingCount = 0;
+		_endedCount = 0;
+	}
+
+	void add(ContactEventType type, unsigned int bodyA, unsigned int bodyB, float impulse, const glm::vec3& point, const glm::vec3& normal)
+	{
+		_types.push_back((uint8_t)type);
+		_bodyA.push_back(bodyA);
+		_bodyB.push_back(bodyB);
+		_impulses.push_back(impulse);
+		_points.push_back(point);
+		_normals.push_back(normal);
+
+		if (type == CONTACT_NEW)
+			_newCount++;
+		else if (type == CONTACT_PERSISTING)
+			_persistingCount++;
+		else
+			_endedCount++;
+	}
+
+	unsigned int size() const
+	{
+		return (unsigned int)_types.size();
+	}
+};
\ No newline at end of file
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "SphFluid.hpp"
+#include "ObjectSpawner.hpp"
+#include "Texture.hpp"
+#include "Shader.hpp"
+#include "Data.hpp"
+#include "VertexArray.hpp"
+#include "VertexBuffer.hpp"
+#include "IndexBuffer.hpp"
+
+//Draws the particles of a SphFluid with one instanced call -> same shader and vertex layout as the instanced spheres of the ObjectSpawner
+//Every particle moves every frame, so the instance buffers get uploaded completely instead of in dirty ranges
+class FluidRenderer
+{
+private:
+	SphFluid* _fluid = nullptr;
+	Texture* _texture = nullptr;
+	Shader* _shader = nullptr;
+	Data* _data = nullptr;
+	VertexBuffer* _vbo1 = nullptr, * _vbo2 = nullptr, * _vbo3 = nullptr, * _vbo4 = nullptr;
+	VertexArray* _vao = nullptr;
+	IndexBuffer* _ib = nullptr;
+	unsigned int _vertices = 0;
+
+	//CPU copies of the instance buffers
+	std::vector<glm::vec3> _colorBuffer;
+	std::vector<InstanceTransform> _transformBuffer;
+
+public:
+	FluidRenderer(SphFluid* fluid)
+		: _fluid(fluid)
+	{
+
+	}
+
+	~FluidRenderer()
+	{
+		delete _vbo1;
+		delete _vbo2;
+		delete _vbo3;
+		delete _vbo4;
+
+		delete _vao;
+
+		delete _ib;
+	}
+
+	//data = particle mesh with radius 1 (gets scaled to the particle size)
+	void init(Texture* texture, Shader* shader, Data* data)
+	{
+		_texture = texture;
+		_shader = shader;
+		_data = data;
+
+		unsigned int particles = _fluid->getParticleCount();
+		_colorBuffer.resize(particles);
+		_transformBuffer.resize(particles);
+
+		//Create and bind vao
+		_vao = new VertexArray();
+		_vao->bind();
+
+		//Mesh (vbo1 vertices, vbo2 texture coordinates, ib) and the instance buffers (vbo3 colors, vbo4 transforms) -> one instance per particle
+		_vbo1 = new VertexBuffer(&_data->_vertices[0], _data->_vertices.size() * sizeof(glm::vec3));
+		_vbo2 = new VertexBuffer(&_data->_texCoords[0], _data->_texCoords.size() * sizeof(glm::vec2));
+		_ib = new IndexBuffer(&_data->_indices[0], _data->_indices.size() * sizeof(glm::uvec3));
+		_vertices = _data->_indices.size() * 3;
+		ObjectSpawner::defineMeshAttributes(_vao, _vbo1, _vbo2, _ib);
+
+		_vbo3 = new VertexBuffer(nullptr, particles * sizeof(glm::vec3), true);
+		_vbo4 = new VertexBuffer(nullptr, particles * sizeof(InstanceTransform), true);
+		ObjectSpawner::defineInstanceAttributes(_vao, _vbo3, _vbo4);
+
+		//Unbind vao and vbo's
+		_vbo4->unbind();
+		_vao->unbind();
+	}
+
+	unsigned int getVerticesToRender() const
+	{
+		return _vertices * _fluid->getParticleCount();
+	}
+
+	void render()
+	{
+		unsigned int particles = _fluid->getParticleCount();
+		if (particles == 0)
+			return;
+
+		//Particles get drawn a bit bigger than half their spacing -> the fluid looks closed
+		_fluid->writeInstances(&_transformBuffer[0], &_colorBuffer[0], _fluid->getParticleSpacing() * 0.6f);
+
+		_vbo3->bind();
+		_vbo3->updateData(&_colorBuffer[0], particles * sizeof(glm::vec3));
+		_vbo4->bind();
+		_vbo4->updateData(&_transformBuffer[0], particles * sizeof(InstanceTransform));
+		_vbo4->unbind();
+
+		//Bind shader and set uniforms
+		_shader->bind();
+		_shader->SetUniformMat4f("projection", glm::perspective(glm::radians(camera.Zoom), (float)WIDTH / (float)HEIGHT, 0.1f, 1000.0f));
+		_shader->SetUniformMat4f("view", camera.GetViewMatrix());
+
+		//Set texture and render instanced
+		_texture->bind();
+		_vao->bind();
+		GLCall(glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)_vertices, GL_UNSIGNED_INT, nullptr, particles));
+	}
+};
\ No newline at end of file
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "PhysicsEngine.hpp"
+#include "ProcessMemory.hpp"
+#include <spdlog/spdlog.h>
+#include <spdlog/fmt/fmt.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+//Configuration of a headless run (every value can be set on the command line)
+struct HeadlessSettings
+{
+	unsigned int _spheres = 10000;
+	unsigned int _warmupSteps = 60;
+	unsigned int _steps = 600;
+	float _dt = 1.0f / 60.0f;
+	unsigned int _threads = 1;
+	PhysicsSolver _solver = SOLVER_SEQUENTIAL_IMPULSE;
+	PhysicsBroadphase _broadphase = BROADPHASE_DBVT;
+	uint32_t _seed = 1337;
+	std::string _reportFile; //Empty = print the report to stdout
+};
+
+//Builds the Simulation world (200x200 plane, spheres dropped from up to 50 units) without a window or GL context,
+//steps it with a fixed dt and writes a JSON report -> meant for build agents that track physics performance over time
+class HeadlessBenchmark
+{
+private:
+	struct Series
+	{
+		std::vector<float> _values;
+
+		void reserve(unsigned int count)
+		{
+			_values.reserve(count);
+		}
+
+		void add(float value)
+		{
+			_values.push_back(value);
+		}
+
+		//Nearest rank on the sorted values
+		float percentile(float p) const
+		{
+			if (_values.empty())
+				return 0.0f;
+
+			std::vector<float> sorted(_values);
+			std::sort(sorted.begin(), sorted.end());
+			size_t rank = (size_t)(p / 100.0f * (sorted.size() - 1) + 0.5f);
+			return sorted[std::min(rank, sorted.size() - 1)];
+		}
+
+		float mean() const
+		{
+			double sum = 0.0;
+			for (float value : _values)
+				sum += value;
+			return _values.empty() ? 0.0f : (float)(sum / _values.size());
+		}
+
+		float max() const
+		{
+			return _values.empty() ? 0.0f : *std::max_element(_values.begin(), _values.end());
+		}
+	};
+
+	static std::string formatSeries(const Series& series)
+	{
+		return fmt::format("{{ \"mean\": {:.4f}, \"p50\": {:.4f}, \"p90\": {:.4f}, \"p95\": {:.4f}, \"p99\": {:.4f}, \"max\": {:.4f} }}",
+			series.mean(), series.percentile(50.0f), series.percentile(90.0f), series.percentile(95.0f), series.percentile(99.0f), series.max());
+	}
+
+public:
+	//Returns false if the report couldn't be written
+	static bool run(const HeadlessSettings& settings)
+	{
+		size_t memoryBefore = ProcessMemory::getCurrentBytes();
+		auto setupStart = std::chrono::high_resolution_clock::now();
+
+		//The 16 bit sweep and prune can't hold more bodies
+		PhysicsBroadphase broadphase = settings._broadphase;
+		if (broadphase == BROADPHASE_AXIS_SWEEP && settings._spheres + 1 > PHYSICS_AXIS_SWEEP_HANDLES)
+		{
+			spdlog::warn("Headless: {} spheres are too many for the {} broadphase, using {}", settings._spheres, PHYSICS_BROADPHASE_NAMES[broadphase], PHYSICS_BROADPHASE_NAMES[BROADPHASE_AXIS_SWEEP_32]);
+			broadphase = BROADPHASE_AXIS_SWEEP_32;
+		}
+
+		PhysicsEngine physicsEngine(settings._threads, settings._solver, broadphase);
+		physicsEngine.setSeed(settings._seed + 1);
+		physicsEngine.reserve(settings._spheres + 1);
+
+		//Spheres get generated like ObjectSpawner::spawnRandom does it (same seed -> same positions, body parameters and order)
+		random::Generator generator(settings._seed);
+		std::vector<glm::vec3> positions(settings._spheres);
+		if (settings._spheres > 0)
+			generator.fillVec3(&positions[0], settings._spheres, glm::vec3(0.0f), glm::vec3(200.0f, 50.0f, 200.0f));
+		for (const glm::vec3& position : positions)
+			physicsEngine.addSphere(position, 60.0, 0.8f, 1.0f);
+
+		physicsEngine.addBox(glm::vec3(100.0f, 0.0f, 100.0f), glm::vec3(100.0f, 0.1f, 100.0f), 0.0, 1.0f, 1.0f);
+
+		float setupTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - setupStart).count();
+		size_t memorySetup = ProcessMemory::getCurrentBytes();
+
+		for (unsigned int i = 0; i < settings._warmupSteps; i++)
+			physicsEngine.simulate(settings._dt);
+
+		//Only the step itself gets timed, the pair counting happens outside of it
+		Series stepTimes, broadphaseTimes, overlappingPairs, contactPairs;
+		stepTimes.reserve(settings._steps);
+		broadphaseTimes.reserve(settings._steps);
+		overlappingPairs.reserve(settings._steps);
+		contactPairs.reserve(settings._steps);
+		double totalStepTime = 0.0;
+
+		for (unsigned int i = 0; i < settings._steps; i++)
+		{
+			physicsEngine.simulate(settings._dt);
+			stepTimes.add(physicsEngine.getLastStepTime());
+			totalStepTime += physicsEngine.getLastStepTime();
+			broadphaseTimes.add(physicsEngine.getLastBroadphaseTime());
+
+			overlappingPairs.add((float)physicsEngine.getOverlappingPairCount());
+			contactPairs.add((float)physicsEngine.getContactPairCount());
+		}
+
+		unsigned int contactPoints = 0;
+		unsigned int finalContactPairs = physicsEngine.getContactPairCount(&contactPoints);
+		float stepsPerSecond = totalStepTime > 0.0 ? (float)(settings._steps * 1000.0 / totalStepTime) : 0.0f;
+		size_t memoryFinal = ProcessMemory::getCurrentBytes();
+		size_t memoryPeak = std::max(ProcessMemory::getPeakBytes(), memoryFinal); //The OS can update the peak lazily
+
+		std::string report = "{\n";
+		report += fmt::format("  \"spheres\": {},\n", settings._spheres);
+		report += fmt::format("  \"warmup_steps\": {},\n", settings._warmupSteps);
+		report += fmt::format("  \"steps\": {},\n", settings._steps);
+		report += fmt::format("  \"dt\": {:.6f},\n", settings._dt);
+		report += fmt::format("  \"threads\": {},\n", physicsEngine.getThreadCount());
+		report += fmt::format("  \"solver\": \"{}\",\n", PHYSICS_SOLVER_NAMES[settings._solver]);
+		report += fmt::format("  \"broadphase\": \"{}\",\n", PHYSICS_BROADPHASE_NAMES[broadphase]);
+		report += fmt::format("  \"seed\": {},\n", settings._seed);
+		report += fmt::format("  \"setup_ms\": {:.3f},\n", setupTime);
+		report += fmt::format("  \"total_step_ms\": {:.3f},\n", totalStepTime);
+		report += fmt::format("  \"steps_per_second\": {:.2f},\n", stepsPerSecond);
+		report += fmt::format("  \"step_ms\": {},\n", formatSeries(stepTimes));
+		report += fmt::format("  \"broadphase_ms\": {},\n", formatSeries(broadphaseTimes));
+		report += fmt::format("  \"overlapping_pairs\": {},\n", formatSeries(overlappingPairs));
+		report += fmt::format("  \"contact_pairs\": {},\n", formatSeries(contactPairs));
+		report += fmt::format("  \"final_contact_pairs\": {},\n", finalContactPairs);
+		report += fmt::format("  \"final_contact_points\": {},\n", contactPoints);
+		report += fmt::format("  \"memory\": {{ \"before_setup_bytes\": {}, \"after_setup_bytes\": {}, \"final_bytes\": {}, \"peak_bytes\": {} }},\n",
+			memoryBefore, memorySetup, memoryFinal, memoryPeak);
+		report += fmt::format("  \"state_hash\": \"{:016x}\"\n", physicsEngine.computeStateHash());
+		report += "}\n";
+
+		//stdout only gets the report, so it can be piped straight into other tools
+		if (settings._reportFile.empty())
+		{
+			std::fwrite(report.data(), 1, report.size(), stdout);
+			std::fflush(stdout);
+			return true;
+		}
+
+		std::ofstream file(settings._reportFile);
+		file << report;
+		if (!file)
+		{
+			spdlog::error("Couldn't write headless report {}", settings._reportFile);
+			return false;
+		}
+
+		spdlog::info("Headless: {} spheres, {} steps, {:.1f} steps/s, p50 {:.3f} ms, p99 {:.3f} ms -> {}", settings._spheres, settings._steps, stepsPerSecond, stepTimes.percentile(50.0f), stepTimes.percentile(99.0f), settings._reportFile);
+
+		return true;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,726 @@
+#pragma once
+
+#include "JobSystem.hpp"
+#include "CpuFeatures.hpp"
+#include "FixedStep.hpp"
+#include "InstanceTransform.hpp"
+#include "Random.hpp"
+#include <glm/glm.hpp>
+#include <immintrin.h>
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+//Configuration of the gravitational N-body simulation (G = 1, the units are the world units of the Simulation)
+struct NBodySettings
+{
+	unsigned int _bodies = 20000;
+	float _theta = 0.5f; //Opening angle: a tree node counts as one body if its size / distance is below theta (0 = exact)
+	float _softening = 0.5f; //Keeps close encounters finite
+	float _centralMass = 4000.0f; //Heavy body in the middle of the disk
+	float _diskMass = 2000.0f; //Spread over all other bodies
+	float _innerRadius = 4.0f, _outerRadius = 40.0f, _thickness = 0.5f;
+	glm::vec3 _center = glm::vec3(100.0f, 60.0f, 100.0f); //Above the middle of the plane
+	float _timeStep = 1.0f / 120.0f;
+	unsigned int _maxSubsteps = 2; //Per update
+	bool _simd = true; //Use the AVX2 force kernel if the CPU supports it
+	uint32_t _seed = 1337;
+};
+
+//Barnes-Hut gravity: the octree gets rebuilt every step from Morton sorted bodies, the top levels serially and the subtrees
+//below them in parallel, and is stored depth-first in one array (children follow their parent, _next skips a subtree)
+//Forces get evaluated per group (subtree with up to GROUP_SIZE bodies): one walk with the group's bounding box collects an
+//interaction list (node centers of mass and single bodies), which the bodies of the group then sum up 8 entries at a time with AVX2
+//The bodies start as a rotating disk around a heavy center
+class NBodySimulation
+{
+public:
+	//Times of the last step in ms
+	struct StepTimes
+	{
+		float _tree = 0.0f, _forces = 0.0f, _integrate = 0.0f;
+
+		float total() const
+		{
+			return _tree + _forces + _integrate;
+		}
+	};
+
+private:
+	static const unsigned int LEAF_SIZE = 16;
+	static const unsigned int GROUP_SIZE = 64; //Bodies that share one tree walk
+	static const unsigned int TOP_LEVELS = 3; //Subtrees below this level get built in parallel (at most 8^3 of them)
+	static const unsigned int MAX_LEVEL = 16; //Morton codes have 16 bits per axis
+	static const unsigned int RADIX_BITS = 12; //4 passes over the 48 bit codes
+	static const unsigned int PADDING = 8;
+
+	//32 bytes -> two nodes per cache line
+	struct Node
+	{
+		float _x, _y, _z, _mass; //Center of mass and total mass
+		float _openDistance2; //(side / theta)^2 -> the node can be used as a whole by groups that are further away
+		unsigned int _next; //Index of the first node after this subtree (_next = index + 1 -> leaf)
+		unsigned int _first, _count; //Bodies in this subtree
+	};
+
+	struct Task
+	{
+		unsigned int _begin, _end, _level;
+	};
+
+	//Interaction list of one thread, padded to a multiple of 8 with massless entries
+	struct InteractionList
+	{
+		std::vector<float> _x, _y, _z, _mass;
+		unsigned long long _interactions = 0;
+
+		void clear()
+		{
+			_x.clear();
+			_y.clear();
+			_z.clear();
+			_mass.clear();
+		}
+
+		void add(float x, float y, float z, float mass)
+		{
+			_x.push_back(x);
+			_y.push_back(y);
+			_z.push_back(z);
+			_mass.push_back(mass);
+		}
+
+		void pad()
+		{
+			while (_x.size() % 8 != 0)
+				add(0.0f, 0.0f, 0.0f, 0.0f);
+		}
+	};
+
+	NBodySettings _settings;
+	JobSystem& _jobSystem;
+	bool _simd;
+	unsigned int _count;
+
+	//Bodies (structure of arrays), sorted by Morton code after every tree build
+	std::vector<float> _px, _py, _pz, _vx, _vy, _vz, _mass;
+	std::vector<float> _ax, _ay, _az;
+	std::vector<unsigned int> _ids; //Body number of every entry -> stable instance slot
+
+	//Sorting
+	std::vector<uint64_t> _codes, _sortedCodes;
+	std::vector<unsigned int> _order, _sortedOrder;
+	std::vector<unsigned int> _histogram;
+	std::vector<float> _scratch;
+	std::vector<unsigned int> _idScratch;
+	std::vector<glm::vec3> _threadMin, _threadMax;
+
+	//Tree
+	glm::vec3 _rootMin;
+	float _rootSize;
+	std::vector<Node> _nodes;
+	std::vector<Task> _tasks;
+	std::vector<std::vector<Node>> _taskNodes;
+	std::vector<unsigned int> _groups;
+	std::vector<InteractionList> _lists;
+
+	FixedStep _fixedStep;
+	StepTimes _times;
+	float _interactionsPerBody = 0.0f;
+
+	//Spreads the lower 16 bits of value so that two zero bits follow every bit
+	static uint64_t expandBits(uint64_t value)
+	{
+		value &= 0xFFFF;
+		value = (value | (value << 32)) & 0x0000FFFF0000FFFFull;
+		value = (value | (value << 16)) & 0x00FF0000FF0000FFull;
+		value = (value | (value << 8)) & 0xF00F00F00F00F00Full;
+		value = (value | (value << 4)) & 0x30C30C30C30C30C3ull;
+		value = (value | (value << 2)) & 0x9249249249249249ull;
+		return value;
+	}
+
+	static unsigned int octant(uint64_t code, unsigned int level)
+	{
+		return (unsigned int)(code >> (3 * (MAX_LEVEL - 1 - level))) & 7;
+	}
+
+	//Disk with a surface density that falls off with the radius, every body on a (roughly) circular orbit
+	void createDisk()
+	{
+		random::Generator generator(_settings._seed);
+		float bodyMass = _count > 1 ? _settings._diskMass / (_count - 1) : 0.0f;
+		const float pi = 3.14159265358979f;
+
+		for (unsigned int i = 0; i < _count; i++)
+		{
+			_ids[i] = i;
+
+			if (i == 0)
+			{
+				_px[i] = _settings._center.x;
+				_py[i] = _settings._center.y;
+				_pz[i] = _settings._center.z;
+				_mass[i] = _settings._centralMass;
+				continue;
+			}
+
+			float radius = generator.Float(_settings._innerRadius, _settings._outerRadius);
+			float angle = generator.Float(0.0f, 2.0f * pi);
+			float height = generator.Float(-_settings._thickness, _settings._thickness);
+
+			//Disk mass inside the orbit for a density proportional to 1 / r, treated as if it were spherical
+			float inner = (radius - _settings._innerRadius) / (_settings._outerRadius - _settings._innerRadius);
+			float speed = std::sqrt((_settings._centralMass + _settings._diskMass * inner) / radius);
+
+			_px[i] = _settings._center.x + std::cos(angle) * radius;
+			_py[i] = _settings._center.y + height;
+			_pz[i] = _settings._center.z + std::sin(angle) * radius;
+			_vx[i] = -std::sin(angle) * speed;
+			_vz[i] = std::cos(angle) * speed;
+			_mass[i] = bodyMass;
+		}
+	}
+
+	//Bounding cube of all bodies
+	void computeBounds()
+	{
+		std::fill(_threadMin.begin(), _threadMin.end(), glm::vec3(FLT_MAX));
+		std::fill(_threadMax.begin(), _threadMax.end(), glm::vec3(-FLT_MAX));
+
+		_jobSystem.parallelFor(0, (int)_count, 4096, [&](int begin, int end)
+		{
+			unsigned int thread = JobSystem::getThreadIndex();
+			glm::vec3 min = _threadMin[thread], max = _threadMax[thread];
+			for (int i = begin; i < end; i++)
+			{
+				glm::vec3 position(_px[i], _py[i], _pz[i]);
+				min = glm::min(min, position);
+				max = glm::max(max, position);
+			}
+			_threadMin[thread] = min;
+			_threadMax[thread] = max;
+		});
+
+		glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+		for (size_t t = 0; t < _threadMin.size(); t++)
+		{
+			min = glm::min(min, _threadMin[t]);
+			max = glm::max(max, _threadMax[t]);
+		}
+
+		glm::vec3 extent = max - min;
+		_rootSize = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-3f)) * 1.001f;
+		_rootMin = min;
+	}
+
+	//Morton codes in parallel, then an LSD radix sort of (code, body) pairs and the reordering of all body arrays
+	void sortBodies()
+	{
+		float scale = (float)(1 << MAX_LEVEL) / _rootSize;
+		_jobSystem.parallelFor(0, (int)_count, 4096, [&](int begin, int end)
+		{
+			const uint64_t maxCell = (1 << MAX_LEVEL) - 1;
+			for (int i = begin; i < end; i++)
+			{
+				uint64_t x = std::min((uint64_t)((_px[i] - _rootMin.x) * scale), maxCell);
+				uint64_t y = std::min((uint64_t)((_py[i] - _rootMin.y) * scale), maxCell);
+				uint64_t z = std::min((uint64_t)((_pz[i] - _rootMin.z) * scale), maxCell);
+				_codes[i] = (expandBits(x) << 2) | (expandBits(y) << 1) | expandBits(z);
+				_order[i] = i;
+			}
+		});
+
+		const unsigned int buckets = 1 << RADIX_BITS;
+		for (unsigned int shift = 0; shift < 3 * MAX_LEVEL; shift += RADIX_BITS)
+		{
+			std::fill(_histogram.begin(), _histogram.end(), 0u);
+			for (unsigned int i = 0; i < _count; i++)
+				_histogram[(_codes[i] >> shift) & (buckets - 1)]++;
+
+			unsigned int sum = 0;
+			for (unsigned int b = 0; b < buckets; b++)
+			{
+				unsigned int count = _histogram[b];
+				_histogram[b] = sum;
+				sum += count;
+			}
+
+			for (unsigned int i = 0; i < _count; i++)
+			{
+				unsigned int target = _histogram[(_codes[i] >> shift) & (buckets - 1)]++;
+				_sortedCodes[target] = _codes[i];
+				_sortedOrder[target] = _order[i];
+			}
+
+			_codes.swap(_sortedCodes);
+			_order.swap(_sortedOrder);
+		}
+
+		for (std::vector<float>* array : { &_px, &_py, &_pz, &_vx, &_vy, &_vz, &_mass })
+		{
+			std::vector<float>& values = *array;
+			_jobSystem.parallelFor(0, (int)_count, 4096, [&](int begin, int end)
+			{
+				for (int i = begin; i < end; i++)
+					_scratch[i] = values[_order[i]];
+			});
+			std::copy(_scratch.begin(), _scratch.begin() + _count, values.begin());
+		}
+
+		for (unsigned int i = 0; i < _count; i++)
+			_idScratch[i] = _ids[_order[i]];
+		_ids.swap(_idScratch);
+	}
+
+	//Child ranges of a node: the bodies are sorted, so every octant is a contiguous part of [begin, end)
+	void childRanges(unsigned int begin, unsigned int end, unsigned int level, unsigned int* bounds) const
+	{
+		bounds[0] = begin;
+		for (unsigned int digit = 0; digit < 8; digit++)
+		{
+			bounds[digit + 1] = (unsigned int)(std::upper_bound(_codes.begin() + bounds[digit], _codes.begin() + end, digit,
+				[level](unsigned int value, uint64_t code) { return value < octant(code, level); }) - _codes.begin());
+		}
+	}
+
+	bool isTask(unsigned int begin, unsigned int end, unsigned int level) const
+	{
+		return level == TOP_LEVELS || end - begin <= LEAF_SIZE;
+	}
+
+	void finishNode(Node& node, unsigned int level, float x, float y, float z, float mass) const
+	{
+		node._mass = mass;
+		node._x = mass > 0.0f ? x / mass : 0.0f;
+		node._y = mass > 0.0f ? y / mass : 0.0f;
+		node._z = mass > 0.0f ? z / mass : 0.0f;
+
+		float side = _rootSize / (float)(1 << level);
+		node._openDistance2 = _settings._theta > 0.0f ? (side / _settings._theta) * (side / _settings._theta) : FLT_MAX;
+	}
+
+	//Depth-first into nodes, _next relative to the start of nodes
+	void buildSubtree(unsigned int begin, unsigned int end, unsigned int level, std::vector<Node>& nodes) const
+	{
+		unsigned int index = (unsigned int)nodes.size();
+		nodes.push_back(Node());
+		float x = 0.0f, y = 0.0f, z = 0.0f, mass = 0.0f;
+
+		if (end - begin <= LEAF_SIZE || level == MAX_LEVEL)
+		{
+			for (unsigned int i = begin; i < end; i++)
+			{
+				x += _px[i] * _mass[i];
+				y += _py[i] * _mass[i];
+				z += _pz[i] * _mass[i];
+				mass += _mass[i];
+			}
+		}
+		else
+		{
+			unsigned int bounds[9];
+			childRanges(begin, end, level, bounds);
+			for (unsigned int digit = 0; digit < 8; digit++)
+			{
+				if (bounds[digit] == bounds[digit + 1])
+					continue;
+
+				unsigned int child = (unsigned int)nodes.size();
+				buildSubtree(bounds[digit], bounds[digit + 1], level + 1, nodes);
+				x += nodes[child]._x * nodes[child]._mass;
+				y += nodes[child]._y * nodes[child]._mass;
+				z += nodes[child]._z * nodes[child]._mass;
+				mass += nodes[child]._mass;
+			}
+		}
+
+		nodes[index]._first = begin;
+		nodes[index]._count = end - begin;
+		finishNode(nodes[index], level, x, y, z, mass);
+		nodes[index]._next = (unsigned int)nodes.size();
+	}
+
+	void collectTasks(unsigned int begin, unsigned int end, unsigned int level)
+	{
+		if (isTask(begin, end, level))
+		{
+			_tasks.push_back({ begin, end, level });
+			return;
+		}
+
+		unsigned int bounds[9];
+		childRanges(begin, end, level, bounds);
+		for (unsigned int digit = 0; digit < 8; digit++)
+		{
+			if (bounds[digit] != bounds[digit + 1])
+				collectTasks(bounds[digit], bounds[digit + 1], level + 1);
+		}
+	}
+
+	//Same recursion as collectTasks -> the subtrees of the tasks get copied in at their place of the depth-first order
+	unsigned int assemble(unsigned int begin, unsigned int end, unsigned int level, unsigned int& task)
+	{
+		unsigned int index = (unsigned int)_nodes.size();
+
+		if (isTask(begin, end, level))
+		{
+			for (const Node& node : _taskNodes[task])
+			{
+				_nodes.push_back(node);
+				_nodes.back()._next += index;
+			}
+			task++;
+			return index;
+		}
+
+		_nodes.push_back(Node());
+		float x = 0.0f, y = 0.0f, z = 0.0f, mass = 0.0f;
+
+		unsigned int bounds[9];
+		childRanges(begin, end, level, bounds);
+		for (unsigned int digit = 0; digit < 8; digit++)
+		{
+			if (bounds[digit] == bounds[digit + 1])
+				continue;
+
+			unsigned int child = assemble(bounds[digit], bounds[digit + 1], level + 1, task);
+			x += _nodes[child]._x * _nodes[child]._mass;
+			y += _nodes[child]._y * _nodes[child]._mass;
+			z += _nodes[child]._z * _nodes[child]._mass;
+			mass += _nodes[child]._mass;
+		}
+
+		_nodes[index]._first = begin;
+		_nodes[index]._count = end - begin;
+		finishNode(_nodes[index], level, x, y, z, mass);
+		_nodes[index]._next = (unsigned int)_nodes.size();
+		return index;
+	}
+
+	void buildTree()
+	{
+		computeBounds();
+		sortBodies();
+
+		_tasks.clear();
+		collectTasks(0, _count, 0);
+		if (_taskNodes.size() < _tasks.size())
+			_taskNodes.resize(_tasks.size());
+
+		_jobSystem.parallelFor(0, (int)_tasks.size(), 1, [&](int begin, int end)
+		{
+			for (int t = begin; t < end; t++)
+			{
+				_taskNodes[t].clear();
+				buildSubtree(_tasks[t]._begin, _tasks[t]._end, _tasks[t]._level, _taskNodes[t]);
+			}
+		});
+
+		_nodes.clear();
+		unsigned int task = 0;
+		assemble(0, _count, 0, task);
+
+		//Topmost nodes with at most GROUP_SIZE bodies (or leaves that are bigger because they reached MAX_LEVEL)
+		_groups.clear();
+		unsigned int n = 0;
+		while (n < (unsigned int)_nodes.size())
+		{
+			if (_nodes[n]._count <= GROUP_SIZE || _nodes[n]._next == n + 1)
+			{
+				_groups.push_back(n);
+				n = _nodes[n]._next;
+			}
+			else
+				n++;
+		}
+	}
+
+	//Walks the tree once for all bodies of a group: nodes that are far enough away from the group's box become one entry,
+	//leaves that are too close contribute their bodies
+	void collectInteractions(const Node& group, InteractionList& list) const
+	{
+		glm::vec3 min(FLT_MAX), max(-FLT_MAX);
+		for (unsigned int i = group._first; i < group._first + group._count; i++)
+		{
+			min = glm::min(min, glm::vec3(_px[i], _py[i], _pz[i]));
+			max = glm::max(max, glm::vec3(_px[i], _py[i], _pz[i]));
+		}
+
+		list.clear();
+		unsigned int n = 0, nodeCount = (unsigned int)_nodes.size();
+		while (n < nodeCount)
+		{
+			const Node& node = _nodes[n];
+			glm::vec3 center(node._x, node._y, node._z);
+			glm::vec3 delta = glm::max(glm::max(min - center, center - max), glm::vec3(0.0f));
+
+			if (glm::dot(delta, delta) > node._openDistance2)
+			{
+				list.add(node._x, node._y, node._z, node._mass);
+				n = node._next;
+			}
+			else if (node._next == n + 1)
+			{
+				for (unsigned int i = node._first; i < node._first + node._count; i++)
+					list.add(_px[i], _py[i], _pz[i], _mass[i]);
+				n = node._next;
+			}
+			else
+				n++;
+		}
+
+		list.pad();
+	}
+
+	//Acceleration at (x, y, z) from count entries (multiple of 8), without G
+	glm::vec3 sumScalar(const float* px, const float* py, const float* pz, const float* mass, unsigned int count, float x, float y, float z) const
+	{
+		float softening2 = _settings._softening * _settings._softening;
+		float ax = 0.0f, ay = 0.0f, az = 0.0f;
+
+		for (unsigned int j = 0; j < count; j++)
+		{
+			float dx = px[j] - x, dy = py[j] - y, dz = pz[j] - z;
+			float r2 = dx * dx + dy * dy + dz * dz + softening2;
+			float inverse = 1.0f / std::sqrt(r2);
+			float s = mass[j] * inverse * inverse * inverse;
+			ax += s * dx;
+			ay += s * dy;
+			az += s * dz;
+		}
+
+		return glm::vec3(ax, ay, az);
+	}
+
+	TARGET_AVX2 glm::vec3 sumSimd(const float* px, const float* py, const float* pz, const float* mass, unsigned int count, float x, float y, float z) const
+	{
+		const __m256 softening2 = _mm256_set1_ps(_settings._softening * _settings._softening);
+		const __m256 xi = _mm256_set1_ps(x), yi = _mm256_set1_ps(y), zi = _mm256_set1_ps(z);
+		__m256 ax = _mm256_setzero_ps(), ay = _mm256_setzero_ps(), az = _mm256_setzero_ps();
+
+		for (unsigned int j = 0; j < count; j += 8)
+		{
+			__m256 dx = _mm256_sub_ps(_mm256_loadu_ps(px + j), xi);
+			__m256 dy = _mm256_sub_ps(_mm256_loadu_ps(py + j), yi);
+			__m256 dz = _mm256_sub_ps(_mm256_loadu_ps(pz + j), zi);
+			__m256 r2 = _mm256_fmadd_ps(dx, dx, _mm256_fmadd_ps(dy, dy, _mm256_fmadd_ps(dz, dz, softening2)));
+
+			//1 / r from the approximate reciprocal square root with one Newton step (r2 > 0 thanks to the softening)
+			__m256 inverse = Simd8::inverseSqrt(r2);
+			__m256 s = _mm256_mul_ps(_mm256_loadu_ps(mass + j), _mm256_mul_ps(inverse, _mm256_mul_ps(inverse, inverse)));
+
+			ax = _mm256_fmadd_ps(s, dx, ax);
+			ay = _mm256_fmadd_ps(s, dy, ay);
+			az = _mm256_fmadd_ps(s, dz, az);
+		}
+
+		return glm::vec3(Simd8::horizontalSum(ax), Simd8::horizontalSum(ay), Simd8::horizontalSum(az));
+	}
+
+	glm::vec3 sum(const float* px, const float* py, const float* pz, const float* mass, unsigned int count, float x, float y, float z) const
+	{
+		return _simd ? sumSimd(px, py, pz, mass, count, x, y, z) : sumScalar(px, py, pz, mass, count, x, y, z);
+	}
+
+	void computeForces()
+	{
+		for (InteractionList& list : _lists)
+			list._interactions = 0;
+
+		_jobSystem.parallelFor(0, (int)_groups.size(), 4, [&](int begin, int end)
+		{
+			InteractionList& list = _lists[JobSystem::getThreadIndex()];
+			for (int g = begin; g < end; g++)
+			{
+				const Node& group = _nodes[_groups[g]];
+				collectInteractions(group, list);
+				unsigned int count = (unsigned int)list._x.size();
+				list._interactions += (unsigned long long)count * group._count;
+
+				for (unsigned int i = group._first; i < group._first + group._count; i++)
+				{
+					glm::vec3 acceleration = sum(&list._x[0], &list._y[0], &list._z[0], &list._mass[0], count, _px[i], _py[i], _pz[i]);
+					_ax[i] = acceleration.x;
+					_ay[i] = acceleration.y;
+					_az[i] = acceleration.z;
+				}
+			}
+		});
+
+		unsigned long long interactions = 0;
+		for (const InteractionList& list : _lists)
+			interactions += list._interactions;
+		_interactionsPerBody = _count > 0 ? (float)interactions / _count : 0.0f;
+	}
+
+public:
+	//The steps run on jobSystem (e.g. the one of the PhysicsEngine), it has to outlive the simulation
+	NBodySimulation(JobSystem& jobSystem, const NBodySettings& settings = NBodySettings())
+		: _settings(settings), _jobSystem(jobSystem), _simd(settings._simd && CpuFeatures::hasAvx2()), _count(std::max(settings._bodies, 1u)),
+		  _fixedStep(settings._timeStep, settings._maxSubsteps)
+	{
+		//Padding is massless -> the direct sum can run over whole multiples of 8
+		for (std::vector<float>* array : { &_px, &_py, &_pz, &_vx, &_vy, &_vz, &_mass, &_ax, &_ay, &_az, &_scratch })
+			array->assign(_count + PADDING, 0.0f);
+		_ids.resize(_count);
+		_idScratch.resize(_count);
+		_codes.resize(_count);
+		_sortedCodes.resize(_count);
+		_order.resize(_count);
+		_sortedOrder.resize(_count);
+		_histogram.resize(1 << RADIX_BITS);
+		_threadMin.resize(_jobSystem.getMaxThreadCount());
+		_threadMax.resize(_jobSystem.getMaxThreadCount());
+		_lists.resize(_jobSystem.getMaxThreadCount());
+
+		createDisk();
+	}
+
+	//Advances the simulation by frameTime in fixed substeps, returns the number of substeps
+	unsigned int update(float frameTime)
+	{
+		return _fixedStep.update(frameTime, [this]() { step(); });
+	}
+
+	//Tree and accelerations for the current positions, without moving the bodies
+	void computeAccelerations()
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		buildTree();
+		_times._tree = FixedStep::elapsed(start);
+
+		computeForces();
+		_times._forces = FixedStep::elapsed(start);
+	}
+
+	//Symplectic Euler
+	void step()
+	{
+		computeAccelerations();
+
+		auto start = std::chrono::high_resolution_clock::now();
+		float dt = _settings._timeStep;
+		_jobSystem.parallelFor(0, (int)_count, 4096, [&](int begin, int end)
+		{
+			for (int i = begin; i < end; i++)
+			{
+				_vx[i] += _ax[i] * dt;
+				_vy[i] += _ay[i] * dt;
+				_vz[i] += _az[i] * dt;
+				_px[i] += _vx[i] * dt;
+				_py[i] += _vy[i] * dt;
+				_pz[i] += _vz[i] * dt;
+			}
+		});
+		_times._integrate = FixedStep::elapsed(start);
+	}
+
+	//Exact accelerations of some bodies by direct summation over all bodies (indices into the current order)
+	//Returns the time it took in ms
+	float computeDirect(const unsigned int* indices, unsigned int count, glm::vec3* accelerations)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		unsigned int padded = (_count + 7) / 8 * 8;
+
+		_jobSystem.parallelFor(0, (int)count, 16, [&](int begin, int end)
+		{
+			for (int k = begin; k < end; k++)
+			{
+				unsigned int i = indices[k];
+				accelerations[k] = sum(&_px[0], &_py[0], &_pz[0], &_mass[0], padded, _px[i], _py[i], _pz[i]);
+			}
+		});
+
+		return FixedStep::elapsed(start);
+	}
+
+	//Acceleration of the last computeAccelerations/step
+	glm::vec3 getAcceleration(unsigned int i) const
+	{
+		return glm::vec3(_ax[i], _ay[i], _az[i]);
+	}
+
+	//Instance i gets the transform of body number i, the heavy center gets drawn bigger
+	void writeInstances(InstanceTransform* transforms, float scale)
+	{
+		float diskMass = _count > 1 ? _settings._diskMass / (_count - 1) : 1.0f;
+		_jobSystem.parallelFor(0, (int)_count, 4096, [&](int begin, int end)
+		{
+			for (int i = begin; i < end; i++)
+			{
+				InstanceTransform& transform = transforms[_ids[i]];
+				transform._position = glm::vec3(_px[i], _py[i], _pz[i]);
+				transform._scale = scale * std::min(std::max(std::cbrt(_mass[i] / diskMass), 1.0f), 8.0f);
+				transform.setRotation(0.0f, 0.0f, 0.0f, 1.0f);
+			}
+		});
+	}
+
+	//Colors by the distance to the center: warm in the middle, blue outside
+	void writeColors(glm::vec3* colors) const
+	{
+		for (unsigned int i = 0; i < _count; i++)
+		{
+			float radius = glm::length(glm::vec2(_px[i] - _settings._center.x, _pz[i] - _settings._center.z));
+			float t = std::min(std::max((radius - _settings._innerRadius) / (_settings._outerRadius - _settings._innerRadius), 0.0f), 1.0f);
+			colors[_ids[i]] = glm::mix(glm::vec3(1.0f, 0.85f, 0.5f), glm::vec3(0.3f, 0.5f, 1.0f), t);
+		}
+	}
+
+	unsigned int getBodyCount() const
+	{
+		return _count;
+	}
+
+	unsigned int getNodeCount() const
+	{
+		return (unsigned int)_nodes.size();
+	}
+
+	float getInteractionsPerBody() const
+	{
+		return _interactionsPerBody;
+	}
+
+	float getTheta() const
+	{
+		return _settings._theta;
+	}
+
+	const StepTimes& getLastStepTimes() const
+	{
+		return _times;
+	}
+
+	bool usesSimd() const
+	{
+		return _simd;
+	}
+
+	unsigned int getThreadCount() const
+	{
+		return _jobSystem.getThreadCount();
+	}
+
+	//Kinetic energy + potential energy of all pairs (direct sum, O(n^2) -> only for checks on small systems)
+	double computeTotalEnergy() const
+	{
+		double kinetic = 0.0, potential = 0.0;
+		double softening2 = (double)_settings._softening * _settings._softening;
+
+		for (unsigned int i = 0; i < _count; i++)
+		{
+			kinetic += 0.5 * _mass[i] * ((double)_vx[i] * _vx[i] + (double)_vy[i] * _vy[i] + (double)_vz[i] * _vz[i]);
+			for (unsigned int j = i + 1; j < _count; j++)
+			{
+				double dx = _px[i] - _px[j], dy = _py[i] - _py[j], dz = _pz[i] - _pz[j];
+				potential -= (double)_mass[i] * _mass[j] / std::sqrt(dx * dx + dy * dy + dz * dz + softening2);
+			}
+		}
+
+		return kinetic + potential;
+	}
+};
\ No newline at end of file
@@ -5,9 +5,29 @@
 #include "MeshCreator.hpp"
 #include "PhysicsEngine.hpp"
 #include "ObjectSpawner.hpp"
+#include "StressEmitter.hpp"
+#include "FluidRenderer.hpp"
+#include "NBodySimulation.hpp"
 #include "Cubemap.hpp"
+#include <fstream>
+#include <string>
 
 unsigned int VERTICES_TO_RENDER = 0;
+unsigned int PHYSICS_THREADS = 1; //1 = single threaded Bullet world (reproducible), more threads are opt-in via --physics-threads
+float PHYSICS_STEP_TIME = 0.0f;
+bool STRESS_MODE = false; //Continuous emitter that ramps the sphere count up to STRESS_TARGET_SPHERES
+uint32_t SIMULATION_SEED = 1337; //Seed for everything that gets spawned -> runs are comparable
+bool FIXED_TIMESTEP = false; //Step the physics with 1/60 s instead of the frame time (needed for reproducible runs)
+std::string SNAPSHOT_FILE = "simulation.snapshot";
+bool LOAD_SNAPSHOT = false; //Load SNAPSHOT_FILE after the scene got created
+bool PHYSICS_LOD = false; //Simulate far and off-screen bodies at a lower rate or freeze them (toggled with L)
+bool FLUID_MODE = false; //SPH fluid in a basin on the plane instead of the initial spheres
+unsigned int FLUID_PARTICLES = 100000;
+bool NBODY_MODE = false; //Barnes-Hut gravity disk above the plane instead of the initial spheres
+unsigned int NBODY_BODIES = 20000;
+float NBODY_THETA = 0.5f;
+SphereRenderMode SPHERE_RENDER_MODE = SPHERE_MESH; //Cycled with I
+const float NBODY_SCALE = 0.2f; //Radius of a disk body (the sphere mesh has radius 1)
 
 class ObjectManager
 {
@@ -15,7 +35,13 @@ private:
 	std::vector<Object*> _objects;
 	PhysicsEngine* _physicsEngine = nullptr;
 	ObjectSpawner* _objectSpawner = nullptr;
+	StressEmitter* _stressEmitter = nullptr;
+	SphFluid* _fluid = nullptr;
+	FluidRenderer* _fluidRenderer = nullptr;
+	NBodySimulation* _nbody = nullptr;
 	Cubemap* _cubemap = nullptr;
+	unsigned int _staticVertices = 0;
+	QueryHit _crosshairHit = { -1, 1.0f, glm::vec3(0.0f), glm::vec3(0.0f) }; //What the camera looks at
 	
 public:
 	ObjectManager()
@@ -32,15 +58,24 @@ public:
 		for (Object* obj : _objects)
 			delete obj;
 
-		delete _physicsEngine;
+		delete _stressEmitter;
 		delete _objectSpawner;
+		delete _fluidRenderer;
+		delete _fluid;
+		delete _nbody;
+		delete _physicsEngine; //Last, the fluid and the N-body simulation run on its job system
 		delete _cubemap;
 	}
 
 	void init()
 	{
 		//Create physics engine
-		_physicsEngine = new PhysicsEngine();
+		_physicsEngine = new PhysicsEngine(PHYSICS_THREADS);
+		PHYSICS_THREADS = _physicsEngine->getThreadCount(); //Can fall back to a single thread
+		_physicsEngine->setSeed(SIMULATION_SEED + 1);
+		unsigned int initialSpheres = (FLUID_MODE || NBODY_MODE) ? 0 : INITIAL_SPHERES;
+		_physicsEngine->reserve((STRESS_MODE ? STRESS_TARGET_SPHERES : initialSpheres) + 1); //Spheres + plane
+		_physicsEngine->setLodEnabled(PHYSICS_LOD);
 
 		//Allocate resources
 		ResourceManager::LoadShader("../res/shader/simulation/object_instanced_vs.glsl", "../res/shader/simulation/object_instanced_fs.glsl", "Object_shader");
@@ -48,8 +83,43 @@ public:
 		ResourceManager::LoadData("../res/obj/geometry/sphere.obj", "Sphere_data");
 
 		//Create object spawner and initialize it with allocated resources
-		_objectSpawner = new ObjectSpawner(_physicsEngine);
-		_objectSpawner->init(ResourceManager::GetTexture("Sphere_texture"), ResourceManager::GetShader("Object_shader"), ResourceManager::GetData("Sphere_data"));
+		_objectSpawner = new ObjectSpawner(_physicsEngine, SIMULATION_SEED);
+		_objectSpawner->init(ResourceManager::GetTexture("Sphere_texture"), ResourceManager::GetShader("Object_shader"), ResourceManager::GetData("Sphere_data"), initialSpheres);
+
+		//Ray cast sphere impostors as an alternative to the mesh
+		ResourceManager::LoadShader("../res/shader/simulation/sphere_impostor_vs.glsl", "../res/shader/simulation/sphere_impostor_fs.glsl", "Impostor_shader");
+		_objectSpawner->initImpostors(ResourceManager::GetShader("Impostor_shader"));
+		_objectSpawner->setRenderMode(SPHERE_RENDER_MODE);
+
+		//Fluid particles use the same instanced shader with a low poly sphere (the loaded one has far too many vertices for 100k instances)
+		if (FLUID_MODE)
+		{
+			FluidSettings fluidSettings;
+			fluidSettings._particles = FLUID_PARTICLES;
+			_fluid = new SphFluid(_physicsEngine->getJobSystem(), fluidSettings);
+
+			ResourceManager::addData(MeshCreator::createSphere(4, 6), "Particle_data");
+			_fluidRenderer = new FluidRenderer(_fluid);
+			_fluidRenderer->init(ResourceManager::GetTexture("Sphere_texture"), ResourceManager::GetShader("Object_shader"), ResourceManager::GetData("Particle_data"));
+			spdlog::info("Fluid: {} particles, {} threads, {} kernels", _fluid->getParticleCount(), _fluid->getThreadCount(), _fluid->usesSimd() ? "AVX2" : "scalar");
+		}
+
+		//N-body bodies are instances of the spawner without a physics body
+		if (NBODY_MODE)
+		{
+			NBodySettings nbodySettings;
+			nbodySettings._bodies = NBODY_BODIES;
+			nbodySettings._theta = NBODY_THETA;
+			nbodySettings._seed = SIMULATION_SEED;
+			_nbody = new NBodySimulation(_physicsEngine->getJobSystem(), nbodySettings);
+
+			std::vector<glm::vec3> colors(_nbody->getBodyCount());
+			_nbody->writeColors(&colors[0]);
+			_objectSpawner->addExternalInstances(&colors[0], _nbody->getBodyCount());
+			_nbody->writeInstances(_objectSpawner->getExternalTransforms(), NBODY_SCALE);
+			_objectSpawner->markExternalTransformsDirty();
+			spdlog::info("N-body: {} bodies, theta {}, {} threads, {} kernel", _nbody->getBodyCount(), NBODY_THETA, _nbody->getThreadCount(), _nbody->usesSimd() ? "AVX2" : "scalar");
+		}
 				
 		//Plane resources
 		unsigned int plane_x = 200;
@@ -70,6 +140,10 @@ public:
 			//Add to physics simulation									 
 			unsigned int bodyIndex = _physicsEngine->addBox(halfsize, glm::vec3(halfsize.x, 0.1f, halfsize.z), 0.0, 1.0f, 1.0f);
 
+			//Report spheres that land on the plane (a resting sphere only presses with about m * g * dt = 10 per step)
+			_physicsEngine->setContactInterest(bodyIndex, CONTACT_NEW | CONTACT_ENDED);
+			_physicsEngine->setMinContactImpulse(20.0f);
+
 			//Add to renderer
 			_objects.emplace_back(
 				new Object
@@ -103,17 +177,173 @@ public:
 			_cubemap = new Cubemap(faces, ResourceManager::GetShader("Cubemap_shader"), &camera, WIDTH, HEIGHT, 1000.0f);
 		}
 
-		//Calculate vertices to render
+		if (LOAD_SNAPSHOT)
+			loadSnapshot(SNAPSHOT_FILE);
+
+		if (STRESS_MODE)
+			_stressEmitter = new StressEmitter(_objectSpawner, _physicsEngine);
+
+		//Calculate vertices to render (the spheres get added every frame because their amount can change)
 		for (Object* obj : _objects)
-			VERTICES_TO_RENDER += obj->getVertices();
+			_staticVertices += obj->getVertices();
 
-		VERTICES_TO_RENDER += _objectSpawner->_verticsToRender;
-		VERTICES_TO_RENDER += 36; //Cubemap
+		_staticVertices += 36; //Cubemap
+		if (_fluidRenderer)
+			_staticVertices += _fluidRenderer->getVerticesToRender();
+		VERTICES_TO_RENDER = _staticVertices + _objectSpawner->getVerticesToRender();
 	}
 	
 	void updateObjects()
 	{
-		_physicsEngine->simulate(deltaTime);
+		if (_stressEmitter)
+			_stressEmitter->update(deltaTime * 1000.0f);
+
+		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)WIDTH / (float)HEIGHT, 0.1f, 1000.0f);
+		_physicsEngine->updateLod(camera.Position, projection * camera.GetViewMatrix());
+		_physicsEngine->simulate(FIXED_TIMESTEP ? 1.0f / 60.0f : deltaTime);
+		PHYSICS_STEP_TIME = _physicsEngine->getLastStepTime();
+
+		if (_fluid)
+			_fluid->update(FIXED_TIMESTEP ? 1.0f / 60.0f : deltaTime);
+
+		if (_nbody && _nbody->update(FIXED_TIMESTEP ? 1.0f / 60.0f : deltaTime) > 0)
+		{
+			_nbody->writeInstances(_objectSpawner->getExternalTransforms(), NBODY_SCALE);
+			_objectSpawner->markExternalTransformsDirty();
+		}
+
+		//Pick whatever is in the middle of the screen
+		RayQuery crosshairRay = { camera.Position, camera.Position + camera.Front * 1000.0f };
+		_physicsEngine->raycast(&crosshairRay, &_crosshairHit, 1);
+		VERTICES_TO_RENDER = _staticVertices + _objectSpawner->getVerticesToRender();
+	}
+
+	//Physics world and spawned instances -> loading it gives every run the same (warmed-up) starting point
+	void saveSnapshot(const std::string& filepath)
+	{
+		std::ofstream file(filepath, std::ios::binary);
+		if (!file)
+		{
+			spdlog::error("Couldn't write snapshot {}", filepath);
+			return;
+		}
+
+		file.write(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+		_physicsEngine->saveSnapshot(file);
+		_objectSpawner->saveSnapshot(file);
+		spdlog::info("Saved snapshot {} ({} bodies)", filepath, _physicsEngine->getBodyCount());
+	}
+
+	void loadSnapshot(const std::string& filepath)
+	{
+		//The spawner's slots are taken by the N-body instances, the snapshot's slots would overwrite them
+		if (_nbody)
+		{
+			spdlog::error("Snapshots can't be loaded in the N-body mode");
+			return;
+		}
+
+		std::ifstream file(filepath, std::ios::binary);
+		char magic[sizeof(SNAPSHOT_MAGIC)] = {};
+		file.read(magic, sizeof(magic));
+
+		if (!file || !std::equal(magic, magic + sizeof(magic), SNAPSHOT_MAGIC))
+		{
+			spdlog::error("Couldn't read snapshot {}", filepath);
+			return;
+		}
+
+		//The whole file gets read and checked first -> a broken snapshot leaves the running scene as it is
+		PhysicsSnapshot physicsSnapshot;
+		SpawnerSnapshot spawnerSnapshot;
+		if (!_physicsEngine->readSnapshot(file, physicsSnapshot) || !_objectSpawner->readSnapshot(file, spawnerSnapshot, (unsigned int)physicsSnapshot._bodies.size()))
+		{
+			spdlog::error("Snapshot {} is corrupted", filepath);
+			return;
+		}
+
+		//The physics engine writes the transforms into the instance slots of its bodies -> both parts have to agree on them
+		const unsigned int instanceCount = (unsigned int)spawnerSnapshot._colors.size();
+		for (unsigned int i = 0; i < physicsSnapshot._bodies.size(); i++)
+		{
+			int slot = physicsSnapshot._bodies[i]._instanceSlot;
+			int spawnerSlot = i < spawnerSnapshot._instanceSlots.size() ? spawnerSnapshot._instanceSlots[i] : -1;
+			if (slot >= (int)instanceCount || slot != spawnerSlot)
+			{
+				spdlog::error("Snapshot {} is corrupted (body {} uses instance slot {}, the spawner has {} of {} instances)", filepath, i, slot, spawnerSlot, instanceCount);
+				return;
+			}
+		}
+
+		_physicsEngine->applySnapshot(physicsSnapshot);
+		_objectSpawner->applySnapshot(spawnerSnapshot);
+
+		spdlog::info("Loaded snapshot {} ({} bodies)", filepath, _physicsEngine->getBodyCount());
+	}
+
+	unsigned int getInstanceUploadBytes() const
+	{
+		return _objectSpawner->getUploadedBytes();
+	}
+
+	unsigned int getInstanceUploadCalls() const
+	{
+		return _objectSpawner->getUploadCalls();
+	}
+
+	const StressEmitter* getStressEmitter() const
+	{
+		return _stressEmitter;
+	}
+
+	const QueryHit& getCrosshairHit() const
+	{
+		return _crosshairHit;
+	}
+
+	const ContactEvents& getContactEvents() const
+	{
+		return _physicsEngine->getContactEvents();
+	}
+
+	void cycleSphereRenderMode()
+	{
+		SPHERE_RENDER_MODE = (SphereRenderMode)((SPHERE_RENDER_MODE + 1) % SPHERE_RENDER_MODE_COUNT);
+		_objectSpawner->setRenderMode(SPHERE_RENDER_MODE);
+	}
+
+	//Spheres drawn as meshes in the last frame, the others were impostors
+	unsigned int getMeshSphereCount() const
+	{
+		return _objectSpawner->getMeshInstanceCount();
+	}
+
+	unsigned int getSphereCount() const
+	{
+		return _objectSpawner->getInstanceCount();
+	}
+
+	void togglePhysicsLod()
+	{
+		PHYSICS_LOD = !PHYSICS_LOD;
+		_physicsEngine->setLodEnabled(PHYSICS_LOD);
+	}
+
+	const PhysicsEngine* getPhysicsEngine() const
+	{
+		return _physicsEngine;
+	}
+
+	//nullptr if the fluid mode is off
+	const SphFluid* getFluid() const
+	{
+		return _fluid;
+	}
+
+	//nullptr if the N-body mode is off
+	const NBodySimulation* getNBody() const
+	{
+		return _nbody;
 	}
 
 	void renderObjects()
@@ -123,6 +353,9 @@ public:
 
 		_objectSpawner->render();
 
+		if (_fluidRenderer)
+			_fluidRenderer->render();
+
 		//Render cubemap last
 		_cubemap->render();
 	}
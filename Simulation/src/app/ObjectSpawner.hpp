@@ -2,12 +2,42 @@
 
 #include "Random.hpp"
 #include "PhysicsEngine.hpp"
+#include "DirtyRanges.hpp"
+#include "InstanceTransform.hpp"
+#include "FrameArena.hpp"
+#include <climits>
 
-const unsigned int INSTANCES = 300;
+const unsigned int INITIAL_SPHERES = 300;
+const unsigned int INITIAL_INSTANCE_CAPACITY = 1024;
+
+//How the spheres get drawn
+enum SphereRenderMode
+{
+	SPHERE_MESH, //Instanced sphere mesh
+	SPHERE_IMPOSTOR, //Camera facing quad per sphere, the fragment shader ray casts the sphere (4 vertices instead of the whole mesh)
+	SPHERE_AUTO, //Meshes up to SPHERE_MESH_DISTANCE, impostors behind it (impostor edges come from discard and don't get multisampled)
+	SPHERE_RENDER_MODE_COUNT
+};
+
+const char* const SPHERE_RENDER_MODE_NAMES[] = { "mesh", "impostor", "auto" };
+const float SPHERE_MESH_DISTANCE = 40.0f;
+
+//Spawner part of a snapshot as read from the file (ObjectSpawner::readSnapshot)
+struct SpawnerSnapshot
+{
+	std::vector<glm::vec3> _colors;
+	std::vector<unsigned int> _physicBodyIndices;
+	std::vector<int> _instanceSlots;
+	random::Generator _random;
+};
 
 class ObjectSpawner
 {
 private:
+	//Dirty instances that are at most this many slots apart get uploaded together, too many ranges become one upload
+	static const unsigned int UPLOAD_MAX_GAP = 8;
+	static const unsigned int UPLOAD_MAX_RANGES = 32;
+
 	//Actual object instance -> only once
 	struct ObjectInstance
 	{
@@ -17,6 +47,15 @@ private:
 		VertexBuffer* _vbo1 = nullptr, * _vbo2 = nullptr, * _vbo3 = nullptr, * _vbo4 = nullptr;
 		VertexArray* _vao = nullptr;
 		IndexBuffer* _ib = nullptr;
+
+		//Impostors: quad corners with the same instance buffers, and the mesh with a small buffer of the near instances (SPHERE_AUTO)
+		//The mesh flags (one byte per instance) tell the impostor shader which instances are in the near buffers
+		Shader* _impostorShader = nullptr;
+		VertexBuffer* _quadVbo = nullptr, * _nearVbo3 = nullptr, * _nearVbo4 = nullptr, * _meshFlagVbo = nullptr;
+		VertexArray* _impostorVao = nullptr, * _nearVao = nullptr;
+		IndexBuffer* _quadIb = nullptr;
+		unsigned int _nearCapacity = 0;
+
 		glm::mat4 _view, _projection;
 		unsigned int _vertices;
 		
@@ -36,38 +75,164 @@ private:
 			delete _vao;
 
 			delete _ib;			
+
+			delete _quadVbo;
+			delete _nearVbo3;
+			delete _nearVbo4;
+			delete _meshFlagVbo;
+			delete _impostorVao;
+			delete _nearVao;
+			delete _quadIb;
 		}
 	};
 
 	//Single object instance which will get rendered via instancing
 	ObjectInstance* _objectInstance = nullptr;
 	
-	//Create color buffer
+	//CPU copies of the instance buffers -> dirty ranges get uploaded from here
 	std::vector<glm::vec3> _colorBuffer;
+	std::vector<InstanceTransform> _transformBuffer;
+	DirtyRanges _dirtyColors, _dirtyTransforms;
+	unsigned int _uploadedBytes = 0, _uploadCalls = 0; //Last frame
 
-	//Create model buffer
-	std::vector<glm::mat4> _modelBuffer;
+	//Instances are packed densely in [0, _instanceCount) -> despawning moves the last instance into the freed slot
+	//The first _externalCount slots belong to instances without a physics body and never move
+	unsigned int _instanceCount = 0;
+	unsigned int _externalCount = 0;
+	unsigned int _instanceCapacity = 0;
 
 	//Physics stuff
 	PhysicsEngine* _physicsEngine = nullptr;
-	std::vector<unsigned int> _physicBodyIndices;
-	
-	void initData(Texture* texture, Shader* shader, Data* data)
-	{	
-		//Create instances (differ in color and model matrices)
-		for (int i = 0; i < INSTANCES; i++)
+	std::vector<unsigned int> _physicBodyIndices; //Body of every instance slot
+	std::vector<int> _instanceSlots; //Instance slot of every body (-1 = not spawned by this spawner)
+
+	//Impostor rendering (SPHERE_AUTO copies the near instances into their own buffers every frame and flags them for the impostor shader)
+	SphereRenderMode _renderMode = SPHERE_MESH;
+	std::vector<uint8_t> _meshFlags;
+	std::vector<glm::vec3> _nearColors;
+	std::vector<InstanceTransform> _nearTransforms;
+	unsigned int _nearCount = 0; //Last frame
+
+	//Seeded -> the same seed spawns the same spheres in every run
+	random::Generator _random;
+
+	//Instance buffers and mesh flags of the impostor vao
+	void defineImpostorAttributes()
+	{
+		ObjectInstance* instance = _objectInstance;
+		defineInstanceAttributes(instance->_impostorVao, instance->_vbo3, instance->_vbo4);
+		instance->_meshFlagVbo->bind();
+		instance->_impostorVao->DefineAttributes(5, 1, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(uint8_t), (void*)0);
+		instance->_impostorVao->AttributeDivisor(5, 1);
+	}
+
+	//Doubles the instance buffers until they fit the requested amount of instances (amortised -> only log(n) reallocations)
+	void growInstanceBuffers(unsigned int required)
+	{
+		unsigned int newCapacity = std::max(_instanceCapacity, INITIAL_INSTANCE_CAPACITY);
+		while (newCapacity < required)
+			newCapacity *= 2;
+
+		if (newCapacity == _instanceCapacity)
+			return;
+
+		_colorBuffer.resize(newCapacity);
+		_transformBuffer.resize(newCapacity);
+		_dirtyColors.resize(newCapacity);
+		_dirtyTransforms.resize(newCapacity);
+		_meshFlags.resize(newCapacity, 0);
+
+		//Old content gets copied on the GPU, so the transforms of resting bodies don't have to be synced again
+		_objectInstance->_vbo3->resize(newCapacity * sizeof(glm::vec3), _instanceCount * sizeof(glm::vec3));
+		_objectInstance->_vbo4->resize(newCapacity * sizeof(InstanceTransform), _instanceCount * sizeof(InstanceTransform));
+		_objectInstance->_vao->bind();
+		defineInstanceAttributes(_objectInstance->_vao, _objectInstance->_vbo3, _objectInstance->_vbo4);
+		if (_objectInstance->_impostorVao)
 		{
-			//Color
-			_colorBuffer.emplace_back(random::Float(), random::Float(), random::Float());
+			_objectInstance->_meshFlagVbo->resize(newCapacity * sizeof(uint8_t), 0);
+			_objectInstance->_impostorVao->bind();
+			defineImpostorAttributes();
+		}
+		_objectInstance->_vao->unbind();
+		_objectInstance->_vbo4->unbind();
 
-			//Model matrix
-			glm::vec3 pos = glm::vec3(random::Float() * 200.0f, random::Float() * 50.0f, random::Float() * 200.0f);
-			_modelBuffer.emplace_back(glm::translate(glm::mat4(1.0f), pos));
+		_instanceCapacity = newCapacity;
+	}
+
+	//Uploads the coalesced dirty ranges of one instance buffer with glBufferSubData
+	void uploadDirtyRanges(VertexBuffer* vbo, DirtyRanges& dirtyRanges, const void* data, unsigned int elementSize)
+	{
+		if (dirtyRanges.empty())
+			return;
 
-			//Add to physics simulation
-			_physicBodyIndices.emplace_back(_physicsEngine->addSphere(pos, 60.0, 0.8f, 1.0f));
-		}		
+		vbo->bind();
+		for (const DirtyRanges::Range& range : dirtyRanges.coalesce(UPLOAD_MAX_GAP, UPLOAD_MAX_RANGES))
+		{
+			unsigned int size = (range._end - range._begin) * elementSize;
+			vbo->updateData((const char*)data + range._begin * elementSize, size, range._begin * elementSize);
+			_uploadedBytes += size;
+			_uploadCalls++;
+		}
+		vbo->unbind();
+	}
+
+	//Copies the instances closer than SPHERE_MESH_DISTANCE into the near buffers (grown by doubling) and flags them for the impostor shader
+	//-> the split is made only here, every sphere is either a mesh or an impostor
+	void uploadNearInstances()
+	{
+		_nearColors.clear();
+		_nearTransforms.clear();
+
+		float maxDistance2 = SPHERE_MESH_DISTANCE * SPHERE_MESH_DISTANCE;
+		for (unsigned int i = 0; i < _instanceCount; i++)
+		{
+			glm::vec3 offset = _transformBuffer[i]._position - camera.Position;
+			_meshFlags[i] = glm::dot(offset, offset) < maxDistance2;
+			if (_meshFlags[i])
+			{
+				_nearColors.push_back(_colorBuffer[i]);
+				_nearTransforms.push_back(_transformBuffer[i]);
+			}
+		}
+
+		ObjectInstance* instance = _objectInstance;
+		instance->_meshFlagVbo->bind();
+		instance->_meshFlagVbo->updateData(&_meshFlags[0], _instanceCount * sizeof(uint8_t));
+		_uploadedBytes += _instanceCount * sizeof(uint8_t);
+		_uploadCalls++;
+
+		_nearCount = (unsigned int)_nearTransforms.size();
+		if (_nearCount == 0)
+		{
+			instance->_meshFlagVbo->unbind();
+			return;
+		}
 
+		if (_nearCount > instance->_nearCapacity)
+		{
+			unsigned int newCapacity = std::max(instance->_nearCapacity, 64u);
+			while (newCapacity < _nearCount)
+				newCapacity *= 2;
+
+			instance->_nearVbo3->resize(newCapacity * sizeof(glm::vec3), 0);
+			instance->_nearVbo4->resize(newCapacity * sizeof(InstanceTransform), 0);
+			instance->_nearVao->bind();
+			defineInstanceAttributes(instance->_nearVao, instance->_nearVbo3, instance->_nearVbo4);
+			instance->_nearVao->unbind();
+			instance->_nearCapacity = newCapacity;
+		}
+
+		instance->_nearVbo3->bind();
+		instance->_nearVbo3->updateData(&_nearColors[0], _nearCount * sizeof(glm::vec3));
+		instance->_nearVbo4->bind();
+		instance->_nearVbo4->updateData(&_nearTransforms[0], _nearCount * sizeof(InstanceTransform));
+		instance->_nearVbo4->unbind();
+		_uploadedBytes += _nearCount * (sizeof(glm::vec3) + sizeof(InstanceTransform));
+		_uploadCalls += 2;
+	}
+
+	void initData(Texture* texture, Shader* shader, Data* data, unsigned int initialSpheres)
+	{	
 		//Create object
 		_objectInstance = new ObjectInstance(texture, shader, data);
 
@@ -84,28 +249,22 @@ private:
 		_objectInstance->_vbo2 = new VertexBuffer(&_objectInstance->_data->_texCoords[0], _objectInstance->_data->_texCoords.size() * sizeof(glm::vec2));
 		_objectInstance->_vao->DefineAttributes(1, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
 
-		//vbo3 (colors)
-		_objectInstance->_vbo3 = new VertexBuffer(&_colorBuffer[0], _colorBuffer.size() * sizeof(glm::vec3));
-		_objectInstance->_vao->DefineAttributes(2, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
-		_objectInstance->_vao->AttributeDivisor(2, 1);
-
-		//vbo4 (model matrix - maximum size for vertex attributes is a vec4 - so we need to send 4 consecutive vec4's to simulate a mat4)
-		_objectInstance->_vbo4 = new VertexBuffer(&_modelBuffer[0], INSTANCES * sizeof(glm::mat4), true);
-		_objectInstance->_vao->DefineAttributes(3, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(glm::vec4), (void*)0);
-		_objectInstance->_vao->AttributeDivisor(3, 1);
-		_objectInstance->_vao->DefineAttributes(4, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(glm::vec4), (void*) (1 * sizeof(glm::vec4)));
-		_objectInstance->_vao->AttributeDivisor(4, 1);
-		_objectInstance->_vao->DefineAttributes(5, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(glm::vec4), (void*) (2 * sizeof(glm::vec4)));
-		_objectInstance->_vao->AttributeDivisor(5, 1);
-		_objectInstance->_vao->DefineAttributes(6, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(glm::vec4), (void*) (3 * sizeof(glm::vec4)));		
-		_objectInstance->_vao->AttributeDivisor(6, 1);		
+		//vbo3 (colors) and vbo4 (transforms) are instance buffers that grow with the amount of spawned objects
+		_instanceCapacity = INITIAL_INSTANCE_CAPACITY;
+		_colorBuffer.resize(_instanceCapacity);
+		_transformBuffer.resize(_instanceCapacity);
+		_dirtyColors.resize(_instanceCapacity);
+		_dirtyTransforms.resize(_instanceCapacity);
+		_meshFlags.resize(_instanceCapacity, 0);
+		_objectInstance->_vbo3 = new VertexBuffer(nullptr, _instanceCapacity * sizeof(glm::vec3), true);
+		_objectInstance->_vbo4 = new VertexBuffer(nullptr, _instanceCapacity * sizeof(InstanceTransform), true);
+		defineInstanceAttributes(_objectInstance->_vao, _objectInstance->_vbo3, _objectInstance->_vbo4);
 		
 		//Create ib
 		_objectInstance->_ib = new IndexBuffer(&_objectInstance->_data->_indices[0], _objectInstance->_data->_indices.size() * sizeof(glm::uvec3));
 
 		//Calculate vertices to render
 		_objectInstance->_vertices = _objectInstance->_data->_indices.size() * 3;
-		_verticsToRender = _objectInstance->_vertices * INSTANCES;
 		
 		//Unbind vao and vbo's
 		_objectInstance->_vbo1->unbind();
@@ -113,13 +272,38 @@ private:
 		_objectInstance->_vbo3->unbind();
 		_objectInstance->_vbo4->unbind();
 		_objectInstance->_vao->unbind();
+
+		//Create instances (differ in color and transform)
+		spawnRandom(initialSpheres, 0.0f, 50.0f);
 	}
 	
 public:
-	unsigned int _verticsToRender;
+	//Vertex layout of the instanced sphere shader, shared with the other instanced renderers (FluidRenderer)
+	//Mesh vertices (vbo1, vbo2, ib) of a vao -> the near instances of SPHERE_AUTO use the same mesh with their own instance buffers
+	static void defineMeshAttributes(VertexArray* vao, VertexBuffer* vertices, VertexBuffer* texCoords, IndexBuffer* indices)
+	{
+		vertices->bind();
+		vao->DefineAttributes(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+		texCoords->bind();
+		vao->DefineAttributes(1, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+		indices->bind();
+	}
 
-	ObjectSpawner(PhysicsEngine* physicsEngine)
-		: _physicsEngine(physicsEngine)
+	//Attributes have to be defined again every time the instance buffers got replaced (the vao has to be bound)
+	static void defineInstanceAttributes(VertexArray* vao, VertexBuffer* colors, VertexBuffer* transforms)
+	{
+		//vbo3 (colors)
+		colors->bind();
+		vao->DefineAttributes(2, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+		vao->AttributeDivisor(2, 1);
+
+		//vbo4 (compact transforms - position + scale and the rotation quaternion, the vertex shader expands them)
+		transforms->bind();
+		InstanceTransform::defineAttributes(vao, 3);
+	}
+
+	ObjectSpawner(PhysicsEngine* physicsEngine, uint32_t seed)
+		: _physicsEngine(physicsEngine), _random(seed)
 	{
 		
 	}
@@ -129,26 +313,308 @@ public:
 		delete _objectInstance;
 	}
 	
-	void init(Texture* texture, Shader* shader, Data* data)
+	void init(Texture* texture, Shader* shader, Data* data, unsigned int initialSpheres = INITIAL_SPHERES)
 	{
-		initData(texture, shader, data);
+		initData(texture, shader, data, initialSpheres);
+	}
+
+	//Quad and vaos for the impostor modes -> without this call the spheres are always drawn as meshes
+	void initImpostors(Shader* impostorShader)
+	{
+		ObjectInstance* instance = _objectInstance;
+		instance->_impostorShader = impostorShader;
+
+		//Quad corners, the vertex shader turns them towards the camera
+		const glm::vec2 corners[] = { glm::vec2(-1.0f, -1.0f), glm::vec2(1.0f, -1.0f), glm::vec2(1.0f, 1.0f), glm::vec2(-1.0f, 1.0f) };
+		const glm::uvec3 triangles[] = { glm::uvec3(0, 1, 2), glm::uvec3(0, 2, 3) };
+
+		instance->_impostorVao = new VertexArray();
+		instance->_impostorVao->bind();
+		instance->_quadVbo = new VertexBuffer(corners, sizeof(corners));
+		instance->_impostorVao->DefineAttributes(0, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+		instance->_meshFlagVbo = new VertexBuffer(nullptr, _instanceCapacity * sizeof(uint8_t), true);
+		defineImpostorAttributes();
+		instance->_quadIb = new IndexBuffer(triangles, sizeof(triangles));
+		instance->_impostorVao->unbind();
+
+		//Mesh with its own instance buffers for the near spheres of SPHERE_AUTO
+		instance->_nearCapacity = 64;
+		instance->_nearVao = new VertexArray();
+		instance->_nearVao->bind();
+		defineMeshAttributes(instance->_nearVao, instance->_vbo1, instance->_vbo2, instance->_ib);
+		instance->_nearVbo3 = new VertexBuffer(nullptr, instance->_nearCapacity * sizeof(glm::vec3), true);
+		instance->_nearVbo4 = new VertexBuffer(nullptr, instance->_nearCapacity * sizeof(InstanceTransform), true);
+		defineInstanceAttributes(instance->_nearVao, instance->_nearVbo3, instance->_nearVbo4);
+		instance->_nearVao->unbind();
+		instance->_nearVbo4->unbind();
+	}
+
+	//Modes other than SPHERE_MESH need initImpostors
+	void setRenderMode(SphereRenderMode mode)
+	{
+		if (mode != SPHERE_MESH && !_objectInstance->_impostorVao)
+		{
+			spdlog::warn("Sphere impostors aren't initialized, keeping the mesh");
+			return;
+		}
+
+		_renderMode = mode;
+	}
+
+	SphereRenderMode getRenderMode() const
+	{
+		return _renderMode;
+	}
+
+	//Spheres drawn as meshes in the last frame (all of them in SPHERE_MESH)
+	unsigned int getMeshInstanceCount() const
+	{
+		return _renderMode == SPHERE_MESH ? _instanceCount : _renderMode == SPHERE_AUTO ? _nearCount : 0;
+	}
+
+	//Adds a sphere to the physics simulation and to the instanced renderer, returns its body index (handle for despawn)
+	unsigned int spawn(const glm::vec3& position, const glm::vec3& color)
+	{
+		if (_instanceCount == _instanceCapacity)
+			growInstanceBuffers(_instanceCount + 1);
+
+		unsigned int slot = _instanceCount++;
+		_colorBuffer[slot] = color;
+		_dirtyColors.mark(slot);
+
+		//The transform gets written into the instance buffer by the physics engine
+		unsigned int bodyIndex = _physicsEngine->addSphere(position, 60.0, 0.8f, 1.0f);
+		_physicsEngine->setInstanceSlot(bodyIndex, slot);
+
+		if (bodyIndex >= _instanceSlots.size())
+			_instanceSlots.resize(bodyIndex + 1, -1);
+		_instanceSlots[bodyIndex] = slot;
+
+		if (slot >= _physicBodyIndices.size())
+			_physicBodyIndices.resize(slot + 1);
+		_physicBodyIndices[slot] = bodyIndex;
+
+		return bodyIndex;
+	}
+
+	//Spawns spheres with random colors somewhere above the plane (between minHeight and maxHeight)
+	void spawnRandom(unsigned int count, const float& minHeight, const float& maxHeight)
+	{
+		//Positions and colors get generated in batches
+		FrameVector<glm::vec3> positions(count), colors(count);
+		_random.fillVec3(positions.data(), count, glm::vec3(0.0f, minHeight, 0.0f), glm::vec3(200.0f, maxHeight, 200.0f));
+		_random.fillVec3(colors.data(), count, glm::vec3(0.0f), glm::vec3(1.0f));
+
+		for (unsigned int i = 0; i < count; i++)
+			spawn(positions[i], colors[i]);
+	}
+
+	//Removes a spawned sphere, its body slot gets reused by the next spawn
+	void despawn(unsigned int bodyIndex)
+	{
+		if (bodyIndex >= _instanceSlots.size() || _instanceSlots[bodyIndex] < 0)
+			return;
+
+		unsigned int slot = (unsigned int)_instanceSlots[bodyIndex];
+		unsigned int lastSlot = --_instanceCount;
+
+		//Move the last instance into the gap so the instances stay dense
+		if (slot != lastSlot)
+		{
+			unsigned int lastBody = _physicBodyIndices[lastSlot];
+			_physicBodyIndices[slot] = lastBody;
+			_instanceSlots[lastBody] = slot;
+			_colorBuffer[slot] = _colorBuffer[lastSlot];
+			_dirtyColors.mark(slot);
+			_physicsEngine->setInstanceSlot(lastBody, slot);
+		}
+
+		_instanceSlots[bodyIndex] = -1;
+		_physicsEngine->removeBody(bodyIndex);
+	}
+
+	unsigned int getInstanceCount() const
+	{
+		return _instanceCount;
+	}
+
+	//Instances whose transforms come from somewhere else than the physics engine (e.g. the N-body simulation), they take the first slots
+	//Only possible before the first sphere got spawned, returns false otherwise
+	bool addExternalInstances(const glm::vec3* colors, unsigned int count)
+	{
+		if (_instanceCount != _externalCount)
+		{
+			spdlog::error("External instances have to be added before any sphere gets spawned");
+			return false;
+		}
+
+		growInstanceBuffers(_instanceCount + count);
+		std::copy(colors, colors + count, &_colorBuffer[_instanceCount]);
+		_dirtyColors.markRange(_instanceCount, _instanceCount + count);
+
+		_physicBodyIndices.resize(std::max((size_t)(_instanceCount + count), _physicBodyIndices.size()), UINT_MAX);
+		_instanceCount += count;
+		_externalCount = _instanceCount;
+		return true;
+	}
+
+	//Transforms of the external instances -> call markExternalTransformsDirty after writing them
+	InstanceTransform* getExternalTransforms()
+	{
+		return &_transformBuffer[0];
+	}
+
+	void markExternalTransformsDirty()
+	{
+		_dirtyTransforms.markRange(0, _externalCount);
+	}
+
+	//Instance slots, colors and the random generator (the physics engine saves the bodies themselves)
+	void saveSnapshot(std::ostream& stream) const
+	{
+		uint32_t instanceCount = _instanceCount, bodyCount = (uint32_t)_instanceSlots.size();
+		stream.write((const char*)&instanceCount, sizeof(uint32_t));
+		stream.write((const char*)&bodyCount, sizeof(uint32_t));
+		if (instanceCount > 0)
+		{
+			stream.write((const char*)&_colorBuffer[0], instanceCount * sizeof(glm::vec3));
+			stream.write((const char*)&_physicBodyIndices[0], instanceCount * sizeof(unsigned int));
+		}
+		if (bodyCount > 0)
+			stream.write((const char*)&_instanceSlots[0], bodyCount * sizeof(int));
+
+		_random.save(stream);
+	}
+
+	//Reads and checks the spawner part of a snapshot without touching the instances, physicsBodies = bodies of the physics part of the same snapshot
+	bool readSnapshot(std::istream& stream, SpawnerSnapshot& snapshot, unsigned int physicsBodies) const
+	{
+		uint32_t instanceCount = 0, bodyCount = 0;
+		stream.read((char*)&instanceCount, sizeof(uint32_t));
+		stream.read((char*)&bodyCount, sizeof(uint32_t));
+		if (!stream || bodyCount > physicsBodies || instanceCount > bodyCount)
+			return false;
+
+		snapshot._colors.resize(instanceCount);
+		snapshot._physicBodyIndices.resize(instanceCount);
+		snapshot._instanceSlots.resize(bodyCount);
+		if (instanceCount > 0)
+		{
+			stream.read((char*)&snapshot._colors[0], instanceCount * sizeof(glm::vec3));
+			stream.read((char*)&snapshot._physicBodyIndices[0], instanceCount * sizeof(unsigned int));
+		}
+		if (bodyCount > 0)
+			stream.read((char*)&snapshot._instanceSlots[0], bodyCount * sizeof(int));
+
+		snapshot._random.load(stream);
+		if (!stream)
+			return false;
+
+		//Every instance has to lead to a body and every slot back to an instance
+		for (unsigned int bodyIndex : snapshot._physicBodyIndices)
+		{
+			if (bodyIndex >= physicsBodies)
+				return false;
+		}
+		for (int slot : snapshot._instanceSlots)
+		{
+			if (slot < -1 || slot >= (int)instanceCount)
+				return false;
+		}
+		return true;
+	}
+
+	//Has to be called after the physics engine applied its part of the snapshot
+	void applySnapshot(const SpawnerSnapshot& snapshot)
+	{
+		unsigned int instanceCount = (unsigned int)snapshot._colors.size();
+		growInstanceBuffers(instanceCount);
+		_physicBodyIndices.resize(std::max((size_t)instanceCount, _physicBodyIndices.size()));
+		std::copy(snapshot._colors.begin(), snapshot._colors.end(), _colorBuffer.begin());
+		std::copy(snapshot._physicBodyIndices.begin(), snapshot._physicBodyIndices.end(), _physicBodyIndices.begin());
+		_instanceSlots = snapshot._instanceSlots;
+		_random = snapshot._random;
+		_instanceCount = instanceCount;
+		_externalCount = 0; //Snapshots only hold spawned spheres
+
+		//All colors get uploaded again, the transforms come with the next transform sync (every restored body counts as moved)
+		for (unsigned int i = 0; i < _instanceCount; i++)
+			_dirtyColors.mark(i);
+	}
+
+	//Bytes and glBufferSubData calls of the last instance buffer upload
+	unsigned int getUploadedBytes() const
+	{
+		return _uploadedBytes;
+	}
+
+	unsigned int getUploadCalls() const
+	{
+		return _uploadCalls;
+	}
+
+	//Impostors count 4 vertices
+	unsigned int getVerticesToRender() const
+	{
+		unsigned int meshes = std::min(getMeshInstanceCount(), _instanceCount);
+		return _objectInstance->_vertices * meshes + 4 * (_instanceCount - meshes);
 	}
 
 	void render()
 	{
-		//Get the world transform for all instances
-		for (int i = 0; i < INSTANCES; i++) 
-			_modelBuffer.at(i) = _physicsEngine->getWorldTransform(_physicBodyIndices.at(i));
-			
-		//Update model matrix in the vertex shader
-		_objectInstance->_vbo4->bind();
-		_objectInstance->_vbo4->updateData(&_modelBuffer[0], _modelBuffer.size() * sizeof(glm::mat4));
-		_objectInstance->_vbo4->unbind();
+		_uploadedBytes = 0;
+		_uploadCalls = 0;
+
+		if (_instanceCount == 0)
+			return;
+
+		//Let the physics engine write the transforms of all moved bodies (sleeping or resting ones don't report) and mark their slots
+		if (_physicsEngine->hasMovedBodies())
+			_physicsEngine->syncTransforms(&_transformBuffer[0], &_dirtyTransforms);
+
+		//Only changed instances get uploaded -> nothing at all in a settled scene
+		uploadDirtyRanges(_objectInstance->_vbo3, _dirtyColors, &_colorBuffer[0], sizeof(glm::vec3));
+		uploadDirtyRanges(_objectInstance->_vbo4, _dirtyTransforms, &_transformBuffer[0], sizeof(InstanceTransform));
 
 		//Set matrices
 		_objectInstance->_projection = glm::perspective(glm::radians(camera.Zoom), (float)WIDTH / (float)HEIGHT, 0.1f, 1000.0f);
 		_objectInstance->_view = camera.GetViewMatrix();
 
+		//Set texture
+		_objectInstance->_texture->bind();
+
+		//SPHERE_AUTO: near instances go to the mesh buffers and get flagged
+		if (_renderMode == SPHERE_AUTO)
+			uploadNearInstances();
+
+		//Impostors for all spheres (SPHERE_AUTO: the vertex shader drops the flagged ones)
+		if (_renderMode != SPHERE_MESH)
+		{
+			Shader* impostorShader = _objectInstance->_impostorShader;
+			impostorShader->bind();
+			impostorShader->SetUniformMat4f("projection", _objectInstance->_projection);
+			impostorShader->SetUniformMat4f("view", _objectInstance->_view);
+			impostorShader->SetUniform1i("skipMeshes", _renderMode == SPHERE_AUTO);
+
+			_objectInstance->_impostorVao->bind();
+			GLCall(glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr, _instanceCount));
+		}
+
+		if (_renderMode == SPHERE_IMPOSTOR)
+			return;
+
+		//Meshes for all spheres or for the near ones only
+		unsigned int meshInstances = _instanceCount;
+		VertexArray* meshVao = _objectInstance->_vao;
+		if (_renderMode == SPHERE_AUTO)
+		{
+			meshInstances = _nearCount;
+			meshVao = _objectInstance->_nearVao;
+		}
+
+		if (meshInstances == 0)
+			return;
+
 		//Bind shader
 		_objectInstance->_shader->bind();
 
@@ -156,13 +622,10 @@ public:
 		_objectInstance->_shader->SetUniformMat4f("projection", _objectInstance->_projection);
 		_objectInstance->_shader->SetUniformMat4f("view", _objectInstance->_view);
 
-		//Set texture
-		_objectInstance->_texture->bind();
-
 		//Bind vao
-		_objectInstance->_vao->bind();
+		meshVao->bind();
 
 		//Render object instanced
-		GLCall(glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)_objectInstance->_vertices, GL_UNSIGNED_INT, nullptr, INSTANCES));
+		GLCall(glDrawElementsInstanced(GL_TRIANGLES, (GLsizei)_objectInstance->_vertices, GL_UNSIGNED_INT, nullptr, meshInstances));
 	}
 };
\ No newline at end of file
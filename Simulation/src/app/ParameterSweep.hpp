@@ -0,0 +1,213 @@
+#pragma once
+
+#include "PhysicsEngine.hpp"
+#include "JobSystem.hpp"
+#include <spdlog/spdlog.h>
+#include <spdlog/fmt/fmt.h>
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+//Parameter grid of a sweep -> every combination gets simulated once per seed
+struct SweepSettings
+{
+	std::vector<float> _restitutions = { 0.2f, 0.5f, 0.8f };
+	std::vector<float> _frictions = { 0.2f, 0.6f, 1.0f };
+	std::vector<float> _masses = { 1.0f, 60.0f };
+	std::vector<unsigned int> _sphereCounts = { 300, 1200 }; //Spawn density: spheres dropped into the 200x50x200 arena of the Simulation
+	unsigned int _seeds = 1;
+	uint32_t _seed = 1337; //Seed of the first run of every combination, the others count up from it
+	unsigned int _maxSteps = 1800; //A world that hasn't settled after this many steps counts as not settled
+	float _dt = 1.0f / 60.0f;
+	//Settled = at least this part of the spheres sleeps or is slower than _restingSpeed, for _settleSteps in a row
+	//(a fraction instead of all spheres: without rolling friction some spheres roll on forever, the ones that roll off the plane get respawned)
+	float _settledFraction = 0.9f;
+	float _restingSpeed = 0.1f; //m/s
+	unsigned int _settleSteps = 120;
+	unsigned int _threads = 0; //Worlds simulated at the same time, 0 = one per hardware thread
+	std::string _csvFile = "sweep.csv";
+};
+
+//Runs one independent single threaded PhysicsEngine world per combination of the grid, spread over a job system without any rendering
+//-> tuning restitution, friction, mass and density becomes a batch job that writes one CSV row per world
+class ParameterSweep
+{
+private:
+	struct Run
+	{
+		float _restitution, _friction, _mass;
+		unsigned int _spheres;
+		uint32_t _seed;
+
+		//Results
+		bool _settled = false;
+		float _settlingTime = 0.0f; //Seconds until the spheres came to rest (time of the last step if not settled)
+		unsigned int _steps = 0;
+		double _peakEnergy = 0.0, _finalEnergy = 0.0; //Joule
+		float _meanStepTime = 0.0f, _maxStepTime = 0.0f; //ms
+
+		Run(float restitution, float friction, float mass, unsigned int spheres, uint32_t seed)
+			: _restitution(restitution), _friction(friction), _mass(mass), _spheres(spheres), _seed(seed)
+		{
+
+		}
+	};
+
+	static bool parseValue(const std::string& item, float& value)
+	{
+		char* end = nullptr;
+		value = std::strtof(item.c_str(), &end);
+		return !item.empty() && *end == '\0';
+	}
+
+	//Whole numbers only, no sign
+	static bool parseValue(const std::string& item, unsigned int& value)
+	{
+		char* end = nullptr;
+		unsigned long parsed = std::strtoul(item.c_str(), &end, 10);
+		value = (unsigned int)std::min(parsed, (unsigned long)UINT_MAX);
+		return !item.empty() && item[0] >= '0' && item[0] <= '9' && *end == '\0';
+	}
+
+	static void simulate(const SweepSettings& settings, Run& run)
+	{
+		PhysicsEngine physicsEngine(1);
+		physicsEngine.setSeed(run._seed + 1);
+		physicsEngine.reserve(run._spheres + 1);
+
+		//Same arena and spawn volume as ObjectSpawner::spawnRandom
+		random::Generator generator(run._seed);
+		std::vector<glm::vec3> positions(run._spheres);
+		if (run._spheres > 0)
+			generator.fillVec3(&positions[0], run._spheres, glm::vec3(0.0f), glm::vec3(200.0f, 50.0f, 200.0f));
+		for (const glm::vec3& position : positions)
+			physicsEngine.addSphere(position, run._mass, run._restitution, run._friction);
+
+		physicsEngine.addBox(glm::vec3(100.0f, 0.0f, 100.0f), glm::vec3(100.0f, 0.1f, 100.0f), 0.0, 1.0f, 1.0f);
+
+		run._settled = false;
+		run._peakEnergy = 0.0;
+		run._maxStepTime = 0.0f;
+		double totalStepTime = 0.0;
+		unsigned int restingSince = 0, restingSteps = 0;
+		unsigned int step = 0;
+
+		while (step < settings._maxSteps)
+		{
+			physicsEngine.simulate(settings._dt);
+			step++;
+
+			totalStepTime += physicsEngine.getLastStepTime();
+			run._maxStepTime = std::max(run._maxStepTime, physicsEngine.getLastStepTime());
+
+			double energy = physicsEngine.computeKineticEnergy();
+			run._peakEnergy = std::max(run._peakEnergy, energy);
+			run._finalEnergy = energy;
+
+			//Settling time = start of the first streak of _settleSteps resting steps
+			unsigned int bodies = 0;
+			unsigned int resting = physicsEngine.countRestingBodies(settings._restingSpeed, &bodies);
+			if (resting >= settings._settledFraction * bodies)
+			{
+				if (restingSteps++ == 0)
+					restingSince = step;
+
+				if (restingSteps >= settings._settleSteps)
+				{
+					run._settled = true;
+					break;
+				}
+			}
+			else
+				restingSteps = 0;
+		}
+
+		run._steps = step;
+		run._settlingTime = (run._settled ? restingSince : step) * settings._dt;
+		run._meanStepTime = step > 0 ? (float)(totalStepTime / step) : 0.0f;
+	}
+
+public:
+	//Comma separated numbers ("0.2,0.5,0.8" or "300,1200" for whole numbers), returns false if one of them isn't a number of the type
+	template<typename T>
+	static bool parseList(const std::string& text, std::vector<T>& values)
+	{
+		std::vector<T> parsed;
+		std::stringstream stream(text);
+		std::string item;
+
+		while (std::getline(stream, item, ','))
+		{
+			T value;
+			if (!parseValue(item, value))
+				return false;
+			parsed.push_back(value);
+		}
+
+		if (parsed.empty())
+			return false;
+
+		values = parsed;
+		return true;
+	}
+
+	//Returns false if the CSV couldn't be written
+	static bool run(const SweepSettings& settings)
+	{
+		std::vector<Run> runs;
+		for (float restitution : settings._restitutions)
+			for (float friction : settings._frictions)
+				for (float mass : settings._masses)
+					for (unsigned int spheres : settings._sphereCounts)
+						for (unsigned int seed = 0; seed < settings._seeds; seed++)
+							runs.emplace_back(restitution, friction, mass, spheres, settings._seed + seed);
+
+		//Worlds run next to each other, each one single threaded -> no synchronization inside a step
+		unsigned int threads = settings._threads > 0 ? settings._threads : JobSystem::getDefaultWorkerCount() + 1;
+		threads = std::max(1u, std::min(threads, (unsigned int)runs.size()));
+		spdlog::info("Sweep: {} worlds on {} threads, at most {} steps each", runs.size(), threads, settings._maxSteps);
+
+		auto start = std::chrono::high_resolution_clock::now();
+		std::atomic<unsigned int> finished(0);
+		{
+			JobSystem jobSystem(threads - 1);
+			jobSystem.parallelFor(0, (int)runs.size(), 1, [&](int begin, int end)
+			{
+				for (int i = begin; i < end; i++)
+				{
+					simulate(settings, runs[i]);
+					unsigned int done = ++finished;
+					spdlog::info("Sweep: {}/{} done (restitution {}, friction {}, mass {}, spheres {}, seed {}) -> {} after {:.2f} s",
+						done, runs.size(), runs[i]._restitution, runs[i]._friction, runs[i]._mass, runs[i]._spheres, runs[i]._seed,
+						runs[i]._settled ? "settled" : "not settled", runs[i]._settlingTime);
+				}
+			});
+		}
+		float totalTime = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - start).count();
+
+		//Rows in grid order, step times were measured while the other worlds were running as well
+		std::string csv = "restitution,friction,mass,spheres,density_per_100m2,seed,settled,settling_time_s,steps,peak_kinetic_energy_j,final_kinetic_energy_j,mean_step_ms,max_step_ms\n";
+		for (const Run& run : runs)
+		{
+			csv += fmt::format("{},{},{},{},{:.3f},{},{},{:.4f},{},{:.3f},{:.5f},{:.4f},{:.4f}\n",
+				run._restitution, run._friction, run._mass, run._spheres, run._spheres / 400.0f, run._seed, run._settled ? 1 : 0,
+				run._settlingTime, run._steps, run._peakEnergy, run._finalEnergy, run._meanStepTime, run._maxStepTime);
+		}
+
+		std::ofstream file(settings._csvFile);
+		file << csv;
+		if (!file)
+		{
+			spdlog::error("Couldn't write sweep results {}", settings._csvFile);
+			return false;
+		}
+
+		spdlog::info("Sweep: {} worlds in {:.1f} s -> {}", runs.size(), totalTime, settings._csvFile);
+		return true;
+	}
+};
\ No newline at end of file
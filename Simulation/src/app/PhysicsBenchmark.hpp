@@ -0,0 +1,340 @@
+#pragma once
+
+#include "PhysicsEngine.hpp"
+#include "SphFluid.hpp"
+#include "NBodySimulation.hpp"
+#include <spdlog/spdlog.h>
+#include <cmath>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+const unsigned int BENCHMARK_WARMUP_STEPS = 30;
+const unsigned int BENCHMARK_MEASURED_STEPS = 120;
+
+//Measures the average step time of the physics engine for different body and thread counts (runs without a window)
+class PhysicsBenchmark
+{
+private:
+	static const unsigned int LAYERS = 10;
+
+	//Drops the spheres as a block of layers (spacing = distance between sphere centers) onto a ground box that is big enough to hold all of them
+	static void createScene(PhysicsEngine& physicsEngine, unsigned int bodies, float spacing)
+	{
+		physicsEngine.reserve(bodies + 1);
+
+		unsigned int perRow = (unsigned int)std::ceil(std::sqrt((float)bodies / LAYERS));
+		float halfsize = perRow * spacing * 0.5f + 20.0f;
+		physicsEngine.addBox(glm::vec3(0.0f), glm::vec3(halfsize, 0.1f, halfsize), 0.0f, 1.0f, 1.0f);
+
+		for (unsigned int i = 0; i < bodies; i++)
+		{
+			unsigned int x = i % perRow;
+			unsigned int z = (i / perRow) % perRow;
+			unsigned int y = i / (perRow * perRow);
+
+			//Every other layer is shifted so the spheres don't stack perfectly
+			float offset = (y % 2) * spacing * 0.5f;
+			glm::vec3 position((x - perRow * 0.5f) * spacing + offset, 2.0f + y * spacing, (z - perRow * 0.5f) * spacing + offset);
+			physicsEngine.addSphere(position, 60.0f, 0.8f, 1.0f);
+		}
+	}
+
+public:
+	struct BroadphaseResult
+	{
+		float _stepTime, _broadphaseTime; //Averages in ms
+		unsigned int _pairs; //Average overlapping pairs per step
+	};
+
+	//Returns the average step time
+	static float run(unsigned int bodies, unsigned int threads)
+	{
+		PhysicsEngine physicsEngine(threads);
+		createScene(physicsEngine, bodies, 2.5f);
+
+		const float dt = 1.0f / 60.0f;
+		for (unsigned int i = 0; i < BENCHMARK_WARMUP_STEPS; i++)
+			physicsEngine.simulate(dt);
+
+		float total = 0.0f;
+		for (unsigned int i = 0; i < BENCHMARK_MEASURED_STEPS; i++)
+		{
+			physicsEngine.simulate(dt);
+			total += physicsEngine.getLastStepTime();
+		}
+
+		return total / BENCHMARK_MEASURED_STEPS;
+	}
+
+	//Single threaded, only the broadphase differs between runs
+	static BroadphaseResult runBroadphase(unsigned int bodies, float spacing, PhysicsBroadphase broadphase)
+	{
+		PhysicsEngine physicsEngine(1, SOLVER_SEQUENTIAL_IMPULSE, broadphase);
+		createScene(physicsEngine, bodies, spacing);
+
+		const float dt = 1.0f / 60.0f;
+		for (unsigned int i = 0; i < BENCHMARK_WARMUP_STEPS; i++)
+			physicsEngine.simulate(dt);
+
+		BroadphaseResult result = { 0.0f, 0.0f, 0 };
+		unsigned long long pairs = 0;
+		for (unsigned int i = 0; i < BENCHMARK_MEASURED_STEPS; i++)
+		{
+			physicsEngine.simulate(dt);
+			result._stepTime += physicsEngine.getLastStepTime();
+			result._broadphaseTime += physicsEngine.getLastBroadphaseTime();
+			pairs += physicsEngine.getOverlappingPairCount();
+		}
+
+		result._stepTime /= BENCHMARK_MEASURED_STEPS;
+		result._broadphaseTime /= BENCHMARK_MEASURED_STEPS;
+		result._pairs = (unsigned int)(pairs / BENCHMARK_MEASURED_STEPS);
+		return result;
+	}
+
+	//Compares all broadphases over body counts and densities (sphere spacing from touching to sparse) -> pick the broadphase per scene based on this
+	static void runBroadphases()
+	{
+		const unsigned int bodyCounts[] = { 1000, 5000, 10000, 25000 };
+		const float spacings[] = { 2.05f, 4.0f, 8.0f };
+		const char* densityNames[] = { "dense", "medium", "sparse" };
+		const PhysicsBroadphase broadphases[] = { BROADPHASE_DBVT, BROADPHASE_AXIS_SWEEP, BROADPHASE_AXIS_SWEEP_32, BROADPHASE_SPATIAL_HASH };
+
+		spdlog::info("Broadphase benchmark: {} warmup steps, {} measured steps, averages in ms", BENCHMARK_WARMUP_STEPS, BENCHMARK_MEASURED_STEPS);
+
+		for (unsigned int bodies : bodyCounts)
+		{
+			for (int density = 0; density < 3; density++)
+			{
+				for (PhysicsBroadphase broadphase : broadphases)
+				{
+					if (broadphase == BROADPHASE_AXIS_SWEEP && bodies + 1 > PHYSICS_AXIS_SWEEP_HANDLES)
+						continue;
+
+					BroadphaseResult result = runBroadphase(bodies, spacings[density], broadphase);
+					spdlog::info("Bodies: {:>6} | Density: {:<6} | Broadphase: {:<5} | Pairs: {:>6} | Pair finding: {:>8.3f} ms | Step: {:>8.3f} ms",
+						bodies, densityNames[density], PHYSICS_BROADPHASE_NAMES[broadphase], result._pairs, result._broadphaseTime, result._stepTime);
+				}
+			}
+		}
+	}
+
+	//Times batches of every query type against a settled scene for 1 thread and all hardware threads
+	static void runQueries()
+	{
+		const unsigned int bodies = 10000;
+		const unsigned int queryCounts[] = { 1000, 4000, 16000 };
+		const unsigned int overlapCapacity = 32;
+		unsigned int hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+
+		spdlog::info("Query benchmark: {} bodies, times per batch in ms", bodies);
+
+		for (unsigned int threads : { 1u, hardwareThreads })
+		{
+			PhysicsEngine physicsEngine(threads);
+			createScene(physicsEngine, bodies, 2.5f);
+			for (unsigned int i = 0; i < BENCHMARK_WARMUP_STEPS + BENCHMARK_MEASURED_STEPS; i++)
+				physicsEngine.simulate(1.0f / 60.0f);
+
+			//Rays and sweeps straight down onto the scene, overlaps in the pile
+			float halfsize = std::ceil(std::sqrt((float)bodies / LAYERS)) * 2.5f * 0.5f;
+			random::Generator generator(42);
+
+			for (unsigned int count : queryCounts)
+			{
+				std::vector<glm::vec3> points(count);
+				generator.fillVec3(&points[0], count, glm::vec3(-halfsize, 0.0f, -halfsize), glm::vec3(halfsize, 10.0f, halfsize));
+
+				std::vector<RayQuery> rays(count);
+				std::vector<SweepQuery> sweeps(count);
+				std::vector<OverlapQuery> overlaps(count);
+				for (unsigned int i = 0; i < count; i++)
+				{
+					rays[i] = { glm::vec3(points[i].x, 100.0f, points[i].z), glm::vec3(points[i].x, -10.0f, points[i].z) };
+					sweeps[i] = { rays[i]._from, rays[i]._to, 0.5f };
+					overlaps[i] = { points[i], 3.0f };
+				}
+
+				std::vector<QueryHit> hits(count);
+				std::vector<OverlapResult> overlapResults(count);
+				std::vector<unsigned int> overlapBodies(count * overlapCapacity);
+
+				physicsEngine.raycast(&rays[0], &hits[0], count);
+				float rayTime = physicsEngine.getLastQueryTime();
+				physicsEngine.sweepSpheres(&sweeps[0], &hits[0], count);
+				float sweepTime = physicsEngine.getLastQueryTime();
+				physicsEngine.overlapSpheres(&overlaps[0], &overlapResults[0], count, &overlapBodies[0], overlapCapacity);
+				float overlapTime = physicsEngine.getLastQueryTime();
+
+				//Against the ground only -> the second batch comes from the cache
+				physicsEngine.raycast(&rays[0], &hits[0], count, QUERY_STATIC);
+				float staticTime = physicsEngine.getLastQueryTime();
+				physicsEngine.raycast(&rays[0], &hits[0], count, QUERY_STATIC);
+				float cachedTime = physicsEngine.getLastQueryTime();
+
+				spdlog::info("Threads: {:>2} | Queries: {:>6} | Rays: {:>7.3f} | Sweeps: {:>7.3f} | Overlaps: {:>7.3f} | Static rays: {:>7.3f} (cached {:.3f})",
+					physicsEngine.getThreadCount(), count, rayTime, sweepTime, overlapTime, staticTime, cachedTime);
+			}
+		}
+	}
+
+	static void runAll()
+	{
+		const unsigned int bodyCounts[] = { 1000, 5000, 10000, 25000 };
+
+		//1, 2, 4, ... up to the number of hardware threads
+		std::vector<unsigned int> threadCounts;
+		unsigned int hardwareThreads = std::max(std::thread::hardware_concurrency(), 1u);
+		for (unsigned int threads = 1; threads < hardwareThreads; threads *= 2)
+			threadCounts.push_back(threads);
+		threadCounts.push_back(hardwareThreads);
+
+		spdlog::info("Physics benchmark: {} warmup steps, {} measured steps, average step time in ms", BENCHMARK_WARMUP_STEPS, BENCHMARK_MEASURED_STEPS);
+
+		for (unsigned int bodies : bodyCounts)
+		{
+			float singleThreaded = 0.0f;
+
+			for (unsigned int threads : threadCounts)
+			{
+				float stepTime = run(bodies, threads);
+				if (threads == 1)
+					singleThreaded = stepTime;
+
+				spdlog::info("Bodies: {:>6} | Threads: {:>2} | Step: {:>8.3f} ms | Speedup: {:.2f}x", bodies, threads, stepTime, singleThreaded / stepTime);
+			}
+		}
+	}
+
+	//Steps the SPH fluid (dam break) for different particle and thread counts, with the AVX2 and the scalar kernels
+	static void runFluid()
+	{
+		const unsigned int particleCounts[] = { 25000, 50000, 100000, 200000 };
+		const unsigned int warmupSteps = 20, measuredSteps = 60;
+		std::vector<unsigned int> threadCounts = { 1 };
+		if (std::thread::hardware_concurrency() > 1)
+			threadCounts.push_back(std::thread::hardware_concurrency());
+
+		spdlog::info("Fluid benchmark: {} warmup steps, {} measured steps of {} s, averages in ms, AVX2 {}",
+			warmupSteps, measuredSteps, FluidSettings()._timeStep, CpuFeatures::hasAvx2() ? "available" : "not available");
+
+		for (unsigned int particles : particleCounts)
+		{
+			for (unsigned int threads : threadCounts)
+			{
+				JobSystem jobSystem(threads - 1);
+				for (bool simd : { true, false })
+				{
+					if (simd && !CpuFeatures::hasAvx2())
+						continue;
+
+					FluidSettings settings;
+					settings._particles = particles;
+					settings._simd = simd;
+					SphFluid fluid(jobSystem, settings);
+
+					for (unsigned int i = 0; i < warmupSteps; i++)
+						fluid.step();
+
+					SphFluid::StepTimes total;
+					for (unsigned int i = 0; i < measuredSteps; i++)
+					{
+						fluid.step();
+						const SphFluid::StepTimes& times = fluid.getLastStepTimes();
+						total._grid += times._grid;
+						total._density += times._density;
+						total._forces += times._forces;
+						total._integrate += times._integrate;
+					}
+
+					float step = total.total() / measuredSteps;
+					spdlog::info("Particles: {:>6} | Threads: {:>2} | Kernels: {:<6} | Step: {:>8.3f} ms (grid {:.3f}, density {:.3f}, forces {:.3f}, integrate {:.3f}) | {:.1f} steps/s",
+						particles, fluid.getThreadCount(), simd ? "AVX2" : "scalar", step, total._grid / measuredSteps, total._density / measuredSteps,
+						total._forces / measuredSteps, total._integrate / measuredSteps, 1000.0f / step);
+				}
+			}
+		}
+	}
+
+	//Barnes-Hut against direct summation for 10k to 1M bodies and a few opening angles, on all hardware threads
+	//The direct sum is O(n^2) -> it runs for a sample of the bodies only, its time for all bodies gets extrapolated from that
+	//The same sample gives the mean relative error of the Barnes-Hut accelerations
+	static void runNBody()
+	{
+		const unsigned int bodyCounts[] = { 10000, 100000, 1000000 };
+		const float thetas[] = { 0.3f, 0.5f, 0.8f };
+		const unsigned int measuredSteps = 3, samples = 1024;
+
+		spdlog::info("N-body benchmark: {} measured steps, direct sum from {} sampled bodies, times in ms, AVX2 {}",
+			measuredSteps, samples, CpuFeatures::hasAvx2() ? "available" : "not available");
+
+		JobSystem jobSystem(JobSystem::getDefaultWorkerCount());
+		for (unsigned int bodies : bodyCounts)
+		{
+			for (float theta : thetas)
+			{
+				NBodySettings settings;
+				settings._bodies = bodies;
+				settings._theta = theta;
+				NBodySimulation simulation(jobSystem, settings);
+
+				//The first step grows all buffers
+				simulation.step();
+
+				float tree = 0.0f, forces = 0.0f;
+				for (unsigned int i = 0; i < measuredSteps; i++)
+				{
+					simulation.step();
+					tree += simulation.getLastStepTimes()._tree;
+					forces += simulation.getLastStepTimes()._forces;
+				}
+				tree /= measuredSteps;
+				forces /= measuredSteps;
+
+				//Evenly spread sample (the bodies are Morton sorted -> the sample covers the whole disk)
+				simulation.computeAccelerations();
+				unsigned int sampleCount = std::min(samples, bodies);
+				std::vector<unsigned int> indices(sampleCount);
+				for (unsigned int i = 0; i < sampleCount; i++)
+					indices[i] = (unsigned int)((unsigned long long)i * bodies / sampleCount);
+
+				std::vector<glm::vec3> exact(sampleCount);
+				float direct = simulation.computeDirect(&indices[0], sampleCount, &exact[0]) * bodies / sampleCount;
+
+				double error = 0.0;
+				for (unsigned int i = 0; i < sampleCount; i++)
+					error += glm::length(simulation.getAcceleration(indices[i]) - exact[i]) / std::max(glm::length(exact[i]), 1e-12f);
+				error /= sampleCount;
+
+				spdlog::info("Bodies: {:>7} | Theta: {:.1f} | Barnes-Hut: {:>9.3f} ms (tree {:.3f}, forces {:.3f}, {:.0f} interactions/body) | Direct: {:>11.1f} ms | Speedup: {:>7.1f}x | Error: {:.2e}",
+					bodies, theta, tree + forces, tree, forces, simulation.getInteractionsPerBody(), direct, direct / (tree + forces), error);
+			}
+		}
+	}
+
+	//Runs a snapshot headless with a fixed timestep and prints the state hash -> replays of the same snapshot have to print the same hash
+	static void replay(const std::string& filepath, unsigned int steps)
+	{
+		std::ifstream file(filepath, std::ios::binary);
+		char magic[sizeof(SNAPSHOT_MAGIC)] = {};
+		file.read(magic, sizeof(magic));
+
+		PhysicsEngine physicsEngine(1);
+		if (!file || !std::equal(magic, magic + sizeof(magic), SNAPSHOT_MAGIC) || !physicsEngine.loadSnapshot(file))
+		{
+			spdlog::error("Couldn't read snapshot {}", filepath);
+			return;
+		}
+
+		float total = 0.0f;
+		for (unsigned int i = 0; i < steps; i++)
+		{
+			physicsEngine.simulate(1.0f / 60.0f);
+			total += physicsEngine.getLastStepTime();
+		}
+
+		spdlog::info("Replay {}: {} bodies, {} steps, {:.3f} ms/step, state hash {:016x}", filepath, physicsEngine.getBodyCount(), steps, total / std::max(steps, 1u), physicsEngine.computeStateHash());
+	}
+};
\ No newline at end of file
@@ -1,140 +1,1700 @@
 #pragma once
 
 #include <btBulletDynamicsCommon.h>
-#include "Object.hpp"
+#include <BulletDynamics/Dynamics/btDiscreteDynamicsWorldMt.h>
+#include <BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolverMt.h>
+#include <BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h>
+#include <BulletDynamics/ConstraintSolver/btNNCGConstraintSolver.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
 #include <map>
+#include <string>
+#include <vector>
 #include "Random.hpp"
+#include "ObjectPool.hpp"
+#include "PhysicsTaskScheduler.hpp"
+#include "SpatialHashBroadphase.hpp"
+#include "TimedBroadphase.hpp"
+#include "PhysicsQueries.hpp"
+#include "ContactEvents.hpp"
+#include "PhysicsLod.hpp"
+#include "Frustum.hpp"
+#include "DirtyRanges.hpp"
+#include "InstanceTransform.hpp"
+#include <spdlog/spdlog.h>
+#include <chrono>
+#include <istream>
+#include <ostream>
+#include <xmmintrin.h>
 
-unsigned int PHYSIC_BODY_INDEX = 0;
+//Header of simulation snapshot files (followed by the physics engine's part)
+const char SNAPSHOT_MAGIC[8] = { 'S', 'I', 'M', 'S', 'N', 'A', 'P', '1' };
+const uint32_t PHYSICS_SNAPSHOT_VERSION = 2;
 
-class PhysicsEngine 
+//Constraint solver of the dynamics world
+enum PhysicsSolver
+{
+	SOLVER_SEQUENTIAL_IMPULSE, //Bullet's default
+	SOLVER_NNCG //Nonlinear nonsmooth conjugate gradient -> converges faster on stacks, a bit more expensive per iteration
+};
+
+//Broadphase of the dynamics world
+enum PhysicsBroadphase
+{
+	BROADPHASE_DBVT, //Dynamic AABB trees, no limits on world size or body count
+	BROADPHASE_AXIS_SWEEP, //Sweep and prune with 16 bit axes, at most PHYSICS_AXIS_SWEEP_HANDLES bodies inside PHYSICS_WORLD_MIN/MAX
+	BROADPHASE_AXIS_SWEEP_32, //Sweep and prune with 32 bit axes, at most PHYSICS_AXIS_SWEEP_32_HANDLES bodies inside PHYSICS_WORLD_MIN/MAX
+	BROADPHASE_SPATIAL_HASH //Uniform grid that gets rebuilt every step (SpatialHashBroadphase)
+};
+
+//Names for the command line and benchmark reports
+const char* const PHYSICS_SOLVER_NAMES[] = { "sequential", "nncg" };
+const char* const PHYSICS_BROADPHASE_NAMES[] = { "dbvt", "sap", "sap32", "hash" };
+
+//Bounds of the sweep and prune broadphases -> covers the arena, the benchmark scenes and everything up to the respawn height (bodies outside get clamped to the border)
+const btVector3 PHYSICS_WORLD_MIN(-300.0f, -50.0f, -300.0f);
+const btVector3 PHYSICS_WORLD_MAX(500.0f, 500.0f, 500.0f);
+const unsigned short PHYSICS_AXIS_SWEEP_HANDLES = 32766;
+const unsigned int PHYSICS_AXIS_SWEEP_32_HANDLES = 262144;
+const float PHYSICS_HASH_CELL_SIZE = 4.0f; //Twice the sphere diameter
+const btVector3 PHYSICS_GRAVITY(0.0f, -9.8f, 0.0f);
+
+//Returns false for unknown names
+template<typename Enum, size_t N>
+bool parsePhysicsOption(const std::string& name, const char* const (&names)[N], Enum& value)
+{
+	for (size_t i = 0; i < N; i++)
+	{
+		if (name == names[i])
+		{
+			value = (Enum)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+//Motion state that reports back to the engine when Bullet moved its body
+//Bullet only calls setWorldTransform for bodies that aren't sleeping, bodies that are still active but didn't move get filtered out here -> settled scenes produce no updates at all
+class PhysicsMotionState : public btMotionState
+{
+public:
+	btTransform _transform;
+	unsigned int _bodyIndex;
+	int _instanceSlot;
+	bool _moved;
+	std::vector<unsigned int>* _movedBodies = nullptr;
+
+	PhysicsMotionState(const btTransform& transform, unsigned int bodyIndex, std::vector<unsigned int>* movedBodies)
+		: _transform(transform), _bodyIndex(bodyIndex), _instanceSlot(-1), _moved(false), _movedBodies(movedBodies)
+	{
+		markMoved();
+	}
+
+	void getWorldTransform(btTransform& worldTrans) const override
+	{
+		worldTrans = _transform;
+	}
+
+	void setWorldTransform(const btTransform& worldTrans) override
+	{
+		if (!(worldTrans == _transform))
+		{
+			_transform = worldTrans;
+			markMoved();
+		}
+	}
+
+	void markMoved()
+	{
+		if (!_moved)
+		{
+			_moved = true;
+			_movedBodies->push_back(_bodyIndex);
+		}
+	}
+};
+
+//Physics part of a snapshot as read from the file (PhysicsEngine::readSnapshot)
+struct PhysicsSnapshot
+{
+	struct Body
+	{
+		uint32_t _shapeType = 0;
+		glm::vec3 _dimensions = glm::vec3(0.0f);
+		btScalar _mass = 0, _restitution = 0, _friction = 0, _deactivationTime = 0;
+		uint8_t _isStatic = 0, _inWorld = 0;
+		int32_t _instanceSlot = -1, _activationState = 0;
+		btVector3 _basis[3], _origin, _linearVelocity, _angularVelocity;
+	};
+
+	std::vector<Body> _bodies;
+	std::vector<uint32_t> _freeBodies;
+	random::Generator _random;
+};
+
+class PhysicsEngine
 {
 private:
-	btBroadphaseInterface* _broadphase = nullptr;
+	//Shapes are shared between all bodies with the same type and dimensions
+	enum ShapeType
+	{
+		SHAPE_SPHERE,
+		SHAPE_BOX
+	};
+
+	struct ShapeKey
+	{
+		ShapeType _type;
+		float _x, _y, _z;
+
+		bool operator<(const ShapeKey& other) const
+		{
+			if (_type != other._type) return _type < other._type;
+			if (_x != other._x) return _x < other._x;
+			if (_y != other._y) return _y < other._y;
+			return _z < other._z;
+		}
+	};
+
+	TimedBroadphase* _broadphase = nullptr; //Wraps the selected broadphase
 	btDefaultCollisionConfiguration* _collisionConfiguration = nullptr;
 	btCollisionDispatcher* _dispatcher = nullptr;
-	btSequentialImpulseConstraintSolver* _solver = nullptr;
+	btConstraintSolver* _solver = nullptr;
 	btDiscreteDynamicsWorld* _dynamicsWorld = nullptr;
-	btCollisionShape* _boxShape = nullptr, * _sphereShape = nullptr;
-	std::map<unsigned int, btRigidBody*> _physicBodies;
 
-	void init() 
+	PhysicsSolver _solverType;
+	PhysicsBroadphase _broadphaseType;
+
+	//Multithreading (the Bullet world only uses it if the engine got created with more than one thread)
+	unsigned int _threads;
+	JobSystem* _jobSystem = nullptr;
+	PhysicsTaskScheduler* _taskScheduler = nullptr;
+	btConstraintSolverPoolMt* _solverPool = nullptr;
+
+	float _lastStepTime = 0.0f, _lastBroadphaseTime = 0.0f;
+
+	//Queries (run in parallel on the job system if there is one and the broadphase allows it)
+	static const int QUERY_GRAIN_SIZE = 32;
+	uint32_t _staticGeneration = 0; //Changes whenever a static body gets added, moved or removed -> invalidates the cached static queries
+	StaticQueryCache<RayQuery> _rayCache;
+	StaticQueryCache<SweepQuery> _sweepCache;
+	std::vector<uint8_t> _queryMisses; //Queries of the current batch that weren't cached yet
+	float _lastQueryTime = 0.0f;
+
+	//Contact events (only pairs where at least one body is interested get tracked)
+	struct ContactPair
+	{
+		uint64_t _key; //Smaller body index in the upper 32 bits
+		float _impulse;
+		btVector3 _point, _normal;
+	};
+	std::vector<uint8_t> _contactInterest; //ContactEventType flags of every body
+	unsigned int _interestedBodies = 0;
+	float _minContactImpulse = 0.0f;
+	std::vector<ContactPair> _contactPairs; //Pairs of the current substep, sorted by key
+	std::vector<uint64_t> _touchingPairs, _previousTouchingPairs; //Keys of the pairs that touched in the current and in the last substep
+	ContactEvents _contactEvents;
+
+	//Level of detail -> far or off-screen bodies get parked (DISABLE_SIMULATION: no integration, no narrowphase among each other, no box updates)
+	//Reduced bodies get unparked for one substep out of every _reducedInterval, frozen ones stay parked until they are close again or get touched
+	bool _lodEnabled = false;
+	PhysicsLodSettings _lodSettings;
+	std::vector<uint8_t> _lodLevels;
+	std::vector<uint16_t> _lodWakeSteps; //Remaining substeps at full rate after a wake-up
+	std::vector<int> _parkedStates; //Activation state from before parking (-1 = not parked)
+	std::vector<unsigned int> _reducedBodies, _steppingBodies; //Bodies at LOD_REDUCED and the ones that take the current substep
+	unsigned int _lodCounts[LOD_LEVEL_COUNT] = {};
+	unsigned int _parkedCount = 0, _lodSubstep = 0;
+	float _lodStepTimes[2] = {}; //Average step time in ms without (0) and with (1) level of detail
+	bool _lodStepMeasured[2] = {};
+
+	//Shape cache
+	std::map<ShapeKey, btCollisionShape*> _shapes;
+
+	//Pools for bodies and motion states -> respawning resets pooled objects instead of allocating new ones
+	ObjectPool<btRigidBody> _bodyPool;
+	ObjectPool<PhysicsMotionState> _motionStatePool;
+
+	//Dense storage, the body index is the position in these arrays
+	std::vector<btRigidBody*> _physicBodies;
+	std::vector<PhysicsMotionState*> _motionStates;
+
+	//Bodies whose motion state changed since the last transform sync
+	std::vector<unsigned int> _movedBodies;
+
+	//Slots of removed bodies -> the next added body takes one of them instead of growing the arrays
+	std::vector<unsigned int> _freeBodies;
+
+	//Seeded generator for the respawn positions -> part of the snapshot so replays respawn bodies at the same positions
+	random::Generator _random;
+
+	//Collision filter of the bodies a query may hit
+	static int getQueryFilter(int mask)
+	{
+		return ((mask & QUERY_DYNAMIC) ? btBroadphaseProxy::DefaultFilter : 0) | ((mask & QUERY_STATIC) ? btBroadphaseProxy::StaticFilter : 0);
+	}
+
+	static void writeHit(const btCollisionObject* object, btScalar fraction, const btVector3& point, const btVector3& normal, QueryHit& hit)
+	{
+		if (!object)
+		{
+			hit._bodyIndex = -1;
+			hit._fraction = 1.0f;
+			return;
+		}
+
+		hit._bodyIndex = object->getUserIndex();
+		hit._fraction = (float)fraction;
+		hit._point = glm::vec3((float)point.x(), (float)point.y(), (float)point.z());
+		hit._normal = glm::vec3((float)normal.x(), (float)normal.y(), (float)normal.z());
+	}
+
+	//Exact test for spheres and boxes, everything else counts as touching if the bounding boxes do
+	static bool touchesSphere(const btCollisionObject* object, const btVector3& center, btScalar radius)
+	{
+		const btCollisionShape* shape = object->getCollisionShape();
+		const btTransform& transform = object->getWorldTransform();
+
+		if (shape->getShapeType() == SPHERE_SHAPE_PROXYTYPE)
+		{
+			btScalar distance = radius + static_cast<const btSphereShape*>(shape)->getRadius();
+			return (transform.getOrigin() - center).length2() <= distance * distance;
+		}
+
+		if (shape->getShapeType() == BOX_SHAPE_PROXYTYPE)
+		{
+			//Closest point of the box to the center in box space
+			btVector3 local = transform.invXform(center);
+			btVector3 halfExtents = static_cast<const btBoxShape*>(shape)->getHalfExtentsWithMargin();
+			btVector3 closest(btClamped(local.x(), -halfExtents.x(), halfExtents.x()), btClamped(local.y(), -halfExtents.y(), halfExtents.y()), btClamped(local.z(), -halfExtents.z(), halfExtents.z()));
+			return (local - closest).length2() <= radius * radius;
+		}
+
+		return true;
+	}
+
+	//Collects the touching bodies of one overlap query straight into its part of the output array
+	struct OverlapCallback : public btBroadphaseAabbCallback
+	{
+		btVector3 _center;
+		btScalar _radius;
+		int _filter;
+		unsigned int* _bodies;
+		unsigned int _capacity;
+		OverlapResult _result = { 0, 0 };
+
+		bool process(const btBroadphaseProxy* proxy) override
+		{
+			if (!(proxy->m_collisionFilterGroup & _filter))
+				return true;
+
+			const btCollisionObject* object = static_cast<const btCollisionObject*>(proxy->m_clientObject);
+			if (!touchesSphere(object, _center, _radius))
+				return true;
+
+			if (_result._count < _capacity)
+				_bodies[_result._count++] = (unsigned int)object->getUserIndex();
+			_result._found++;
+			return true;
+		}
+	};
+
+	//Closest hit along a ray or of a moving sphere (radius > 0), straight on the broadphase instead of btCollisionWorld::rayTest/convexSweepTest
+	//Spheres and boxes (rays only) get tested analytically, everything else by Bullet's narrowphase
+	//Every hit shortens the ray, so broadphases that look at m_lambda_max can skip everything behind it
+	struct CastCallback : public btBroadphaseRayCallback
+	{
+		btVector3 _from, _to, _direction; //Normalized direction
+		btScalar _radius;
+		int _filter;
+		const btConvexShape* _castShape; //Only for sweeps
+		const btCollisionObject* _hitObject = nullptr;
+		btScalar _hitDistance;
+		btVector3 _hitPoint, _hitNormal;
+
+		CastCallback(const btVector3& from, const btVector3& to, btScalar radius, int filter, const btConvexShape* castShape)
+			: _from(from), _to(to), _radius(radius), _filter(filter), _castShape(castShape)
+		{
+			btVector3 delta = to - from;
+			btScalar length = delta.length();
+			_direction = length > SIMD_EPSILON ? delta / length : btVector3(0, 0, 0);
+
+			//Same setup as Bullet's own ray callbacks
+			for (int i = 0; i < 3; i++)
+			{
+				m_rayDirectionInverse[i] = _direction[i] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / _direction[i];
+				m_signs[i] = m_rayDirectionInverse[i] < 0.0;
+			}
+
+			m_lambda_max = length;
+			_hitDistance = length;
+		}
+
+		//Ray against a sphere that got grown by the cast radius (starting inside doesn't count)
+		bool castSphere(const btVector3& center, btScalar radius, btScalar& distance, btVector3& normal) const
+		{
+			btVector3 offset = _from - center;
+			btScalar b = offset.dot(_direction);
+			btScalar c = offset.length2() - radius * radius;
+			btScalar discriminant = b * b - c;
+			if (c <= 0.0f || b > 0.0f || discriminant < 0.0f)
+				return false;
+
+			distance = -b - btSqrt(discriminant);
+			normal = (_from + _direction * distance - center) / radius;
+			return true;
+		}
+
+		//Slab test in box space
+		bool castBox(const btTransform& transform, const btVector3& halfExtents, btScalar& distance, btVector3& normal) const
+		{
+			btVector3 from = transform.invXform(_from);
+			btVector3 direction = transform.getBasis().transpose() * _direction;
+
+			btScalar enter = -BT_LARGE_FLOAT, exit = BT_LARGE_FLOAT;
+			int enterAxis = -1;
+			for (int i = 0; i < 3; i++)
+			{
+				if (btFabs(direction[i]) < SIMD_EPSILON)
+				{
+					if (from[i] < -halfExtents[i] || from[i] > halfExtents[i])
+						return false;
+					continue;
+				}
+
+				btScalar t0 = (-halfExtents[i] - from[i]) / direction[i];
+				btScalar t1 = (halfExtents[i] - from[i]) / direction[i];
+				if (t0 > t1)
+					btSwap(t0, t1);
+
+				if (t0 > enter)
+				{
+					enter = t0;
+					enterAxis = i;
+				}
+				exit = btMin(exit, t1);
+			}
+
+			if (enterAxis < 0 || enter < 0.0f || enter > exit)
+				return false;
+
+			btVector3 localNormal(0, 0, 0);
+			localNormal[enterAxis] = direction[enterAxis] > 0.0f ? -1.0f : 1.0f;
+			distance = enter;
+			normal = transform.getBasis() * localNormal;
+			return true;
+		}
+
+		bool process(const btBroadphaseProxy* proxy) override
+		{
+			if (!(proxy->m_collisionFilterGroup & _filter))
+				return true;
+
+			btCollisionObject* object = static_cast<btCollisionObject*>(proxy->m_clientObject);
+			const btCollisionShape* shape = object->getCollisionShape();
+			const btTransform& transform = object->getWorldTransform();
+			btScalar distance;
+			btVector3 normal, point;
+
+			if (shape->getShapeType() == SPHERE_SHAPE_PROXYTYPE)
+			{
+				if (!castSphere(transform.getOrigin(), static_cast<const btSphereShape*>(shape)->getRadius() + _radius, distance, normal))
+					return true;
+				point = _from + _direction * distance - normal * _radius;
+			}
+			else if (shape->getShapeType() == BOX_SHAPE_PROXYTYPE && !_castShape)
+			{
+				if (!castBox(transform, static_cast<const btBoxShape*>(shape)->getHalfExtentsWithMargin(), distance, normal))
+					return true;
+				point = _from + _direction * distance;
+			}
+			else
+			{
+				btTransform from(btQuaternion(0, 0, 0, 1), _from), to(btQuaternion(0, 0, 0, 1), _to);
+				btScalar fraction;
+
+				if (_castShape)
+				{
+					btCollisionWorld::ClosestConvexResultCallback callback(_from, _to);
+					btCollisionWorld::objectQuerySingle(_castShape, from, to, object, shape, transform, callback, 0.0f);
+					if (!callback.hasHit())
+						return true;
+					fraction = callback.m_closestHitFraction;
+					normal = callback.m_hitNormalWorld;
+					point = callback.m_hitPointWorld;
+				}
+				else
+				{
+					btCollisionWorld::ClosestRayResultCallback callback(_from, _to);
+					btCollisionWorld::rayTestSingle(from, to, object, shape, transform, callback);
+					if (!callback.hasHit())
+						return true;
+					fraction = callback.m_closestHitFraction;
+					normal = callback.m_hitNormalWorld;
+					point = callback.m_hitPointWorld;
+				}
+
+				distance = fraction * (_to - _from).length();
+			}
+
+			if (distance < _hitDistance)
+			{
+				_hitObject = object;
+				_hitDistance = distance;
+				_hitPoint = point;
+				_hitNormal = normal;
+				m_lambda_max = distance;
+			}
+
+			return true;
+		}
+	};
+
+	void runCast(const glm::vec3& from, const glm::vec3& to, float radius, int filter, QueryHit& hit) const
+	{
+		btVector3 btFrom(from.x, from.y, from.z), btTo(to.x, to.y, to.z);
+		btScalar length = (btTo - btFrom).length();
+
+		//Shapes on the stack -> no allocations and nothing shared between threads
+		btSphereShape sphere(radius > 0.0f ? radius : 1.0f);
+		CastCallback callback(btFrom, btTo, radius, filter, radius > 0.0f ? &sphere : nullptr);
+
+		btVector3 extent(radius, radius, radius);
+		_broadphase->rayTest(btFrom, btTo, callback, -extent, extent);
+		writeHit(callback._hitObject, length > 0.0f ? callback._hitDistance / length : 0.0f, callback._hitPoint, callback._hitNormal, hit);
+	}
+
+	//btDbvtBroadphase::rayTest walks the tree with one shared stack (one per Bullet thread index in BT_THREADSAFE builds, but the job system's workers
+	//don't get their own index), btAxisSweep3 forwards rays to such a tree -> only the spatial hash can take casts from several threads at once
+	//Box tests (aabbTest) use a stack on the caller's side with every broadphase
+	bool canCastInParallel() const
+	{
+		return _broadphaseType == BROADPHASE_SPATIAL_HASH;
+	}
+
+	//Runs query(i) for every index, spread over the job system for bigger batches if parallel is set
+	template<typename Query>
+	void forEachQuery(unsigned int count, const Query& query, bool parallel = true)
+	{
+		if (parallel && _jobSystem && count > QUERY_GRAIN_SIZE)
+		{
+			_jobSystem->parallelFor(0, (int)count, QUERY_GRAIN_SIZE, [&query](int begin, int end)
+			{
+				for (int i = begin; i < end; i++)
+					query((unsigned int)i);
+			});
+		}
+		else
+		{
+			for (unsigned int i = 0; i < count; i++)
+				query(i);
+		}
+	}
+
+	//Queries that only hit static bodies get looked up first and stored afterwards (serially, the lookups during the batch only read)
+	template<typename Query, typename RunQuery>
+	void runCachedQueries(const Query* queries, QueryHit* hits, unsigned int count, int mask, StaticQueryCache<Query>& cache, const RunQuery& runQuery, bool parallel)
+	{
+		bool cached = mask == QUERY_STATIC;
+		if (cached)
+		{
+			cache.validate(_staticGeneration);
+			if (_queryMisses.size() < count)
+				_queryMisses.resize(count);
+		}
+
+		forEachQuery(count, [&](unsigned int i)
+		{
+			if (cached && cache.find(queries[i], hits[i]))
+			{
+				_queryMisses[i] = 0;
+				return;
+			}
+
+			runQuery(queries[i], hits[i]);
+			if (cached)
+				_queryMisses[i] = 1;
+		}, parallel);
+
+		if (cached)
+		{
+			for (unsigned int i = 0; i < count; i++)
+			{
+				if (_queryMisses[i])
+					cache.store(queries[i], hits[i]);
+			}
+		}
+	}
+
+	//Called by Bullet before every substep
+	static void onInternalPreTick(btDynamicsWorld* world, btScalar timeStep)
+	{
+		static_cast<PhysicsEngine*>(world->getWorldUserInfo())->beginLodSubstep(timeStep);
+	}
+
+	//Called by Bullet after every substep -> the solver's impulses are still stored in the manifolds
+	static void onInternalTick(btDynamicsWorld* world, btScalar timeStep)
+	{
+		PhysicsEngine* engine = static_cast<PhysicsEngine*>(world->getWorldUserInfo());
+		engine->endLodSubstep();
+		engine->collectContactEvents();
+	}
+
+	bool isParked(unsigned int index) const
+	{
+		return index < _parkedStates.size() && _parkedStates[index] >= 0;
+	}
+
+	void parkBody(unsigned int index)
+	{
+		if (_parkedStates[index] >= 0)
+			return;
+
+		btRigidBody* body = _physicBodies[index];
+		_parkedStates[index] = body->getActivationState();
+		body->forceActivationState(DISABLE_SIMULATION);
+		_parkedCount++;
+
+		//Parked bodies don't get their boxes updated anymore -> the last move has to be in there
+		_dynamicsWorld->updateSingleAabb(body);
+	}
+
+	void unparkBody(unsigned int index)
+	{
+		if (_parkedStates[index] < 0)
+			return;
+
+		_physicBodies[index]->forceActivationState(_parkedStates[index]);
+		_parkedStates[index] = -1;
+		_parkedCount--;
+	}
+
+	//Back to full rate without any parking (respawned or removed bodies)
+	void resetLod(unsigned int index)
+	{
+		if (index >= _lodLevels.size())
+			return;
+
+		unparkBody(index);
+		if (_lodLevels[index] != LOD_FULL)
+		{
+			_lodCounts[_lodLevels[index]]--;
+			_lodCounts[LOD_FULL]++;
+			_lodLevels[index] = LOD_FULL;
+		}
+		_lodWakeSteps[index] = 0;
+	}
+
+	void setLodLevel(unsigned int index, PhysicsLodLevel level)
+	{
+		_lodCounts[level]++;
+		if (_lodLevels[index] == level)
+			return;
+
+		_lodLevels[index] = (uint8_t)level;
+		if (level == LOD_FULL)
+			unparkBody(index);
+		else
+			parkBody(index);
+	}
+
+	//Reduced bodies take every _reducedInterval-th substep with their velocity scaled up by the interval
+	//-> they cover the distance of all skipped substeps, gravity of the skipped substeps gets added up front
+	//The bigger moves would tunnel through the ground -> Bullet's swept sphere CCD is on for that substep
+	void beginLodSubstep(btScalar timeStep)
+	{
+		_steppingBodies.clear();
+		if (!_lodEnabled || _reducedBodies.empty())
+			return;
+
+		unsigned int interval = std::max(1u, _lodSettings._reducedInterval);
+		btScalar scale = (btScalar)interval;
+		for (unsigned int index : _reducedBodies)
+		{
+			if (_lodLevels[index] != LOD_REDUCED || (index + _lodSubstep) % interval != 0)
+				continue;
+
+			unparkBody(index);
+			btRigidBody* body = _physicBodies[index];
+			if (body->isActive())
+			{
+				body->setLinearVelocity((body->getLinearVelocity() + PHYSICS_GRAVITY * (timeStep * scale)) * scale);
+				body->setAngularVelocity(body->getAngularVelocity() * scale);
+			}
+
+			//Half the bounding sphere diameter fits into spheres and cubes
+			btScalar radius = body->getCollisionShape()->getAngularMotionDisc() * 0.5f;
+			body->setCcdMotionThreshold(radius);
+			body->setCcdSweptSphereRadius(radius);
+			_steppingBodies.push_back(index);
+		}
+	}
+
+	void endLodSubstep()
+	{
+		if (!_lodEnabled)
+			return;
+
+		//Scale the stepping bodies back and park them again
+		btScalar scale = (btScalar)std::max(1u, _lodSettings._reducedInterval);
+		for (unsigned int index : _steppingBodies)
+		{
+			btRigidBody* body = _physicBodies[index];
+			body->setLinearVelocity(body->getLinearVelocity() / scale);
+			body->setAngularVelocity(body->getAngularVelocity() / scale);
+			body->setInterpolationLinearVelocity(body->getLinearVelocity());
+			body->setInterpolationAngularVelocity(body->getAngularVelocity());
+			_dynamicsWorld->synchronizeSingleMotionState(body); //Bullet only syncs active bodies after the substep
+			body->setCcdMotionThreshold(0.0f);
+
+			if (_lodLevels[index] == LOD_REDUCED)
+				parkBody(index);
+		}
+		_steppingBodies.clear();
+
+		//Parked bodies that touch a body at full rate wake up (the solver already pushed them, but they wouldn't move)
+		if (_parkedCount > 0)
+		{
+			int manifolds = _dispatcher->getNumManifolds();
+			for (int i = 0; i < manifolds; i++)
+			{
+				const btPersistentManifold* manifold = _dispatcher->getManifoldByIndexInternal(i);
+				if (manifold->getNumContacts() == 0)
+					continue;
+
+				unsigned int a = (unsigned int)manifold->getBody0()->getUserIndex();
+				unsigned int b = (unsigned int)manifold->getBody1()->getUserIndex();
+				if (isParked(a) != isParked(b))
+				{
+					unsigned int parked = isParked(a) ? a : b, other = isParked(a) ? b : a;
+					const btRigidBody* otherBody = _physicBodies[other];
+					if (!otherBody->isStaticObject() && otherBody->isActive() && (other >= _lodLevels.size() || _lodLevels[other] == LOD_FULL))
+					{
+						resetLod(parked);
+						_physicBodies[parked]->activate(true);
+						_lodWakeSteps[parked] = (uint16_t)std::min(_lodSettings._wakeSteps, 65535u);
+					}
+				}
+			}
+		}
+
+		for (uint16_t& wakeSteps : _lodWakeSteps)
+		{
+			if (wakeSteps > 0)
+				wakeSteps--;
+		}
+		_lodSubstep++;
+	}
+
+	//One pass over the manifolds, then the sorted pairs get merged with the ones of the last substep -> new, persisting and ended pairs
+	void collectContactEvents()
+	{
+		if (_interestedBodies == 0)
+		{
+			_touchingPairs.clear();
+			return;
+		}
+
+		_contactPairs.clear();
+		int manifolds = _dispatcher->getNumManifolds();
+		for (int i = 0; i < manifolds; i++)
+		{
+			const btPersistentManifold* manifold = _dispatcher->getManifoldByIndexInternal(i);
+			int contacts = manifold->getNumContacts();
+			if (contacts == 0)
+				continue;
+
+			unsigned int a = (unsigned int)manifold->getBody0()->getUserIndex();
+			unsigned int b = (unsigned int)manifold->getBody1()->getUserIndex();
+			if (!(_contactInterest[a] | _contactInterest[b]))
+				continue;
+
+			ContactPair pair;
+			pair._impulse = 0.0f;
+			float maxImpulse = -1.0f;
+			btScalar distance = 0.0f;
+			for (int j = 0; j < contacts; j++)
+			{
+				const btManifoldPoint& point = manifold->getContactPoint(j);
+				pair._impulse += (float)point.getAppliedImpulse();
+				if (point.getAppliedImpulse() > maxImpulse)
+				{
+					maxImpulse = (float)point.getAppliedImpulse();
+					pair._point = point.getPositionWorldOnB();
+					pair._normal = point.m_normalWorldOnB;
+					distance = point.getDistance();
+				}
+			}
+
+			//Normal and point always belong to the body with the bigger index
+			if (a > b)
+			{
+				std::swap(a, b);
+				pair._point += pair._normal * distance;
+				pair._normal = -pair._normal;
+			}
+
+			pair._key = ((uint64_t)a << 32) | b;
+			_contactPairs.push_back(pair);
+		}
+
+		std::sort(_contactPairs.begin(), _contactPairs.end(), [](const ContactPair& l, const ContactPair& r) { return l._key < r._key; });
+
+		_previousTouchingPairs.swap(_touchingPairs);
+		_touchingPairs.clear();
+
+		size_t previous = 0;
+		for (const ContactPair& pair : _contactPairs)
+		{
+			//Compound shapes can have several manifolds per pair -> the first one counts
+			if (!_touchingPairs.empty() && _touchingPairs.back() == pair._key)
+				continue;
+			_touchingPairs.push_back(pair._key);
+
+			while (previous < _previousTouchingPairs.size() && _previousTouchingPairs[previous] < pair._key)
+				addEndedContact(_previousTouchingPairs[previous++]);
+
+			bool persisting = previous < _previousTouchingPairs.size() && _previousTouchingPairs[previous] == pair._key;
+			if (persisting)
+				previous++;
+
+			unsigned int a = (unsigned int)(pair._key >> 32), b = (unsigned int)pair._key;
+			ContactEventType type = persisting ? CONTACT_PERSISTING : CONTACT_NEW;
+			if (((_contactInterest[a] | _contactInterest[b]) & type) && pair._impulse >= _minContactImpulse)
+			{
+				_contactEvents.add(type, a, b, pair._impulse,
+					glm::vec3((float)pair._point.x(), (float)pair._point.y(), (float)pair._point.z()),
+					glm::vec3((float)pair._normal.x(), (float)pair._normal.y(), (float)pair._normal.z()));
+			}
+		}
+
+		while (previous < _previousTouchingPairs.size())
+			addEndedContact(_previousTouchingPairs[previous++]);
+	}
+
+	void addEndedContact(uint64_t key)
+	{
+		unsigned int a = (unsigned int)(key >> 32), b = (unsigned int)key;
+		if ((_contactInterest[a] | _contactInterest[b]) & CONTACT_ENDED)
+			_contactEvents.add(CONTACT_ENDED, a, b, 0.0f, glm::vec3(0.0f), glm::vec3(0.0f));
+	}
+
+	template<typename T>
+	static void writeValue(std::ostream& stream, const T& value)
+	{
+		stream.write((const char*)&value, sizeof(T));
+	}
+
+	template<typename T>
+	static void readValue(std::istream& stream, T& value)
+	{
+		stream.read((char*)&value, sizeof(T));
+	}
+
+	//Non thread-safe builds of LinearMath have no default task scheduler, a thread-safe build creates one (and its threads) that gets deleted again right away
+	static bool isBulletThreadSafe()
+	{
+		static const bool s_ThreadSafe = []()
+		{
+			btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+			delete scheduler;
+			return scheduler != nullptr;
+		}();
+		return s_ThreadSafe;
+	}
+
+	void init()
+	{
+		//The job system also runs the query batches and the CPU simulations of the Simulation (getJobSystem) -> it gets created even if Bullet has to stay single threaded
+		_jobSystem = new JobSystem(_threads - 1);
+
+		//The multithreaded world needs Bullet libraries built with BT_THREADSAFE (cmake option BULLET2_MULTITHREADING)
+		//The define in the project can't tell how the linked libraries were built -> ask them at runtime (thread-safe libraries need BT_THREADSAFE=1 in the preprocessor definitions as well, some header code depends on it)
+		if (_threads > 1 && !isBulletThreadSafe())
+		{
+			spdlog::warn("PhysicsEngine: Bullet is not built with BT_THREADSAFE, falling back to a single thread");
+			_threads = 1;
+		}
+
+		if (_threads > 1)
+		{
+			//The task scheduler has to be set before any of the Mt classes get created
+			_taskScheduler = new PhysicsTaskScheduler(_jobSystem);
+			btSetTaskScheduler(_taskScheduler);
+		}
+
+		createWorld();
+	}
+
+	btConstraintSolver* createSolver() const
+	{
+		if (_solverType == SOLVER_NNCG)
+			return new btNNCGConstraintSolver();
+
+		return new btSequentialImpulseConstraintSolver();
+	}
+
+	btBroadphaseInterface* createBroadphase() const
+	{
+		switch (_broadphaseType)
+		{
+			case BROADPHASE_AXIS_SWEEP:
+				return new btAxisSweep3(PHYSICS_WORLD_MIN, PHYSICS_WORLD_MAX, PHYSICS_AXIS_SWEEP_HANDLES);
+			case BROADPHASE_AXIS_SWEEP_32:
+				return new bt32BitAxisSweep3(PHYSICS_WORLD_MIN, PHYSICS_WORLD_MAX, PHYSICS_AXIS_SWEEP_32_HANDLES);
+			case BROADPHASE_SPATIAL_HASH:
+				return new SpatialHashBroadphase(PHYSICS_HASH_CELL_SIZE);
+			default:
+				return new btDbvtBroadphase();
+		}
+	}
+
+	void createWorld()
 	{
 		//Init physics
-		_broadphase = new btDbvtBroadphase();
-		_collisionConfiguration = new btDefaultCollisionConfiguration();
-		_dispatcher = new btCollisionDispatcher(_collisionConfiguration);
-		_solver = new btSequentialImpulseConstraintSolver();
-		_dynamicsWorld = new btDiscreteDynamicsWorld(_dispatcher, _broadphase, _solver, _collisionConfiguration);
+		_broadphase = new TimedBroadphase(createBroadphase());
 
-		//Configure settings
-		_dynamicsWorld->setGravity(btVector3(0.0f, -9.8f, 0.0f));
+		if (_threads > 1)
+		{
+			//Bigger pools, stress scenes have a lot more contacts than the default pool size of 4096
+			btDefaultCollisionConstructionInfo constructionInfo;
+			constructionInfo.m_defaultMaxPersistentManifoldPoolSize = 32768;
+			constructionInfo.m_defaultMaxCollisionAlgorithmPoolSize = 32768;
+			_collisionConfiguration = new btDefaultCollisionConfiguration(constructionInfo);
+			_dispatcher = new btCollisionDispatcherMt(_collisionConfiguration);
+
+			//Islands get solved in parallel by the solver pool (one solver per thread, the pool deletes them), a single large island by the Mt solver
+			//There is no Mt variant of the NNCG solver -> its large islands get solved by one of the pool's solvers
+			int poolSize = _taskScheduler->getMaxNumThreads();
+			std::vector<btConstraintSolver*> solvers(poolSize);
+			for (int i = 0; i < poolSize; i++)
+				solvers[i] = createSolver();
+
+			_solverPool = new btConstraintSolverPoolMt(&solvers[0], poolSize);
+			if (_solverType == SOLVER_SEQUENTIAL_IMPULSE)
+				_solver = new btSequentialImpulseConstraintSolverMt();
+			_dynamicsWorld = new btDiscreteDynamicsWorldMt(_dispatcher, _broadphase, _solverPool, _solver, _collisionConfiguration);
+		}
+		else
+		{
+			_collisionConfiguration = new btDefaultCollisionConfiguration();
+			_dispatcher = new btCollisionDispatcher(_collisionConfiguration);
+			_solver = createSolver();
+			_dynamicsWorld = new btDiscreteDynamicsWorld(_dispatcher, _broadphase, _solver, _collisionConfiguration);
+		}
 
-		//Preconfigure sphere shape -> can be reused
-		_sphereShape = new btSphereShape(1.0f);
+		//Configure settings
+		_dynamicsWorld->setGravity(PHYSICS_GRAVITY);
+		_dynamicsWorld->setInternalTickCallback(&PhysicsEngine::onInternalPreTick, this, true);
+		_dynamicsWorld->setInternalTickCallback(&PhysicsEngine::onInternalTick, this);
+		_dynamicsWorld->setForceUpdateAllAabbs(!_lodEnabled); //Parked bodies don't move
 	}
 
-public:
-	PhysicsEngine() 
+	//Bodies have to leave the world before it gets destroyed
+	void destroyBodies()
 	{
-		init();
+		for (size_t i = 0; i < _physicBodies.size(); i++)
+		{
+			if (_physicBodies[i]->isInWorld())
+				_dynamicsWorld->removeRigidBody(_physicBodies[i]);
+
+			_bodyPool.destroy(_physicBodies[i]);
+			_motionStatePool.destroy(_motionStates[i]);
+		}
+
+		_physicBodies.clear();
+		_motionStates.clear();
+		_movedBodies.clear();
+		_freeBodies.clear();
+		_touchingPairs.clear();
+		_contactEvents.clear();
+		_lodLevels.clear();
+		_lodWakeSteps.clear();
+		_parkedStates.clear();
+		_reducedBodies.clear();
+		_steppingBodies.clear();
+		std::fill(_lodCounts, _lodCounts + LOD_LEVEL_COUNT, 0u);
+		_parkedCount = 0;
 	}
 
-	~PhysicsEngine()
+	void destroyWorld()
 	{
-		delete _broadphase;
-		delete _collisionConfiguration;
-		delete _dispatcher;
-		delete _solver;
 		delete _dynamicsWorld;
-		delete _boxShape;
-		delete _sphereShape;
+		delete _solverPool;
+		delete _solver;
+		delete _dispatcher;
+		delete _collisionConfiguration;
+		delete _broadphase;
 
-		for (auto const& body : _physicBodies)
-			delete body.second;
+		_dynamicsWorld = nullptr;
+		_solverPool = nullptr;
+		_solver = nullptr;
+		_dispatcher = nullptr;
+		_collisionConfiguration = nullptr;
+		_broadphase = nullptr;
 	}
-	
-	unsigned int addSphere(const glm::vec3& position, const btScalar& mass, const float& restitution, const float& friction)
+
+	btCollisionShape* getShape(ShapeType type, const glm::vec3& dimensions)
 	{
-		//Create shape
-		btDefaultMotionState* sphereMotionState = new btDefaultMotionState(btTransform(btQuaternion(0, 0, 0, 1), btVector3(position.x, position.y, position.z)));
-		btVector3 sphereInertia(0, 0, 0);
-		_sphereShape->calculateLocalInertia(mass, sphereInertia);
+		ShapeKey key = { type, dimensions.x, dimensions.y, dimensions.z };
 
-		//Create rigid body
-		btRigidBody::btRigidBodyConstructionInfo sphereRigidBodyCI(mass, sphereMotionState, _sphereShape, sphereInertia);
-		btRigidBody* sphereRigidBody = new btRigidBody(sphereRigidBodyCI);
-		
-		//Configure rigid body
-		sphereRigidBody->setRestitution(restitution);
-		sphereRigidBody->setFriction(friction);
+		auto cached = _shapes.find(key);
+		if (cached != _shapes.end())
+			return cached->second;
 
-		//Add rigid body to physics simulation
-		_dynamicsWorld->addRigidBody(sphereRigidBody);
+		btCollisionShape* shape = nullptr;
+		if (type == SHAPE_SPHERE)
+			shape = new btSphereShape(dimensions.x);
+		else
+			shape = new btBoxShape(btVector3(dimensions.x, dimensions.y, dimensions.z));
+
+		_shapes[key] = shape;
+		return shape;
+	}
 
-		//Add rigid body to container to keep track of it
-		unsigned int currentIndex = PHYSIC_BODY_INDEX;
-		_physicBodies[PHYSIC_BODY_INDEX] = sphereRigidBody;
-		PHYSIC_BODY_INDEX++;
+	unsigned int addBody(btCollisionShape* shape, const glm::vec3& position, const btScalar& mass, const float& restitution, const float& friction, bool isStatic)
+	{
+		//Reuse a slot of a removed body if there is one
+		if (!_freeBodies.empty())
+		{
+			unsigned int freeIndex = _freeBodies.back();
+			_freeBodies.pop_back();
+
+			btRigidBody* freeBody = _physicBodies[freeIndex];
+			if (freeBody->getCollisionShape() == shape && freeBody->getMass() == mass && freeBody->isStaticObject() == isStatic)
+			{
+				//Same kind of body -> just reset the pooled one
+				freeBody->setRestitution(restitution);
+				freeBody->setFriction(friction);
+				_dynamicsWorld->addRigidBody(freeBody);
+				respawnBody(freeIndex, position); //Also invalidates the static queries if needed
+				return freeIndex;
+			}
+
+			//Different kind of body -> the slot gets a new body
+			_bodyPool.destroy(freeBody);
+			_motionStatePool.destroy(_motionStates[freeIndex]);
+			createBody(freeIndex, shape, position, mass, restitution, friction, isStatic);
+			return freeIndex;
+		}
 
+		unsigned int currentIndex = (unsigned int)_physicBodies.size();
+		_physicBodies.push_back(nullptr);
+		_motionStates.push_back(nullptr);
+		_contactInterest.push_back(0);
+		createBody(currentIndex, shape, position, mass, restitution, friction, isStatic);
 		return currentIndex;
 	}
 
-	unsigned int addBox(const glm::vec3& position, const glm::vec3& size, const btScalar& mass, const float& restitution, const float& friction) 
+	void createBody(unsigned int index, btCollisionShape* shape, const glm::vec3& position, const btScalar& mass, const float& restitution, const float& friction, bool isStatic)
 	{
-		//Create shape
-		_boxShape = new btBoxShape(btVector3(size.x, size.y, size.z));
-		btDefaultMotionState* boxMotionState = new btDefaultMotionState(btTransform(btQuaternion(0, 0, 0, 1), btVector3(position.x, position.y, position.z)));		
+		//Create motion state
+		PhysicsMotionState* motionState = _motionStatePool.create(btTransform(btQuaternion(0, 0, 0, 1), btVector3(position.x, position.y, position.z)), index, &_movedBodies);
+		btVector3 inertia(0, 0, 0);
+		if (!isStatic)
+			shape->calculateLocalInertia(mass, inertia);
 
 		//Create rigid body
-		btRigidBody::btRigidBodyConstructionInfo boxRigidBodyCI(mass, boxMotionState, _boxShape, btVector3(0, 0, 0));
-		btRigidBody* boxRigidBody = new btRigidBody(boxRigidBodyCI);
+		btRigidBody::btRigidBodyConstructionInfo rigidBodyCI(mass, motionState, shape, inertia);
+		btRigidBody* rigidBody = _bodyPool.create(rigidBodyCI);
 
-		//Configure rigid body
-		boxRigidBody->setRestitution(restitution);
-		boxRigidBody->setFriction(friction);
-		boxRigidBody->setCollisionFlags(btCollisionObject::CF_STATIC_OBJECT);
+		//Configure rigid body (the user index leads queries back to the body)
+		rigidBody->setRestitution(restitution);
+		rigidBody->setFriction(friction);
+		rigidBody->setUserIndex((int)index);
+		if (isStatic)
+		{
+			rigidBody->setCollisionFlags(btCollisionObject::CF_STATIC_OBJECT);
+			_staticGeneration++;
+		}
 
 		//Add rigid body to physics simulation
-		_dynamicsWorld->addRigidBody(boxRigidBody);
+		_dynamicsWorld->addRigidBody(rigidBody);
 
-		//Add rigid body to container to keep track of it
-		unsigned int currentIndex = PHYSIC_BODY_INDEX;
-		_physicBodies[PHYSIC_BODY_INDEX] = boxRigidBody;
-		PHYSIC_BODY_INDEX++;
+		//Keep track of it, the index is the position in the dense arrays
+		_physicBodies[index] = rigidBody;
+		_motionStates[index] = motionState;
+	}
 
-		return currentIndex;
+public:
+	//threads = 1 builds the plain single threaded world, more threads build the multithreaded world on top of the job system
+	PhysicsEngine(unsigned int threads = 1, PhysicsSolver solver = SOLVER_SEQUENTIAL_IMPULSE, PhysicsBroadphase broadphase = BROADPHASE_DBVT)
+		: _solverType(solver), _broadphaseType(broadphase), _threads(threads > 0 ? threads : 1)
+	{
+		init();
 	}
 
-	glm::mat4 getWorldTransform(const unsigned int& physicIndex) 
+	~PhysicsEngine()
 	{
-		btTransform t;
-		_physicBodies[physicIndex]->getMotionState()->getWorldTransform(t);
-		glm::vec3 pos = glm::vec3(t.getOrigin().getX(), t.getOrigin().getY(), t.getOrigin().getZ());
-		
-		//Reset object if it's far below the surface
-		if (pos.y < -10.0f) 
+		destroyBodies();
+		destroyWorld();
+
+		for (auto const& shape : _shapes)
+			delete shape.second;
+
+		if (_taskScheduler)
 		{
-			glm::vec3 new_pos = glm::vec3(random::Float() * 200.0f, random::Float() * 50.0f, random::Float() * 200.0f);
-			_physicBodies[physicIndex]->clearForces();
-			_physicBodies[physicIndex]->setMotionState(new btDefaultMotionState(btTransform(btQuaternion(0, 0, 0, 1), btVector3(new_pos.x, new_pos.y, new_pos.z))));			
-			return glm::translate(glm::mat4(1.0f), new_pos);
-		}			
-		else 
+			btSetTaskScheduler(btGetSequentialTaskScheduler());
+			delete _taskScheduler;
+
+			//Bullet hands out thread indices only once per thread -> the next job system's workers start at 1 again
+			btResetThreadIndexCounter();
+		}
+		delete _jobSystem;
+	}
+
+	//Preallocate pool memory for the expected amount of bodies
+	void reserve(unsigned int bodies)
+	{
+		_bodyPool.reserve(bodies);
+		_motionStatePool.reserve(bodies);
+		_physicBodies.reserve(bodies);
+		_motionStates.reserve(bodies);
+		_movedBodies.reserve(bodies);
+		_freeBodies.reserve(bodies);
+		_contactInterest.reserve(bodies);
+	}
+
+	unsigned int addSphere(const glm::vec3& position, const btScalar& mass, const float& restitution, const float& friction, const float& radius = 1.0f)
+	{
+		return addBody(getShape(SHAPE_SPHERE, glm::vec3(radius, 0.0f, 0.0f)), position, mass, restitution, friction, false);
+	}
+
+	unsigned int addBox(const glm::vec3& position, const glm::vec3& size, const btScalar& mass, const float& restitution, const float& friction)
+	{
+		return addBody(getShape(SHAPE_BOX, size), position, mass, restitution, friction, true);
+	}
+
+	//Puts the body back to the given position and clears its whole state (no allocations -> the pooled objects get reset)
+	void respawnBody(const unsigned int& physicIndex, const glm::vec3& position)
+	{
+		btRigidBody* body = _physicBodies[physicIndex];
+		btTransform transform(btQuaternion(0, 0, 0, 1), btVector3(position.x, position.y, position.z));
+
+		body->setWorldTransform(transform);
+		body->setInterpolationWorldTransform(transform);
+		body->setLinearVelocity(btVector3(0, 0, 0));
+		body->setAngularVelocity(btVector3(0, 0, 0));
+		body->setInterpolationLinearVelocity(btVector3(0, 0, 0));
+		body->setInterpolationAngularVelocity(btVector3(0, 0, 0));
+		body->clearForces();
+		resetLod(physicIndex);
+		body->activate(true);
+
+		if (body->isStaticObject())
+			_staticGeneration++;
+
+		_motionStates[physicIndex]->setWorldTransform(transform);
+	}
+
+	glm::mat4 getWorldTransform(const unsigned int& physicIndex) const
+	{
+		glm::mat4 model;
+		writeMatrix(_motionStates[physicIndex]->_transform, &model[0][0]);
+		return model;
+	}
+
+	//Converts a Bullet transform straight into a column-major 4x4 matrix (basis rows get transposed into the first three columns, origin becomes the last one)
+	static void writeMatrix(const btTransform& t, float* out)
+	{
+		#ifndef BT_USE_DOUBLE_PRECISION
+			const btMatrix3x3& basis = t.getBasis();
+			__m128 c0 = _mm_loadu_ps(basis[0].m_floats);
+			__m128 c1 = _mm_loadu_ps(basis[1].m_floats);
+			__m128 c2 = _mm_loadu_ps(basis[2].m_floats);
+			__m128 c3 = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+			_MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+			//After the transpose the w of the first three columns is 0, the last column gets replaced by the origin
+			const btVector3& origin = t.getOrigin();
+			c3 = _mm_set_ps(1.0f, origin.m_floats[2], origin.m_floats[1], origin.m_floats[0]);
+
+			_mm_storeu_ps(out + 0, c0);
+			_mm_storeu_ps(out + 4, c1);
+			_mm_storeu_ps(out + 8, c2);
+			_mm_storeu_ps(out + 12, c3);
+		#else
+			btScalar m[16];
+			t.getOpenGLMatrix(m);
+			for (int i = 0; i < 16; i++)
+				out[i] = (float)m[i];
+		#endif
+	}
+
+	//Packs a Bullet transform into the compact instance format (the basis becomes a quaternion, no matrix gets built)
+	static void writeInstanceTransform(const btTransform& t, float scale, InstanceTransform& out)
+	{
+		btQuaternion rotation;
+		t.getBasis().getRotation(rotation);
+
+		const btVector3& origin = t.getOrigin();
+		out._position = glm::vec3((float)origin.x(), (float)origin.y(), (float)origin.z());
+		out._scale = scale;
+		out.setRotation((float)rotation.x(), (float)rotation.y(), (float)rotation.z(), (float)rotation.w());
+	}
+
+	//The body's transform gets written to this slot of the instance buffer on syncTransforms (-1 = not rendered instanced)
+	void setInstanceSlot(const unsigned int& physicIndex, int slot)
+	{
+		_motionStates[physicIndex]->_instanceSlot = slot;
+		_motionStates[physicIndex]->markMoved(); //The new slot doesn't contain the matrix yet
+	}
+
+	bool hasMovedBodies() const
+	{
+		return !_movedBodies.empty();
+	}
+
+	//Bulk transform sync: walks only the bodies that moved since the last sync and writes their compact transforms in place into the instance buffer
+	//The written slots get marked in dirtySlots (if given) so only those ranges have to be uploaded
+	unsigned int syncTransforms(InstanceTransform* instanceBuffer, DirtyRanges* dirtySlots = nullptr)
+	{
+		unsigned int written = 0;
+
+		for (unsigned int bodyIndex : _movedBodies)
 		{
-			glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), t.getRotation().getAngle(), glm::vec3(t.getRotation().getAxis().getX(), t.getRotation().getAxis().getY(), t.getRotation().getAxis().getZ()));
-			glm::mat4 translation = glm::translate(glm::mat4(1.0f), pos);
-			return translation * rotation;
-		}		
+			PhysicsMotionState* motionState = _motionStates[bodyIndex];
+			motionState->_moved = false;
+
+			if (motionState->_instanceSlot >= 0)
+			{
+				//Uniform scale -> the x component of the shape's scaling is enough
+				//Spheres get drawn with a unit mesh/impostor -> their scale is the radius (btSphereShape::getRadius includes the scaling already)
+				const btCollisionShape* shape = _physicBodies[bodyIndex]->getCollisionShape();
+				float scale = shape->getShapeType() == SPHERE_SHAPE_PROXYTYPE ? (float)static_cast<const btSphereShape*>(shape)->getRadius() : (float)shape->getLocalScaling().x();
+				writeInstanceTransform(motionState->_transform, scale, instanceBuffer[motionState->_instanceSlot]);
+				written++;
+
+				if (dirtySlots)
+					dirtySlots->mark((unsigned int)motionState->_instanceSlot);
+			}
+		}
+
+		_movedBodies.clear();
+		return written;
 	}
 
 	void removeFromSimulation(const unsigned int& physicIndex)
 	{
+		resetLod(physicIndex);
 		_dynamicsWorld->removeRigidBody(_physicBodies[physicIndex]);
+
+		if (_physicBodies[physicIndex]->isStaticObject())
+			_staticGeneration++;
+	}
+
+	//Takes the body out of the simulation and frees its slot for the next added body (the index must not be used afterwards)
+	void removeBody(const unsigned int& physicIndex)
+	{
+		resetLod(physicIndex);
+		if (_physicBodies[physicIndex]->isInWorld())
+			_dynamicsWorld->removeRigidBody(_physicBodies[physicIndex]);
+
+		_motionStates[physicIndex]->_instanceSlot = -1;
+		_freeBodies.push_back(physicIndex);
+		setContactInterest(physicIndex, 0); //The next body in this slot starts without interest
+
+		if (_physicBodies[physicIndex]->isStaticObject())
+			_staticGeneration++;
 	}
 
-	void simulate(const float& dt) const
+	void simulate(const float& dt)
 	{
+		_broadphase->resetTime();
+		_contactEvents.clear();
+		auto start = std::chrono::high_resolution_clock::now();
 		_dynamicsWorld->stepSimulation(dt);
+		_lastStepTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+		_lastBroadphaseTime = _broadphase->getTime();
+
+		//Running average per mode -> the overlay can compare the step time with and without level of detail
+		float& average = _lodStepTimes[_lodEnabled];
+		average = _lodStepMeasured[_lodEnabled] ? average * 0.95f + _lastStepTime * 0.05f : _lastStepTime;
+		_lodStepMeasured[_lodEnabled] = true;
+
+		//Reset objects that fell far below the surface (only moved bodies can have fallen)
+		size_t movedCount = _movedBodies.size();
+		for (size_t i = 0; i < movedCount; i++)
+		{
+			unsigned int bodyIndex = _movedBodies[i];
+			if (_motionStates[bodyIndex]->_transform.getOrigin().getY() < -10.0f && _physicBodies[bodyIndex]->isInWorld())
+				respawnBody(bodyIndex, glm::vec3(_random.Float() * 200.0f, _random.Float() * 50.0f, _random.Float() * 200.0f));
+		}
+	}
+
+	//Bodies in the simulation (without removed ones)
+	unsigned int getBodyCount() const
+	{
+		return (unsigned int)(_physicBodies.size() - _freeBodies.size());
+	}
+
+	//Threads of the Bullet world (1 if Bullet had to fall back to a single thread)
+	unsigned int getThreadCount() const
+	{
+		return _threads;
+	}
+
+	//Pool with all threads the engine got created with, for other CPU work between the steps
+	JobSystem& getJobSystem()
+	{
+		return *_jobSystem;
+	}
+
+	//---------------------------Level of detail---------------------------//
+
+	void setLodEnabled(bool enabled)
+	{
+		if (enabled == _lodEnabled)
+			return;
+
+		_lodEnabled = enabled;
+		_dynamicsWorld->setForceUpdateAllAabbs(!enabled);
+
+		if (!enabled)
+		{
+			for (unsigned int i = 0; i < (unsigned int)_lodLevels.size(); i++)
+				resetLod(i);
+			_reducedBodies.clear();
+			std::fill(_lodCounts, _lodCounts + LOD_LEVEL_COUNT, 0u);
+		}
+	}
+
+	bool isLodEnabled() const
+	{
+		return _lodEnabled;
+	}
+
+	void setLodSettings(const PhysicsLodSettings& settings)
+	{
+		_lodSettings = settings;
+	}
+
+	//Sorts every dynamic body into a level by its distance to the viewer and whether it's inside the view (call before simulate)
+	//Bodies that got woken up by a contact stay at full rate for _wakeSteps substeps
+	void updateLod(const glm::vec3& viewer, const glm::mat4& viewProjection)
+	{
+		if (!_lodEnabled)
+			return;
+
+		size_t bodyCount = _physicBodies.size();
+		_lodLevels.resize(bodyCount, LOD_FULL);
+		_lodWakeSteps.resize(bodyCount, 0);
+		_parkedStates.resize(bodyCount, -1);
+
+		Frustum frustum(viewProjection);
+		float reducedDistance2 = _lodSettings._reducedDistance * _lodSettings._reducedDistance;
+		float frozenDistance2 = _lodSettings._frozenDistance * _lodSettings._frozenDistance;
+		_reducedBodies.clear();
+		std::fill(_lodCounts, _lodCounts + LOD_LEVEL_COUNT, 0u);
+
+		for (unsigned int i = 0; i < (unsigned int)bodyCount; i++)
+		{
+			const btRigidBody* body = _physicBodies[i];
+			if (body->isStaticObject() || !body->isInWorld())
+				continue;
+
+			const btVector3& origin = _motionStates[i]->_transform.getOrigin();
+			glm::vec3 center((float)origin.x(), (float)origin.y(), (float)origin.z());
+			glm::vec3 offset = center - viewer;
+			float distance2 = glm::dot(offset, offset);
+
+			PhysicsLodLevel level = LOD_FULL;
+			if (_lodWakeSteps[i] > 0)
+				level = LOD_FULL;
+			else if (distance2 >= frozenDistance2)
+				level = LOD_FROZEN;
+			else if (distance2 >= reducedDistance2 || !frustum.intersectsSphere(center, (float)body->getCollisionShape()->getAngularMotionDisc()))
+				level = LOD_REDUCED;
+
+			setLodLevel(i, level);
+			if (level == LOD_REDUCED)
+				_reducedBodies.push_back(i);
+		}
+	}
+
+	//Dynamic bodies per level after the last updateLod (contact wake-ups move bodies to full right away)
+	unsigned int getLodCount(PhysicsLodLevel level) const
+	{
+		return _lodCounts[level];
+	}
+
+	//Average step time in ms with or without level of detail, 0 if there is no measurement yet
+	float getAverageStepTime(bool withLod) const
+	{
+		return _lodStepMeasured[withLod] ? _lodStepTimes[withLod] : 0.0f;
+	}
+
+	//---------------------------Queries---------------------------//
+	//All queries have to run between steps, the results go into arrays of the caller (one entry per query)
+
+	//Closest hit of every ray
+	void raycast(const RayQuery* queries, QueryHit* hits, unsigned int count, int mask = QUERY_ALL)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		int filter = getQueryFilter(mask);
+		runCachedQueries(queries, hits, count, mask, _rayCache, [this, filter](const RayQuery& query, QueryHit& hit) { runCast(query._from, query._to, 0.0f, filter, hit); }, canCastInParallel());
+		_lastQueryTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	//Closest hit of every moving sphere
+	void sweepSpheres(const SweepQuery* queries, QueryHit* hits, unsigned int count, int mask = QUERY_ALL)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		int filter = getQueryFilter(mask);
+		runCachedQueries(queries, hits, count, mask, _sweepCache, [this, filter](const SweepQuery& query, QueryHit& hit) { runCast(query._from, query._to, query._radius, filter, hit); }, canCastInParallel());
+		_lastQueryTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	//Bodies touching every sphere -> query i writes at most capacityPerQuery body indices to bodies[i * capacityPerQuery]
+	void overlapSpheres(const OverlapQuery* queries, OverlapResult* results, unsigned int count, unsigned int* bodies, unsigned int capacityPerQuery, int mask = QUERY_ALL)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		int filter = getQueryFilter(mask);
+		btBroadphaseInterface* broadphase = _broadphase;
+
+		forEachQuery(count, [&](unsigned int i)
+		{
+			OverlapCallback callback;
+			callback._center = btVector3(queries[i]._center.x, queries[i]._center.y, queries[i]._center.z);
+			callback._radius = queries[i]._radius;
+			callback._filter = filter;
+			callback._bodies = bodies + (size_t)i * capacityPerQuery;
+			callback._capacity = capacityPerQuery;
+
+			btVector3 extent(queries[i]._radius, queries[i]._radius, queries[i]._radius);
+			broadphase->aabbTest(callback._center - extent, callback._center + extent, callback);
+			results[i] = callback._result;
+		});
+
+		_lastQueryTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	//Duration of the last query batch in ms
+	float getLastQueryTime() const
+	{
+		return _lastQueryTime;
+	}
+
+	//---------------------------Contact events---------------------------//
+	//Pairs get reported if one of the bodies is interested in the event type, new and persisting ones also need at least the minimum impulse
+	//Interest flags stay with the body index (also over snapshot loads), a removed body loses them
+
+	void setContactInterest(const unsigned int& physicIndex, int flags)
+	{
+		uint8_t& interest = _contactInterest[physicIndex];
+		if (interest && !flags)
+			_interestedBodies--;
+		else if (!interest && flags)
+			_interestedBodies++;
+
+		interest = (uint8_t)flags;
+	}
+
+	void setMinContactImpulse(float impulse)
+	{
+		_minContactImpulse = impulse;
+	}
+
+	//Events of the last simulate call (empty if no substep ran)
+	const ContactEvents& getContactEvents() const
+	{
+		return _contactEvents;
+	}
+
+	//Pairs the broadphase found in the last step (bounding boxes overlap)
+	unsigned int getOverlappingPairCount() const
+	{
+		return (unsigned int)_broadphase->getOverlappingPairCache()->getNumOverlappingPairs();
+	}
+
+	//Pairs the narrowphase kept in the last step (manifolds with at least one contact point) and their contact points
+	unsigned int getContactPairCount(unsigned int* contactPoints = nullptr) const
+	{
+		unsigned int pairs = 0, points = 0;
+		int manifolds = _dispatcher->getNumManifolds();
+		for (int i = 0; i < manifolds; i++)
+		{
+			int contacts = _dispatcher->getManifoldByIndexInternal(i)->getNumContacts();
+			if (contacts > 0)
+			{
+				pairs++;
+				points += (unsigned int)contacts;
+			}
+		}
+
+		if (contactPoints)
+			*contactPoints = points;
+		return pairs;
+	}
+
+	void setSeed(uint32_t seed)
+	{
+		_random.seed(seed);
+	}
+
+	//Writes the whole simulation state (bodies with shapes, transforms, velocities and activation states, free slots, random generator) into a binary stream
+	void saveSnapshot(std::ostream& stream) const
+	{
+		//Shapes are stored by their cache key
+		std::map<const btCollisionShape*, ShapeKey> shapeKeys;
+		for (auto const& shape : _shapes)
+			shapeKeys[shape.second] = shape.first;
+
+		writeValue(stream, PHYSICS_SNAPSHOT_VERSION);
+		writeValue(stream, (uint32_t)_physicBodies.size());
+
+		for (size_t i = 0; i < _physicBodies.size(); i++)
+		{
+			const btRigidBody* body = _physicBodies[i];
+			const ShapeKey& shapeKey = shapeKeys[body->getCollisionShape()];
+
+			writeValue(stream, (uint32_t)shapeKey._type);
+			writeValue(stream, shapeKey._x);
+			writeValue(stream, shapeKey._y);
+			writeValue(stream, shapeKey._z);
+			writeValue(stream, body->getMass());
+			writeValue(stream, body->getRestitution());
+			writeValue(stream, body->getFriction());
+			writeValue(stream, (uint8_t)body->isStaticObject());
+			writeValue(stream, (uint8_t)body->isInWorld());
+			writeValue(stream, (int32_t)_motionStates[i]->_instanceSlot);
+			writeValue(stream, (int32_t)(isParked((unsigned int)i) ? _parkedStates[i] : body->getActivationState())); //Parking is not part of the snapshot
+			writeValue(stream, body->getDeactivationTime());
+
+			const btTransform& transform = body->getWorldTransform();
+			for (int row = 0; row < 3; row++)
+				writeValue(stream, transform.getBasis()[row]);
+			writeValue(stream, transform.getOrigin());
+			writeValue(stream, body->getLinearVelocity());
+			writeValue(stream, body->getAngularVelocity());
+		}
+
+		writeValue(stream, (uint32_t)_freeBodies.size());
+		for (unsigned int freeIndex : _freeBodies)
+			writeValue(stream, (uint32_t)freeIndex);
+
+		_random.save(stream);
+	}
+
+	//Reads and checks the physics part of a snapshot without touching the simulation -> a broken file can be rejected before anything gets destroyed
+	bool readSnapshot(std::istream& stream, PhysicsSnapshot& snapshot) const
+	{
+		uint32_t version = 0, bodyCount = 0;
+		readValue(stream, version);
+		readValue(stream, bodyCount);
+
+		if (!stream || version != PHYSICS_SNAPSHOT_VERSION)
+		{
+			spdlog::error("PhysicsEngine: Unsupported snapshot (version {})", version);
+			return false;
+		}
+
+		snapshot._bodies.clear();
+		snapshot._freeBodies.clear();
+		for (uint32_t i = 0; i < bodyCount; i++)
+		{
+			PhysicsSnapshot::Body body;
+			readValue(stream, body._shapeType);
+			readValue(stream, body._dimensions.x);
+			readValue(stream, body._dimensions.y);
+			readValue(stream, body._dimensions.z);
+			readValue(stream, body._mass);
+			readValue(stream, body._restitution);
+			readValue(stream, body._friction);
+			readValue(stream, body._isStatic);
+			readValue(stream, body._inWorld);
+			readValue(stream, body._instanceSlot);
+			readValue(stream, body._activationState);
+			readValue(stream, body._deactivationTime);
+			for (int row = 0; row < 3; row++)
+				readValue(stream, body._basis[row]);
+			readValue(stream, body._origin);
+			readValue(stream, body._linearVelocity);
+			readValue(stream, body._angularVelocity);
+
+			if (!stream)
+			{
+				spdlog::error("PhysicsEngine: Snapshot is truncated");
+				return false;
+			}
+
+			//The upper bound of the instance slot depends on the spawner part of the snapshot (ObjectManager::loadSnapshot)
+			if (body._shapeType > SHAPE_BOX || body._activationState < ACTIVE_TAG || body._activationState > DISABLE_SIMULATION || body._instanceSlot < -1)
+			{
+				spdlog::error("PhysicsEngine: Snapshot body {} is broken (shape {}, activation state {}, instance slot {})", i, body._shapeType, body._activationState, body._instanceSlot);
+				return false;
+			}
+			snapshot._bodies.push_back(body);
+		}
+
+		uint32_t freeCount = 0;
+		readValue(stream, freeCount);
+		for (uint32_t i = 0; i < freeCount && stream; i++)
+		{
+			uint32_t freeIndex = 0;
+			readValue(stream, freeIndex);
+			if (freeIndex >= bodyCount)
+			{
+				spdlog::error("PhysicsEngine: Snapshot frees body {} of {}", freeIndex, bodyCount);
+				return false;
+			}
+			snapshot._freeBodies.push_back(freeIndex);
+		}
+
+		snapshot._random.load(stream);
+		if (!stream)
+		{
+			spdlog::error("PhysicsEngine: Snapshot is truncated");
+			return false;
+		}
+		return true;
+	}
+
+	//Replaces the whole simulation with a snapshot from readSnapshot -> the world gets rebuilt from scratch and the bodies get added in their original order
+	//Contact manifolds and the solver's warm starting impulses are not part of the snapshot: every replay of a snapshot is identical (with one thread),
+	//but it is not bit-for-bit the run the snapshot was taken from, that one continued with the contacts it already had
+	void applySnapshot(const PhysicsSnapshot& snapshot)
+	{
+		if (_threads > 1)
+			spdlog::warn("PhysicsEngine: Replays are only bit-for-bit reproducible with a single physics thread");
+
+		const uint32_t bodyCount = (uint32_t)snapshot._bodies.size();
+
+		destroyBodies();
+		destroyWorld();
+		createWorld();
+		_staticGeneration++;
+		reserve(bodyCount);
+
+		for (uint32_t i = 0; i < bodyCount; i++)
+		{
+			const PhysicsSnapshot::Body& saved = snapshot._bodies[i];
+
+			_physicBodies.push_back(nullptr);
+			_motionStates.push_back(nullptr);
+			createBody(i, getShape((ShapeType)saved._shapeType, saved._dimensions), glm::vec3(0.0f), saved._mass, saved._restitution, saved._friction, saved._isStatic != 0);
+
+			btRigidBody* body = _physicBodies[i];
+			const btVector3* basis = saved._basis;
+			btTransform transform(btMatrix3x3(basis[0].x(), basis[0].y(), basis[0].z(), basis[1].x(), basis[1].y(), basis[1].z(), basis[2].x(), basis[2].y(), basis[2].z()), saved._origin);
+			body->setWorldTransform(transform);
+			body->setInterpolationWorldTransform(transform);
+			body->setLinearVelocity(saved._linearVelocity);
+			body->setAngularVelocity(saved._angularVelocity);
+			body->setInterpolationLinearVelocity(saved._linearVelocity);
+			body->setInterpolationAngularVelocity(saved._angularVelocity);
+			body->forceActivationState(saved._activationState);
+			body->setDeactivationTime(saved._deactivationTime);
+			_dynamicsWorld->updateSingleAabb(body); //Sleeping bodies wouldn't update their box on their own
+
+			//The motion state is already marked as moved -> the next sync writes the restored transform
+			_motionStates[i]->_transform = transform;
+			_motionStates[i]->_instanceSlot = saved._instanceSlot;
+
+			if (!saved._inWorld)
+				_dynamicsWorld->removeRigidBody(body);
+		}
+
+		//Interest flags stay with the body index -> only the ones of bodies that don't exist anymore get dropped
+		for (size_t i = bodyCount; i < _contactInterest.size(); i++)
+			setContactInterest((unsigned int)i, 0);
+		_contactInterest.resize(bodyCount, 0);
+
+		for (uint32_t freeIndex : snapshot._freeBodies)
+		{
+			_freeBodies.push_back(freeIndex);
+			setContactInterest(freeIndex, 0);
+		}
+
+		_random = snapshot._random;
+	}
+
+	//readSnapshot + applySnapshot, the simulation stays as it is if the snapshot is broken
+	bool loadSnapshot(std::istream& stream)
+	{
+		PhysicsSnapshot snapshot;
+		if (!readSnapshot(stream, snapshot))
+			return false;
+
+		applySnapshot(snapshot);
+		return true;
+	}
+
+	//Linear and rotational kinetic energy of all dynamic bodies in the simulation, their summed mass goes to totalMass (if given)
+	double computeKineticEnergy(double* totalMass = nullptr) const
+	{
+		double energy = 0.0, mass = 0.0;
+		for (const btRigidBody* body : _physicBodies)
+		{
+			if (body->isStaticOrKinematicObject() || !body->isInWorld() || body->getInvMass() == 0.0f)
+				continue;
+
+			double bodyMass = 1.0 / body->getInvMass();
+			btVector3 localAngular = body->getAngularVelocity() * body->getWorldTransform().getBasis(); //Rotated into body space, where the inertia is diagonal
+			energy += 0.5 * bodyMass * body->getLinearVelocity().length2();
+			energy += 0.5 * localAngular.dot(localAngular * body->getLocalInertia());
+			mass += bodyMass;
+		}
+
+		if (totalMass)
+			*totalMass = mass;
+		return energy;
+	}
+
+	//Dynamic bodies in the simulation that sleep or move slower than maxSpeed (m/s), all dynamic bodies in the simulation go to bodies (if given)
+	unsigned int countRestingBodies(float maxSpeed, unsigned int* bodies = nullptr) const
+	{
+		unsigned int resting = 0, dynamic = 0;
+		for (const btRigidBody* body : _physicBodies)
+		{
+			if (body->isStaticOrKinematicObject() || !body->isInWorld())
+				continue;
+
+			dynamic++;
+			if (body->getActivationState() == ISLAND_SLEEPING || body->getLinearVelocity().length2() < maxSpeed * maxSpeed)
+				resting++;
+		}
+
+		if (bodies)
+			*bodies = dynamic;
+		return resting;
+	}
+
+	//FNV-1a hash over the transforms and velocities of all bodies -> equal hashes after the same number of steps mean the runs were identical
+	uint64_t computeStateHash() const
+	{
+		uint64_t hash = 14695981039346656037ull;
+		auto hashBytes = [&hash](const void* data, size_t size)
+		{
+			const unsigned char* bytes = (const unsigned char*)data;
+			for (size_t i = 0; i < size; i++)
+				hash = (hash ^ bytes[i]) * 1099511628211ull;
+		};
+
+		for (const btRigidBody* body : _physicBodies)
+		{
+			const btTransform& transform = body->getWorldTransform();
+			for (int row = 0; row < 3; row++)
+				hashBytes(transform.getBasis()[row].m_floats, 3 * sizeof(btScalar));
+			hashBytes(transform.getOrigin().m_floats, 3 * sizeof(btScalar));
+			hashBytes(body->getLinearVelocity().m_floats, 3 * sizeof(btScalar));
+			hashBytes(body->getAngularVelocity().m_floats, 3 * sizeof(btScalar));
+		}
+
+		return hash;
+	}
+
+	//Duration of the last stepSimulation call in milliseconds
+	float getLastStepTime() const
+	{
+		return _lastStepTime;
+	}
+
+	//Part of the last simulate call the broadphase spent on finding pairs in ms
+	float getLastBroadphaseTime() const
+	{
+		return _lastBroadphaseTime;
 	}
 };
\ No newline at end of file
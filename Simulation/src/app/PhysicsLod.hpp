@@ -0,0 +1,21 @@
+#pragma once
+
+//How often a body gets simulated
+enum PhysicsLodLevel
+{
+	LOD_FULL, //Every step
+	LOD_REDUCED, //Every _reducedInterval steps with a correspondingly bigger time step
+	LOD_FROZEN, //Not at all until it leaves the distance again or something touches it
+	LOD_LEVEL_COUNT
+};
+
+const char* const PHYSICS_LOD_NAMES[] = { "full", "reduced", "frozen" };
+
+//Distances are measured from the viewer to the body's center
+struct PhysicsLodSettings
+{
+	float _reducedDistance = 60.0f; //Bodies further away (or outside of the view) get reduced
+	float _frozenDistance = 150.0f; //Bodies further away get frozen
+	unsigned int _reducedInterval = 3; //Reduced bodies take one step every this many steps
+	unsigned int _wakeSteps = 60; //A body that got touched by a fully simulated one stays at full rate for this many steps
+};
\ No newline at end of file
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+
+//What a query can hit
+enum PhysicsQueryMask
+{
+	QUERY_DYNAMIC = 1,
+	QUERY_STATIC = 2, //Queries that only hit static bodies get cached
+	QUERY_ALL = QUERY_DYNAMIC | QUERY_STATIC
+};
+
+struct RayQuery
+{
+	glm::vec3 _from, _to;
+};
+
+//Sphere moved from _from to _to
+struct SweepQuery
+{
+	glm::vec3 _from, _to;
+	float _radius;
+};
+
+//All bodies that touch the sphere
+struct OverlapQuery
+{
+	glm::vec3 _center;
+	float _radius;
+};
+
+//Closest hit of a ray or sweep
+struct QueryHit
+{
+	int _bodyIndex; //-1 = nothing got hit
+	float _fraction; //Position of the hit between from (0) and to (1)
+	glm::vec3 _point, _normal;
+};
+
+struct OverlapResult
+{
+	unsigned int _count; //Body indices written to the query's part of the output array
+	unsigned int _found; //All touching bodies (more than _count if the part was too small)
+};
+
+//Results of queries against the static bodies -> they stay valid until a static body gets added, moved or removed
+template<typename Query>
+class StaticQueryCache
+{
+private:
+	struct Entry
+	{
+		Query _query;
+		QueryHit _hit;
+	};
+
+	std::unordered_map<uint64_t, Entry> _entries;
+	uint32_t _generation = 0;
+	size_t _capacity;
+
+	//FNV-1a over the bytes of the query (the query structs have no padding)
+	static uint64_t hash(const Query& query)
+	{
+		const unsigned char* bytes = (const unsigned char*)&query;
+		uint64_t hash = 0xCBF29CE484222325ull;
+		for (size_t i = 0; i < sizeof(Query); i++)
+			hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+		return hash;
+	}
+
+public:
+	StaticQueryCache(size_t capacity = 65536)
+		: _capacity(capacity)
+	{
+
+	}
+
+	//Drops all results if the static world changed since they got stored
+	void validate(uint32_t generation)
+	{
+		if (generation != _generation)
+		{
+			_entries.clear();
+			_generation = generation;
+		}
+	}
+
+	//Only reads -> can be called from several threads at once as long as nobody stores
+	bool find(const Query& query, QueryHit& hit) const
+	{
+		auto it = _entries.find(hash(query));
+		if (it == _entries.end() || std::memcmp(&it->second._query, &query, sizeof(Query)) != 0)
+			return false;
+
+		hit = it->second._hit;
+		return true;
+	}
+
+	void store(const Query& query, const QueryHit& hit)
+	{
+		//Simple bound on the memory -> start over when it's full
+		if (_entries.size() >= _capacity)
+			_entries.clear();
+
+		_entries[hash(query)] = { query, hit };
+	}
+
+	size_t getSize() const
+	{
+		return _entries.size();
+	}
+};
\ No newline at end of file
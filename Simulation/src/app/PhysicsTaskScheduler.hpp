@@ -0,0 +1,64 @@
+#pragma once
+
+#include <LinearMath/btThreads.h>
+#include "JobSystem.hpp"
+#include <thread>
+
+//Lets Bullet's multithreaded world (btParallelFor/btParallelSum) run on the engine's job system
+class PhysicsTaskScheduler : public btITaskScheduler
+{
+private:
+	JobSystem* _jobSystem;
+	std::vector<btScalar> _threadSums; //One partial sum per worker (thread index 1..N), parallelSum adds them up afterwards
+
+public:
+	PhysicsTaskScheduler(JobSystem* jobSystem)
+		: btITaskScheduler("JobSystem"), _jobSystem(jobSystem), _threadSums(jobSystem->getMaxThreadCount(), 0)
+	{
+
+	}
+
+	int getMaxNumThreads() const override
+	{
+		return (int)std::min(_jobSystem->getMaxThreadCount(), BT_MAX_THREAD_COUNT);
+	}
+
+	int getNumThreads() const override
+	{
+		return (int)_jobSystem->getThreadCount();
+	}
+
+	void setNumThreads(int numThreads) override
+	{
+		_jobSystem->setThreadCount((unsigned int)std::max(1, std::min(numThreads, getMaxNumThreads())));
+	}
+
+	void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body) override
+	{
+		_jobSystem->parallelFor(iBegin, iEnd, grainSize, [&body](int begin, int end)
+		{
+			body.forLoop(begin, end);
+		});
+	}
+
+	btScalar parallelSum(int iBegin, int iEnd, int grainSize, const btIParallelSumBody& body) override
+	{
+		std::fill(_threadSums.begin(), _threadSums.end(), btScalar(0));
+
+		//The calling thread gets its own sum -> any thread that isn't one of the workers has thread index 0, not only the main thread
+		const std::thread::id caller = std::this_thread::get_id();
+		btScalar callerSum = 0;
+		_jobSystem->parallelFor(iBegin, iEnd, grainSize, [&](int begin, int end)
+		{
+			if (std::this_thread::get_id() == caller)
+				callerSum += body.sumLoop(begin, end);
+			else
+				_threadSums[JobSystem::getThreadIndex()] += body.sumLoop(begin, end);
+		});
+
+		btScalar sum = callerSum;
+		for (btScalar threadSum : _threadSums)
+			sum += threadSum;
+		return sum;
+	}
+};
\ No newline at end of file
@@ -2,12 +2,14 @@
 
 #include "SimDisplayManager.hpp"
 #include "ObjectManager.hpp"
+#include "FrameArena.hpp"
 
 class Simulation
 {
 private:
 	SimDisplayManager _simDisplayManager;
 	ObjectManager _objectManager;
+	bool _saveKeyPressed = false, _loadKeyPressed = false, _lodKeyPressed = false, _impostorKeyPressed = false;
 	
 public:
 	//---------------------------Application-Management---------------------------//
@@ -36,6 +38,56 @@ public:
 	{
 		_objectManager.renderObjects();
 	}
+
+	unsigned int getInstanceUploadBytes() const
+	{
+		return _objectManager.getInstanceUploadBytes();
+	}
+
+	unsigned int getInstanceUploadCalls() const
+	{
+		return _objectManager.getInstanceUploadCalls();
+	}
+
+	const StressEmitter* getStressEmitter() const
+	{
+		return _objectManager.getStressEmitter();
+	}
+
+	const QueryHit& getCrosshairHit() const
+	{
+		return _objectManager.getCrosshairHit();
+	}
+
+	const ContactEvents& getContactEvents() const
+	{
+		return _objectManager.getContactEvents();
+	}
+
+	const PhysicsEngine* getPhysicsEngine() const
+	{
+		return _objectManager.getPhysicsEngine();
+	}
+
+	const SphFluid* getFluid() const
+	{
+		return _objectManager.getFluid();
+	}
+
+	const NBodySimulation* getNBody() const
+	{
+		return _objectManager.getNBody();
+	}
+
+	unsigned int getMeshSphereCount() const
+	{
+		return _objectManager.getMeshSphereCount();
+	}
+
+	unsigned int getSphereCount() const
+	{
+		return _objectManager.getSphereCount();
+	}
 	
 	//---------------------------Display-Management---------------------------//
 	void printVersion()
@@ -71,6 +123,26 @@ public:
 	void processInput()
 	{
 		_simDisplayManager.processInput();
+
+		//F5 saves a snapshot, F9 loads it, L toggles the physics level of detail, I cycles the sphere rendering (mesh, impostor, auto)
+		bool saveKey = glfwGetKey(getWindow(), GLFW_KEY_F5) == GLFW_PRESS;
+		bool loadKey = glfwGetKey(getWindow(), GLFW_KEY_F9) == GLFW_PRESS;
+		bool lodKey = glfwGetKey(getWindow(), GLFW_KEY_L) == GLFW_PRESS;
+		bool impostorKey = glfwGetKey(getWindow(), GLFW_KEY_I) == GLFW_PRESS;
+
+		if (saveKey && !_saveKeyPressed)
+			_objectManager.saveSnapshot(SNAPSHOT_FILE);
+		if (loadKey && !_loadKeyPressed)
+			_objectManager.loadSnapshot(SNAPSHOT_FILE);
+		if (lodKey && !_lodKeyPressed)
+			_objectManager.togglePhysicsLod();
+		if (impostorKey && !_impostorKeyPressed)
+			_objectManager.cycleSphereRenderMode();
+
+		_saveKeyPressed = saveKey;
+		_loadKeyPressed = loadKey;
+		_lodKeyPressed = lodKey;
+		_impostorKeyPressed = impostorKey;
 	}
 	
 	void closeDisplay()
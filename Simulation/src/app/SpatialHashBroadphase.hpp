@@ -0,0 +1,360 @@
+#pragma once
+
+#include <btBulletCollisionCommon.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+//Broadphase that hashes all bounding boxes into a uniform grid every step and tests only boxes that share a cell
+//Meant for many similar sized bodies in a bounded arena (the spheres on the plane) -> no tree or sorted axes to maintain
+//Boxes that cover a lot of cells (the plane) get tested against all other boxes instead of being hashed
+class SpatialHashBroadphase : public btBroadphaseInterface
+{
+private:
+	static const int LARGE_PROXY_CELLS = 64;
+	static const int MAX_QUERY_CELLS = 4096; //Bigger query boxes (long diagonal rays) are cheaper to test against all boxes
+
+	struct Proxy : public btBroadphaseProxy
+	{
+		int _index; //Position in _proxies
+	};
+
+	struct CellEntry
+	{
+		uint32_t _bucket;
+		int _x, _y, _z;
+		Proxy* _proxy;
+	};
+
+	//Removes the pairs whose boxes don't overlap anymore
+	struct RemoveSeparatedPairs : public btOverlapCallback
+	{
+		bool processOverlap(btBroadphasePair& pair) override
+		{
+			return !TestAabbAgainstAabb2(pair.m_pProxy0->m_aabbMin, pair.m_pProxy0->m_aabbMax, pair.m_pProxy1->m_aabbMin, pair.m_pProxy1->m_aabbMax);
+		}
+	};
+
+	btOverlappingPairCache* _pairCache;
+	bool _ownsPairCache;
+	btScalar _cellSize, _inverseCellSize;
+	int _nextUid = 1;
+
+	std::vector<Proxy*> _proxies;
+	std::vector<Proxy*> _largeProxies;
+
+	//Counting sort of the cell entries by bucket -> all entries of a bucket end up next to each other, buffers get reused every step
+	std::vector<CellEntry> _entries, _sortedEntries;
+	std::vector<uint32_t> _bucketStarts;
+	uint32_t _bucketMask = 0;
+	bool _gridValid = false; //Grid still matches the boxes (nothing changed since the last pair search) -> box queries can use it
+
+	int cellCoordinate(btScalar value) const
+	{
+		return (int)std::floor(value * _inverseCellSize);
+	}
+
+	static uint32_t hashCell(int x, int y, int z)
+	{
+		return ((uint32_t)x * 73856093u) ^ ((uint32_t)y * 19349663u) ^ ((uint32_t)z * 83492791u);
+	}
+
+	static bool needsCollision(const btBroadphaseProxy* proxy0, const btBroadphaseProxy* proxy1)
+	{
+		return (proxy0->m_collisionFilterGroup & proxy1->m_collisionFilterMask) && (proxy1->m_collisionFilterGroup & proxy0->m_collisionFilterMask);
+	}
+
+	static bool overlaps(const btBroadphaseProxy* proxy0, const btBroadphaseProxy* proxy1)
+	{
+		return TestAabbAgainstAabb2(proxy0->m_aabbMin, proxy0->m_aabbMax, proxy1->m_aabbMin, proxy1->m_aabbMax);
+	}
+
+	void addPair(Proxy* proxy0, Proxy* proxy1)
+	{
+		//The cache finds already existing pairs itself
+		if (needsCollision(proxy0, proxy1) && overlaps(proxy0, proxy1))
+			_pairCache->addOverlappingPair(proxy0, proxy1);
+	}
+
+	void hashProxies()
+	{
+		_entries.clear();
+		_largeProxies.clear();
+
+		for (Proxy* proxy : _proxies)
+		{
+			int minX = cellCoordinate(proxy->m_aabbMin.x()), maxX = cellCoordinate(proxy->m_aabbMax.x());
+			int minY = cellCoordinate(proxy->m_aabbMin.y()), maxY = cellCoordinate(proxy->m_aabbMax.y());
+			int minZ = cellCoordinate(proxy->m_aabbMin.z()), maxZ = cellCoordinate(proxy->m_aabbMax.z());
+
+			int64_t cells = (int64_t)(maxX - minX + 1) * (maxY - minY + 1) * (maxZ - minZ + 1);
+			if (cells > LARGE_PROXY_CELLS)
+			{
+				_largeProxies.push_back(proxy);
+				continue;
+			}
+
+			for (int x = minX; x <= maxX; x++)
+				for (int y = minY; y <= maxY; y++)
+					for (int z = minZ; z <= maxZ; z++)
+						_entries.push_back({ 0, x, y, z, proxy });
+		}
+
+		//Table with at least twice as many buckets as entries -> few cells share a bucket
+		uint32_t buckets = 1024;
+		while (buckets < _entries.size() * 2)
+			buckets *= 2;
+		_bucketMask = buckets - 1;
+
+		_bucketStarts.assign(buckets + 1, 0);
+		for (CellEntry& entry : _entries)
+		{
+			entry._bucket = hashCell(entry._x, entry._y, entry._z) & _bucketMask;
+			_bucketStarts[entry._bucket + 1]++;
+		}
+
+		for (uint32_t i = 0; i < buckets; i++)
+			_bucketStarts[i + 1] += _bucketStarts[i];
+
+		_sortedEntries.resize(_entries.size());
+		for (const CellEntry& entry : _entries)
+			_sortedEntries[_bucketStarts[entry._bucket]++] = entry;
+
+		//The fill moved every start to the end of its bucket -> shift back
+		for (uint32_t i = buckets; i > 0; i--)
+			_bucketStarts[i] = _bucketStarts[i - 1];
+		_bucketStarts[0] = 0;
+	}
+
+	void findCellPairs()
+	{
+		for (uint32_t bucket = 0; bucket <= _bucketMask; bucket++)
+		{
+			uint32_t begin = _bucketStarts[bucket], end = _bucketStarts[bucket + 1];
+
+			for (uint32_t i = begin; i + 1 < end; i++)
+			{
+				const CellEntry& a = _sortedEntries[i];
+
+				for (uint32_t j = i + 1; j < end; j++)
+				{
+					const CellEntry& b = _sortedEntries[j];
+
+					//Different cells can share a bucket
+					if (a._x != b._x || a._y != b._y || a._z != b._z)
+						continue;
+
+					//Boxes that share several cells only get paired in the cell that contains the minimum corner of their intersection
+					if (cellCoordinate(btMax(a._proxy->m_aabbMin.x(), b._proxy->m_aabbMin.x())) != a._x ||
+						cellCoordinate(btMax(a._proxy->m_aabbMin.y(), b._proxy->m_aabbMin.y())) != a._y ||
+						cellCoordinate(btMax(a._proxy->m_aabbMin.z(), b._proxy->m_aabbMin.z())) != a._z)
+						continue;
+
+					addPair(a._proxy, b._proxy);
+				}
+			}
+		}
+	}
+
+	//Calls visit once for every box that overlaps the given box
+	//Between steps the grid of the last pair search is still valid -> small boxes only look at their cells, everything else tests all boxes
+	template<typename Visitor>
+	void forEachProxyInBox(const btVector3& aabbMin, const btVector3& aabbMax, const Visitor& visit)
+	{
+		int minX = cellCoordinate(aabbMin.x()), maxX = cellCoordinate(aabbMax.x());
+		int minY = cellCoordinate(aabbMin.y()), maxY = cellCoordinate(aabbMax.y());
+		int minZ = cellCoordinate(aabbMin.z()), maxZ = cellCoordinate(aabbMax.z());
+		int64_t cells = (int64_t)(maxX - minX + 1) * (maxY - minY + 1) * (maxZ - minZ + 1);
+
+		if (!_gridValid || cells > MAX_QUERY_CELLS)
+		{
+			for (Proxy* proxy : _proxies)
+			{
+				if (TestAabbAgainstAabb2(aabbMin, aabbMax, proxy->m_aabbMin, proxy->m_aabbMax))
+					visit(proxy);
+			}
+			return;
+		}
+
+		for (int x = minX; x <= maxX; x++)
+		{
+			for (int y = minY; y <= maxY; y++)
+			{
+				for (int z = minZ; z <= maxZ; z++)
+				{
+					uint32_t bucket = hashCell(x, y, z) & _bucketMask;
+					for (uint32_t i = _bucketStarts[bucket]; i < _bucketStarts[bucket + 1]; i++)
+					{
+						const CellEntry& entry = _sortedEntries[i];
+						if (entry._x != x || entry._y != y || entry._z != z)
+							continue;
+
+						//Same rule as for the pairs -> every box gets visited once
+						Proxy* proxy = entry._proxy;
+						if (!TestAabbAgainstAabb2(aabbMin, aabbMax, proxy->m_aabbMin, proxy->m_aabbMax) ||
+							cellCoordinate(btMax(aabbMin.x(), proxy->m_aabbMin.x())) != x ||
+							cellCoordinate(btMax(aabbMin.y(), proxy->m_aabbMin.y())) != y ||
+							cellCoordinate(btMax(aabbMin.z(), proxy->m_aabbMin.z())) != z)
+							continue;
+
+						visit(proxy);
+					}
+				}
+			}
+		}
+
+		for (Proxy* proxy : _largeProxies)
+		{
+			if (TestAabbAgainstAabb2(aabbMin, aabbMax, proxy->m_aabbMin, proxy->m_aabbMax))
+				visit(proxy);
+		}
+	}
+
+	void findLargeProxyPairs()
+	{
+		for (size_t i = 0; i < _largeProxies.size(); i++)
+		{
+			Proxy* large = _largeProxies[i];
+
+			for (Proxy* proxy : _proxies)
+			{
+				//Pairs of two large proxies only once
+				if (proxy == large || (std::find(_largeProxies.begin(), _largeProxies.begin() + i, proxy) != _largeProxies.begin() + i))
+					continue;
+
+				addPair(large, proxy);
+			}
+		}
+	}
+
+public:
+	//cellSize should be about the size of the typical body (twice the sphere radius or a bit more)
+	SpatialHashBroadphase(btScalar cellSize = 4.0f, btOverlappingPairCache* pairCache = nullptr)
+		: _pairCache(pairCache), _ownsPairCache(pairCache == nullptr), _cellSize(cellSize), _inverseCellSize(1.0f / cellSize)
+	{
+		if (_ownsPairCache)
+			_pairCache = new btHashedOverlappingPairCache();
+	}
+
+	~SpatialHashBroadphase()
+	{
+		for (Proxy* proxy : _proxies)
+			delete proxy;
+
+		if (_ownsPairCache)
+			delete _pairCache;
+	}
+
+	btBroadphaseProxy* createProxy(const btVector3& aabbMin, const btVector3& aabbMax, int shapeType, void* userPtr, int collisionFilterGroup, int collisionFilterMask, btDispatcher* dispatcher) override
+	{
+		(void)shapeType;
+		(void)dispatcher;
+
+		Proxy* proxy = new Proxy();
+		proxy->m_clientObject = userPtr;
+		proxy->m_collisionFilterGroup = collisionFilterGroup;
+		proxy->m_collisionFilterMask = collisionFilterMask;
+		proxy->m_aabbMin = aabbMin;
+		proxy->m_aabbMax = aabbMax;
+		proxy->m_uniqueId = _nextUid++;
+		proxy->_index = (int)_proxies.size();
+		_proxies.push_back(proxy);
+		_gridValid = false;
+
+		return proxy;
+	}
+
+	void destroyProxy(btBroadphaseProxy* proxy, btDispatcher* dispatcher) override
+	{
+		Proxy* removed = static_cast<Proxy*>(proxy);
+		_pairCache->removeOverlappingPairsContainingProxy(removed, dispatcher);
+
+		//Swap remove
+		Proxy* last = _proxies.back();
+		_proxies[removed->_index] = last;
+		last->_index = removed->_index;
+		_proxies.pop_back();
+		_gridValid = false;
+
+		delete removed;
+	}
+
+	void setAabb(btBroadphaseProxy* proxy, const btVector3& aabbMin, const btVector3& aabbMax, btDispatcher* dispatcher) override
+	{
+		(void)dispatcher;
+		proxy->m_aabbMin = aabbMin;
+		proxy->m_aabbMax = aabbMax;
+		_gridValid = false;
+	}
+
+	void getAabb(btBroadphaseProxy* proxy, btVector3& aabbMin, btVector3& aabbMax) const override
+	{
+		aabbMin = proxy->m_aabbMin;
+		aabbMax = proxy->m_aabbMax;
+	}
+
+	//aabbMin/aabbMax is the box of a swept shape (zero for rays) -> the boxes get tested grown by it
+	void rayTest(const btVector3& rayFrom, const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin = btVector3(0, 0, 0), const btVector3& aabbMax = btVector3(0, 0, 0)) override
+	{
+		btVector3 sweptMin = rayFrom, sweptMax = rayFrom;
+		sweptMin.setMin(rayTo);
+		sweptMax.setMax(rayTo);
+
+		forEachProxyInBox(sweptMin + aabbMin, sweptMax + aabbMax, [&](Proxy* proxy)
+		{
+			btVector3 bounds[2] = { proxy->m_aabbMin - aabbMax, proxy->m_aabbMax - aabbMin };
+			btScalar lambda;
+			if (btRayAabb2(rayFrom, rayCallback.m_rayDirectionInverse, rayCallback.m_signs, bounds, lambda, 0.0f, rayCallback.m_lambda_max))
+				rayCallback.process(proxy);
+		});
+	}
+
+	void aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback) override
+	{
+		forEachProxyInBox(aabbMin, aabbMax, [&callback](Proxy* proxy) { callback.process(proxy); });
+	}
+
+	void calculateOverlappingPairs(btDispatcher* dispatcher) override
+	{
+		hashProxies();
+		findCellPairs();
+		findLargeProxyPairs();
+
+		RemoveSeparatedPairs removeSeparatedPairs;
+		_pairCache->processAllOverlappingPairs(&removeSeparatedPairs, dispatcher);
+		_gridValid = true;
+	}
+
+	btOverlappingPairCache* getOverlappingPairCache() override
+	{
+		return _pairCache;
+	}
+
+	const btOverlappingPairCache* getOverlappingPairCache() const override
+	{
+		return _pairCache;
+	}
+
+	void getBroadphaseAabb(btVector3& aabbMin, btVector3& aabbMax) const override
+	{
+		aabbMin.setValue(BT_LARGE_FLOAT, BT_LARGE_FLOAT, BT_LARGE_FLOAT);
+		aabbMax.setValue(-BT_LARGE_FLOAT, -BT_LARGE_FLOAT, -BT_LARGE_FLOAT);
+
+		for (const Proxy* proxy : _proxies)
+		{
+			aabbMin.setMin(proxy->m_aabbMin);
+			aabbMax.setMax(proxy->m_aabbMax);
+		}
+	}
+
+	void printStats() override
+	{
+
+	}
+
+	unsigned int getLargeProxyCount() const
+	{
+		return (unsigned int)_largeProxies.size();
+	}
+};
\ No newline at end of file
@@ -0,0 +1,543 @@
+#pragma once
+
+#include "JobSystem.hpp"
+#include "CpuFeatures.hpp"
+#include "FixedStep.hpp"
+#include "InstanceTransform.hpp"
+#include <glm/glm.hpp>
+#include <spdlog/spdlog.h>
+#include <immintrin.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+//Configuration of the particle fluid
+struct FluidSettings
+{
+	unsigned int _particles = 100000;
+	float _smoothingRadius = 1.0f; //h -> particles interact up to this distance, also the cell size of the neighbour grid
+	float _restDensity = 1000.0f; //kg/m^3
+	float _soundSpeed = 40.0f; //m/s, the pressure stiffness (weakly compressible -> about 10x the fastest flow)
+	float _viscosity = 0.1f; //Kinematic, m^2/s
+	float _restitution = 0.2f; //Bounce off the ground and the basin walls
+	glm::vec3 _basinMin = glm::vec3(70.0f, 0.1f, 70.0f); //Floor = top of the ground plane of the Simulation
+	glm::vec3 _basinMax = glm::vec3(130.0f, 30.1f, 130.0f);
+	float _timeStep = 1.0f / 200.0f; //Fixed substep (has to stay below 0.4 * h / _soundSpeed)
+	unsigned int _maxSubsteps = 4; //Per update -> slow motion instead of a spiral of death when the CPU can't keep up
+	bool _simd = true; //Use the AVX2 kernels if the CPU supports them
+};
+
+//Smoothed-particle hydrodynamics on the CPU (weakly compressible, Müller et al. 2003 kernels)
+//Particles live in parallel arrays and get counting-sorted by grid cell every step -> the neighbours of a particle are
+//9 contiguous index ranges (x is the fastest grid axis), which the density and force kernels walk 8 particles at a time with AVX2
+//The fluid starts as a block in one corner of a basin on the ground plane (dam break) and collides with the plane and the walls
+class SphFluid
+{
+public:
+	//Times of the last step in ms
+	struct StepTimes
+	{
+		float _grid = 0.0f, _density = 0.0f, _forces = 0.0f, _integrate = 0.0f;
+
+		float total() const
+		{
+			return _grid + _density + _forces + _integrate;
+		}
+	};
+
+private:
+	//Padding behind every array -> the SIMD kernels can load 8 particles past the end of a range
+	static const unsigned int PADDING = 8;
+	static const int GRAIN_SIZE = 256;
+
+	FluidSettings _settings;
+	JobSystem& _jobSystem;
+	bool _simd;
+
+	unsigned int _count = 0;
+	float _mass, _spacing;
+	float _poly6, _spikyGradient, _viscosityLaplacian; //Kernel constants
+	float _stiffness;
+
+	//Particle data (structure of arrays), sorted by cell after every grid build
+	std::vector<float> _px, _py, _pz, _vx, _vy, _vz;
+	std::vector<float> _inverseDensity, _pressureTerm; //pressureTerm = P / density^2
+	std::vector<float> _ax, _ay, _az;
+	std::vector<float> _scratch; //Target of the sort
+
+	//Neighbour grid: particles of cell c are [_cellStart[c], _cellStart[c + 1])
+	int _gridX, _gridY, _gridZ;
+	std::vector<unsigned int> _cellStart;
+	std::vector<unsigned int> _cells, _sortedIndices, _cellFill;
+
+	FixedStep _fixedStep;
+	StepTimes _times;
+	unsigned int _steps = 0;
+
+	int cellCoord(float value, float min, int cells) const
+	{
+		return std::min(std::max((int)((value - min) / _settings._smoothingRadius), 0), cells - 1);
+	}
+
+	//Dam break: a block of particles in the -x corner of the basin, spaced half a smoothing radius apart
+	void blockLayout(unsigned int& perX, unsigned int& perZ) const
+	{
+		glm::vec3 extent = _settings._basinMax - _settings._basinMin;
+		perZ = std::max(1u, (unsigned int)(extent.z / _spacing) - 1);
+		perX = std::max(1u, (unsigned int)(extent.x * 0.4f / _spacing));
+	}
+
+	//Big particle counts stack the block higher than the basin -> the top layers would get pressed into the ceiling, the basin gets raised instead
+	void fitBasin()
+	{
+		unsigned int perX, perZ;
+		blockLayout(perX, perZ);
+		unsigned int layers = (_count + perX * perZ - 1) / (perX * perZ);
+		float height = (layers + 1) * _spacing;
+		if (_settings._basinMin.y + height > _settings._basinMax.y)
+		{
+			spdlog::info("SphFluid: {} particles stack {} layers high, raising the basin from {} to {}", _count, layers, _settings._basinMax.y, _settings._basinMin.y + height);
+			_settings._basinMax.y = _settings._basinMin.y + height;
+		}
+	}
+
+	void createBlock()
+	{
+		unsigned int perX, perZ;
+		blockLayout(perX, perZ);
+
+		for (unsigned int i = 0; i < _count; i++)
+		{
+			unsigned int x = i % perX;
+			unsigned int z = (i / perX) % perZ;
+			unsigned int y = i / (perX * perZ);
+
+			//Tiny offset per layer -> the block doesn't stay a perfect lattice
+			float jitter = (y % 2) * _spacing * 0.1f;
+			_px[i] = _settings._basinMin.x + (x + 0.5f) * _spacing + jitter;
+			_py[i] = _settings._basinMin.y + (y + 0.5f) * _spacing;
+			_pz[i] = _settings._basinMin.z + (z + 0.5f) * _spacing + jitter;
+		}
+	}
+
+	//Kernel sum of a particle inside the initial lattice -> the mass gets chosen so that the fluid starts at rest density
+	float latticeKernelSum() const
+	{
+		float h2 = _settings._smoothingRadius * _settings._smoothingRadius;
+		int reach = (int)std::ceil(_settings._smoothingRadius / _spacing);
+		float sum = 0.0f;
+
+		for (int z = -reach; z <= reach; z++)
+		{
+			for (int y = -reach; y <= reach; y++)
+			{
+				for (int x = -reach; x <= reach; x++)
+				{
+					float d = h2 - (x * x + y * y + z * z) * _spacing * _spacing;
+					if (d > 0.0f)
+						sum += d * d * d;
+				}
+			}
+		}
+
+		return sum;
+	}
+
+	//Counting sort by cell -> cell ranges for the neighbour search and neighbours close together in memory
+	void buildGrid()
+	{
+		const glm::vec3& min = _settings._basinMin;
+		_jobSystem.parallelFor(0, (int)_count, GRAIN_SIZE * 4, [&](int begin, int end)
+		{
+			for (int i = begin; i < end; i++)
+				_cells[i] = cellCoord(_px[i], min.x, _gridX) + _gridX * (cellCoord(_py[i], min.y, _gridY) + _gridY * cellCoord(_pz[i], min.z, _gridZ));
+		});
+
+		std::fill(_cellStart.begin(), _cellStart.end(), 0u);
+		for (unsigned int i = 0; i < _count; i++)
+			_cellStart[_cells[i] + 1]++;
+		for (size_t c = 1; c < _cellStart.size(); c++)
+			_cellStart[c] += _cellStart[c - 1];
+
+		//Stable -> particles keep their relative order within a cell
+		std::copy(_cellStart.begin(), _cellStart.end() - 1, _cellFill.begin());
+		for (unsigned int i = 0; i < _count; i++)
+			_sortedIndices[_cellFill[_cells[i]]++] = i;
+
+		for (std::vector<float>* array : { &_px, &_py, &_pz, &_vx, &_vy, &_vz })
+		{
+			std::vector<float>& values = *array;
+			_jobSystem.parallelFor(0, (int)_count, GRAIN_SIZE * 4, [&](int begin, int end)
+			{
+				for (int i = begin; i < end; i++)
+					_scratch[i] = values[_sortedIndices[i]];
+			});
+			std::copy(_scratch.begin(), _scratch.begin() + _count, values.begin());
+		}
+	}
+
+	//Index ranges of the 3x3x3 cells around the particle's cell -> returns the number of ranges (at most 9)
+	unsigned int neighbourRanges(unsigned int i, unsigned int* begins, unsigned int* ends) const
+	{
+		const glm::vec3& min = _settings._basinMin;
+		int cx = cellCoord(_px[i], min.x, _gridX), cy = cellCoord(_py[i], min.y, _gridY), cz = cellCoord(_pz[i], min.z, _gridZ);
+		int x0 = std::max(cx - 1, 0), x1 = std::min(cx + 1, _gridX - 1);
+		unsigned int ranges = 0;
+
+		for (int z = std::max(cz - 1, 0); z <= std::min(cz + 1, _gridZ - 1); z++)
+		{
+			for (int y = std::max(cy - 1, 0); y <= std::min(cy + 1, _gridY - 1); y++)
+			{
+				int row = _gridX * (y + _gridY * z);
+				unsigned int begin = _cellStart[row + x0], end = _cellStart[row + x1 + 1];
+				if (begin < end)
+				{
+					begins[ranges] = begin;
+					ends[ranges] = end;
+					ranges++;
+				}
+			}
+		}
+
+		return ranges;
+	}
+
+	void computeDensityScalar(unsigned int i)
+	{
+		unsigned int begins[9], ends[9];
+		unsigned int ranges = neighbourRanges(i, begins, ends);
+		float h2 = _settings._smoothingRadius * _settings._smoothingRadius;
+		float sum = 0.0f;
+
+		for (unsigned int r = 0; r < ranges; r++)
+		{
+			for (unsigned int j = begins[r]; j < ends[r]; j++)
+			{
+				float dx = _px[i] - _px[j], dy = _py[i] - _py[j], dz = _pz[i] - _pz[j];
+				float d = h2 - (dx * dx + dy * dy + dz * dz);
+				if (d > 0.0f)
+					sum += d * d * d;
+			}
+		}
+
+		storeDensity(i, sum);
+	}
+
+	TARGET_AVX2 void computeDensitySimd(unsigned int i)
+	{
+		unsigned int begins[9], ends[9];
+		unsigned int ranges = neighbourRanges(i, begins, ends);
+		const __m256 h2 = _mm256_set1_ps(_settings._smoothingRadius * _settings._smoothingRadius);
+		const __m256 xi = _mm256_set1_ps(_px[i]), yi = _mm256_set1_ps(_py[i]), zi = _mm256_set1_ps(_pz[i]);
+		const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+		__m256 sum = _mm256_setzero_ps();
+
+		for (unsigned int r = 0; r < ranges; r++)
+		{
+			for (unsigned int j = begins[r]; j < ends[r]; j += 8)
+			{
+				__m256 dx = _mm256_sub_ps(xi, _mm256_loadu_ps(&_px[j]));
+				__m256 dy = _mm256_sub_ps(yi, _mm256_loadu_ps(&_py[j]));
+				__m256 dz = _mm256_sub_ps(zi, _mm256_loadu_ps(&_pz[j]));
+				__m256 r2 = _mm256_fmadd_ps(dx, dx, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dz, dz)));
+				__m256 d = _mm256_sub_ps(h2, r2);
+
+				//Inside the kernel and not past the end of the range
+				__m256 inside = _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_GT_OQ);
+				__m256 valid = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32((int)(ends[r] - j)), lanes));
+				d = _mm256_and_ps(d, _mm256_and_ps(inside, valid));
+				sum = _mm256_fmadd_ps(_mm256_mul_ps(d, d), d, sum);
+			}
+		}
+
+		storeDensity(i, Simd8::horizontalSum(sum));
+	}
+
+	void storeDensity(unsigned int i, float sum)
+	{
+		float density = _mass * _poly6 * sum;
+		_inverseDensity[i] = 1.0f / density;
+
+		//Linear equation of state, clamped at zero -> no tension at the free surface, which would clump the particles
+		float pressure = std::max(_stiffness * (density - _settings._restDensity), 0.0f);
+		_pressureTerm[i] = pressure / (density * density);
+	}
+
+	void computeForceScalar(unsigned int i)
+	{
+		unsigned int begins[9], ends[9];
+		unsigned int ranges = neighbourRanges(i, begins, ends);
+		float h = _settings._smoothingRadius;
+		float ax = 0.0f, ay = 0.0f, az = 0.0f;
+		float vx = 0.0f, vy = 0.0f, vz = 0.0f;
+
+		for (unsigned int r = 0; r < ranges; r++)
+		{
+			for (unsigned int j = begins[r]; j < ends[r]; j++)
+			{
+				float dx = _px[i] - _px[j], dy = _py[i] - _py[j], dz = _pz[i] - _pz[j];
+				float r2 = dx * dx + dy * dy + dz * dz;
+				if (r2 >= h * h || r2 <= 0.0f)
+					continue;
+
+				float distance = std::sqrt(r2);
+				float w = h - distance;
+
+				//Symmetric pressure term along the spiky gradient, pushes the particles apart
+				float pressure = (_pressureTerm[i] + _pressureTerm[j]) * w * w / distance;
+				ax += pressure * dx;
+				ay += pressure * dy;
+				az += pressure * dz;
+
+				//Viscosity pulls the velocities of neighbours together
+				float viscosity = w * _inverseDensity[j];
+				vx += viscosity * (_vx[j] - _vx[i]);
+				vy += viscosity * (_vy[j] - _vy[i]);
+				vz += viscosity * (_vz[j] - _vz[i]);
+			}
+		}
+
+		storeForce(i, ax, ay, az, vx, vy, vz);
+	}
+
+	TARGET_AVX2 void computeForceSimd(unsigned int i)
+	{
+		unsigned int begins[9], ends[9];
+		unsigned int ranges = neighbourRanges(i, begins, ends);
+		const __m256 h = _mm256_set1_ps(_settings._smoothingRadius), h2 = _mm256_mul_ps(h, h);
+		const __m256 xi = _mm256_set1_ps(_px[i]), yi = _mm256_set1_ps(_py[i]), zi = _mm256_set1_ps(_pz[i]);
+		const __m256 vxi = _mm256_set1_ps(_vx[i]), vyi = _mm256_set1_ps(_vy[i]), vzi = _mm256_set1_ps(_vz[i]);
+		const __m256 pressureI = _mm256_set1_ps(_pressureTerm[i]);
+		const __m256 one = _mm256_set1_ps(1.0f);
+		const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+		__m256 ax = _mm256_setzero_ps(), ay = _mm256_setzero_ps(), az = _mm256_setzero_ps();
+		__m256 vx = _mm256_setzero_ps(), vy = _mm256_setzero_ps(), vz = _mm256_setzero_ps();
+
+		for (unsigned int r = 0; r < ranges; r++)
+		{
+			for (unsigned int j = begins[r]; j < ends[r]; j += 8)
+			{
+				__m256 dx = _mm256_sub_ps(xi, _mm256_loadu_ps(&_px[j]));
+				__m256 dy = _mm256_sub_ps(yi, _mm256_loadu_ps(&_py[j]));
+				__m256 dz = _mm256_sub_ps(zi, _mm256_loadu_ps(&_pz[j]));
+				__m256 r2 = _mm256_fmadd_ps(dx, dx, _mm256_fmadd_ps(dy, dy, _mm256_mul_ps(dz, dz)));
+
+				//Inside the kernel, not the particle itself and not past the end of the range
+				__m256 mask = _mm256_and_ps(_mm256_cmp_ps(r2, h2, _CMP_LT_OQ), _mm256_cmp_ps(r2, _mm256_setzero_ps(), _CMP_GT_OQ));
+				mask = _mm256_and_ps(mask, _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32((int)(ends[r] - j)), lanes)));
+				if (_mm256_movemask_ps(mask) == 0)
+					continue;
+
+				//1 / r from the approximate reciprocal square root with one Newton step (masked lanes get r = 1 and a zero weight)
+				__m256 safeR2 = _mm256_blendv_ps(one, r2, mask);
+				__m256 inverse = Simd8::inverseSqrt(safeR2);
+				__m256 w = _mm256_and_ps(_mm256_sub_ps(h, _mm256_mul_ps(safeR2, inverse)), mask);
+
+				__m256 pressure = _mm256_add_ps(pressureI, _mm256_loadu_ps(&_pressureTerm[j]));
+				pressure = _mm256_mul_ps(_mm256_mul_ps(pressure, _mm256_mul_ps(w, w)), inverse);
+				ax = _mm256_fmadd_ps(pressure, dx, ax);
+				ay = _mm256_fmadd_ps(pressure, dy, ay);
+				az = _mm256_fmadd_ps(pressure, dz, az);
+
+				__m256 viscosity = _mm256_mul_ps(w, _mm256_loadu_ps(&_inverseDensity[j]));
+				vx = _mm256_fmadd_ps(viscosity, _mm256_sub_ps(_mm256_loadu_ps(&_vx[j]), vxi), vx);
+				vy = _mm256_fmadd_ps(viscosity, _mm256_sub_ps(_mm256_loadu_ps(&_vy[j]), vyi), vy);
+				vz = _mm256_fmadd_ps(viscosity, _mm256_sub_ps(_mm256_loadu_ps(&_vz[j]), vzi), vz);
+			}
+		}
+
+		storeForce(i, Simd8::horizontalSum(ax), Simd8::horizontalSum(ay), Simd8::horizontalSum(az), Simd8::horizontalSum(vx), Simd8::horizontalSum(vy), Simd8::horizontalSum(vz));
+	}
+
+	void storeForce(unsigned int i, float ax, float ay, float az, float vx, float vy, float vz)
+	{
+		float pressure = _mass * _spikyGradient;
+		float viscosity = _settings._viscosity * _mass * _viscosityLaplacian;
+		_ax[i] = pressure * ax + viscosity * vx;
+		_ay[i] = pressure * ay + viscosity * vy - 9.8f;
+		_az[i] = pressure * az + viscosity * vz;
+	}
+
+	//Semi-implicit Euler, particles that leave the basin get put back and bounce off the ground or the wall
+	void integrate(unsigned int i, float dt)
+	{
+		_vx[i] += _ax[i] * dt;
+		_vy[i] += _ay[i] * dt;
+		_vz[i] += _az[i] * dt;
+		_px[i] += _vx[i] * dt;
+		_py[i] += _vy[i] * dt;
+		_pz[i] += _vz[i] * dt;
+
+		collide(_px[i], _vx[i], _settings._basinMin.x, _settings._basinMax.x);
+		collide(_py[i], _vy[i], _settings._basinMin.y, _settings._basinMax.y);
+		collide(_pz[i], _vz[i], _settings._basinMin.z, _settings._basinMax.z);
+	}
+
+	void collide(float& position, float& velocity, float min, float max) const
+	{
+		if (position < min)
+		{
+			position = min;
+			if (velocity < 0.0f)
+				velocity *= -_settings._restitution;
+		}
+		else if (position > max)
+		{
+			position = max;
+			if (velocity > 0.0f)
+				velocity *= -_settings._restitution;
+		}
+	}
+
+public:
+	//The steps run on jobSystem (e.g. the one of the PhysicsEngine), it has to outlive the fluid
+	SphFluid(JobSystem& jobSystem, const FluidSettings& settings = FluidSettings())
+		: _settings(settings), _jobSystem(jobSystem), _simd(settings._simd && CpuFeatures::hasAvx2()),
+		  _fixedStep(settings._timeStep, settings._maxSubsteps)
+	{
+		const float pi = 3.14159265358979f;
+		float h = _settings._smoothingRadius;
+
+		_count = _settings._particles;
+		_spacing = h * 0.5f;
+		_poly6 = 315.0f / (64.0f * pi * std::pow(h, 9.0f));
+		_mass = _settings._restDensity / (_poly6 * latticeKernelSum());
+		_spikyGradient = 45.0f / (pi * std::pow(h, 6.0f));
+		_viscosityLaplacian = 45.0f / (pi * std::pow(h, 6.0f));
+		_stiffness = _settings._soundSpeed * _settings._soundSpeed;
+
+		//Padding lies far outside the basin -> never a neighbour
+		for (std::vector<float>* array : { &_px, &_py, &_pz })
+			array->assign(_count + PADDING, -1e6f);
+		for (std::vector<float>* array : { &_vx, &_vy, &_vz, &_ax, &_ay, &_az, &_pressureTerm, &_scratch })
+			array->assign(_count + PADDING, 0.0f);
+		_inverseDensity.assign(_count + PADDING, 1.0f / _settings._restDensity);
+
+		fitBasin();
+		glm::vec3 extent = _settings._basinMax - _settings._basinMin;
+		_gridX = std::max(1, (int)std::ceil(extent.x / h));
+		_gridY = std::max(1, (int)std::ceil(extent.y / h));
+		_gridZ = std::max(1, (int)std::ceil(extent.z / h));
+		_cellStart.resize((size_t)_gridX * _gridY * _gridZ + 1);
+		_cellFill.resize(_cellStart.size() - 1);
+		_cells.resize(_count);
+		_sortedIndices.resize(_count);
+
+		createBlock();
+	}
+
+	//Advances the fluid by frameTime in fixed substeps, returns the number of substeps
+	unsigned int update(float frameTime)
+	{
+		return _fixedStep.update(frameTime, [this]() { step(); });
+	}
+
+	void step()
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		buildGrid();
+		_times._grid = FixedStep::elapsed(start);
+
+		_jobSystem.parallelFor(0, (int)_count, GRAIN_SIZE, [&](int begin, int end)
+		{
+			for (int i = begin; i < end; i++)
+			{
+				if (_simd)
+					computeDensitySimd(i);
+				else
+					computeDensityScalar(i);
+			}
+		});
+		_times._density = FixedStep::elapsed(start);
+
+		_jobSystem.parallelFor(0, (int)_count, GRAIN_SIZE, [&](int begin, int end)
+		{
+			for (int i = begin; i < end; i++)
+			{
+				if (_simd)
+					computeForceSimd(i);
+				else
+					computeForceScalar(i);
+			}
+		});
+		_times._forces = FixedStep::elapsed(start);
+
+		float dt = _settings._timeStep;
+		_jobSystem.parallelFor(0, (int)_count, GRAIN_SIZE * 4, [&](int begin, int end)
+		{
+			for (int i = begin; i < end; i++)
+				integrate(i, dt);
+		});
+		_times._integrate = FixedStep::elapsed(start);
+
+		_steps++;
+	}
+
+	//Instance data for the renderer: position with the given scale and no rotation, the color goes from deep blue to white with the speed
+	void writeInstances(InstanceTransform* transforms, glm::vec3* colors, float scale)
+	{
+		_jobSystem.parallelFor(0, (int)_count, GRAIN_SIZE * 4, [&](int begin, int end)
+		{
+			for (int i = begin; i < end; i++)
+			{
+				transforms[i]._position = glm::vec3(_px[i], _py[i], _pz[i]);
+				transforms[i]._scale = scale;
+				transforms[i].setRotation(0.0f, 0.0f, 0.0f, 1.0f);
+
+				float speed = std::sqrt(_vx[i] * _vx[i] + _vy[i] * _vy[i] + _vz[i] * _vz[i]);
+				float t = std::min(speed * 0.1f, 1.0f);
+				colors[i] = glm::mix(glm::vec3(0.05f, 0.2f, 0.7f), glm::vec3(0.9f, 0.95f, 1.0f), t);
+			}
+		});
+	}
+
+	unsigned int getParticleCount() const
+	{
+		return _count;
+	}
+
+	float getParticleSpacing() const
+	{
+		return _spacing;
+	}
+
+	const StepTimes& getLastStepTimes() const
+	{
+		return _times;
+	}
+
+	unsigned int getStepCount() const
+	{
+		return _steps;
+	}
+
+	bool usesSimd() const
+	{
+		return _simd;
+	}
+
+	unsigned int getThreadCount() const
+	{
+		return _jobSystem.getThreadCount();
+	}
+
+	//Mean density over all particles divided by the rest density (1 = incompressible), for checking the stiffness
+	float computeAverageCompression() const
+	{
+		double sum = 0.0;
+		for (unsigned int i = 0; i < _count; i++)
+			sum += 1.0 / _inverseDensity[i];
+		return _count > 0 ? (float)(sum / _count / _settings._restDensity) : 0.0f;
+	}
+
+	glm::vec3 getPosition(unsigned int i) const
+	{
+		return glm::vec3(_px[i], _py[i], _pz[i]);
+	}
+
+	glm::vec3 getVelocity(unsigned int i) const
+	{
+		return glm::vec3(_vx[i], _vy[i], _vz[i]);
+	}
+};
\ No newline at end of file
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "ObjectSpawner.hpp"
+#include <spdlog/spdlog.h>
+#include <vector>
+
+const unsigned int STRESS_TARGET_SPHERES = 100000;
+const unsigned int STRESS_STAGE_SIZE = 5000; //Spheres that get added between two measurements
+const unsigned int STRESS_SPAWNS_PER_FRAME = 500;
+const unsigned int STRESS_MEASURED_FRAMES = 120;
+
+//Continuous emitter that ramps the sphere count up in stages and measures frame and physics time after every stage
+class StressEmitter
+{
+public:
+	struct StageReport
+	{
+		unsigned int _spheres;
+		float _frameTime, _physicsTime; //Averages in ms
+	};
+
+private:
+	enum State
+	{
+		EMITTING,
+		MEASURING,
+		DONE
+	};
+
+	ObjectSpawner* _objectSpawner = nullptr;
+	PhysicsEngine* _physicsEngine = nullptr;
+	State _state = EMITTING;
+	unsigned int _stageTarget;
+	unsigned int _measuredFrames = 0;
+	float _frameTimeSum = 0.0f, _physicsTimeSum = 0.0f;
+	std::vector<StageReport> _reports;
+
+	void emit()
+	{
+		unsigned int count = _objectSpawner->getInstanceCount();
+		unsigned int spawns = std::min(STRESS_SPAWNS_PER_FRAME, _stageTarget > count ? _stageTarget - count : 0);
+
+		//Spheres rain down over the whole plane
+		_objectSpawner->spawnRandom(spawns, 50.0f, 100.0f);
+
+		if (_objectSpawner->getInstanceCount() >= _stageTarget)
+		{
+			//Stage reached -> measure with the new load
+			_state = MEASURING;
+			_measuredFrames = 0;
+			_frameTimeSum = 0.0f;
+			_physicsTimeSum = 0.0f;
+		}
+	}
+
+	void measure(float frameTime)
+	{
+		_frameTimeSum += frameTime;
+		_physicsTimeSum += _physicsEngine->getLastStepTime();
+
+		if (++_measuredFrames < STRESS_MEASURED_FRAMES)
+			return;
+
+		StageReport report = { _objectSpawner->getInstanceCount(), _frameTimeSum / _measuredFrames, _physicsTimeSum / _measuredFrames };
+		_reports.push_back(report);
+		spdlog::info("Stress test: {:>6} spheres | Frame: {:>8.3f} ms | Physics: {:>8.3f} ms", report._spheres, report._frameTime, report._physicsTime);
+
+		if (_stageTarget >= STRESS_TARGET_SPHERES)
+		{
+			_state = DONE;
+			spdlog::info("Stress test finished");
+		}
+		else
+		{
+			_stageTarget = std::min(_stageTarget + STRESS_STAGE_SIZE, STRESS_TARGET_SPHERES);
+			_state = EMITTING;
+		}
+	}
+
+public:
+	StressEmitter(ObjectSpawner* objectSpawner, PhysicsEngine* physicsEngine)
+		: _objectSpawner(objectSpawner), _physicsEngine(physicsEngine)
+	{
+		_stageTarget = std::min(_objectSpawner->getInstanceCount() + STRESS_STAGE_SIZE, STRESS_TARGET_SPHERES);
+		_reports.reserve(STRESS_TARGET_SPHERES / STRESS_STAGE_SIZE + 1);
+	}
+
+	//Call once per frame before the physics step (frameTime of the last frame in ms)
+	void update(float frameTime)
+	{
+		if (_state == EMITTING)
+			emit();
+		else if (_state == MEASURING)
+			measure(frameTime);
+	}
+
+	bool isDone() const
+	{
+		return _state == DONE;
+	}
+
+	const std::vector<StageReport>& getReports() const
+	{
+		return _reports;
+	}
+};
\ No newline at end of file
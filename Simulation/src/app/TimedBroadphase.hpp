@@ -0,0 +1,116 @@
+#pragma once
+
+#include <btBulletCollisionCommon.h>
+#include <chrono>
+
+//Forwards everything to another broadphase and measures how long a step spends finding pairs
+//The measured time goes from the first box update of a step (updateAabbs) to the end of calculateOverlappingPairs
+//-> covers the incremental work of tree/sweep broadphases in setAabb as well as the pair search itself, with only two clock reads per step
+class TimedBroadphase : public btBroadphaseInterface
+{
+private:
+	btBroadphaseInterface* _broadphase;
+	std::chrono::high_resolution_clock::time_point _start;
+	bool _measuring = false;
+	float _time = 0.0f; //ms since the last reset
+
+	void startMeasuring()
+	{
+		if (!_measuring)
+		{
+			_measuring = true;
+			_start = std::chrono::high_resolution_clock::now();
+		}
+	}
+
+public:
+	//Takes ownership of the broadphase
+	TimedBroadphase(btBroadphaseInterface* broadphase)
+		: _broadphase(broadphase)
+	{
+
+	}
+
+	~TimedBroadphase()
+	{
+		delete _broadphase;
+	}
+
+	btBroadphaseProxy* createProxy(const btVector3& aabbMin, const btVector3& aabbMax, int shapeType, void* userPtr, int collisionFilterGroup, int collisionFilterMask, btDispatcher* dispatcher) override
+	{
+		return _broadphase->createProxy(aabbMin, aabbMax, shapeType, userPtr, collisionFilterGroup, collisionFilterMask, dispatcher);
+	}
+
+	void destroyProxy(btBroadphaseProxy* proxy, btDispatcher* dispatcher) override
+	{
+		_broadphase->destroyProxy(proxy, dispatcher);
+	}
+
+	void setAabb(btBroadphaseProxy* proxy, const btVector3& aabbMin, const btVector3& aabbMax, btDispatcher* dispatcher) override
+	{
+		startMeasuring();
+		_broadphase->setAabb(proxy, aabbMin, aabbMax, dispatcher);
+	}
+
+	void getAabb(btBroadphaseProxy* proxy, btVector3& aabbMin, btVector3& aabbMax) const override
+	{
+		_broadphase->getAabb(proxy, aabbMin, aabbMax);
+	}
+
+	void rayTest(const btVector3& rayFrom, const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin = btVector3(0, 0, 0), const btVector3& aabbMax = btVector3(0, 0, 0)) override
+	{
+		_broadphase->rayTest(rayFrom, rayTo, rayCallback, aabbMin, aabbMax);
+	}
+
+	void aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback) override
+	{
+		_broadphase->aabbTest(aabbMin, aabbMax, callback);
+	}
+
+	void calculateOverlappingPairs(btDispatcher* dispatcher) override
+	{
+		startMeasuring();
+		_broadphase->calculateOverlappingPairs(dispatcher);
+
+		_time += std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - _start).count();
+		_measuring = false;
+	}
+
+	btOverlappingPairCache* getOverlappingPairCache() override
+	{
+		return _broadphase->getOverlappingPairCache();
+	}
+
+	const btOverlappingPairCache* getOverlappingPairCache() const override
+	{
+		return _broadphase->getOverlappingPairCache();
+	}
+
+	void getBroadphaseAabb(btVector3& aabbMin, btVector3& aabbMax) const override
+	{
+		_broadphase->getBroadphaseAabb(aabbMin, aabbMax);
+	}
+
+	void resetPool(btDispatcher* dispatcher) override
+	{
+		_broadphase->resetPool(dispatcher);
+	}
+
+	void printStats() override
+	{
+		_broadphase->printStats();
+	}
+
+	//Pair finding time since the last reset in ms
+	float getTime() const
+	{
+		return _time;
+	}
+
+	//Also drops a measurement that got started by a box update outside of a step
+	void resetTime()
+	{
+		_time = 0.0f;
+		_measuring = false;
+	}
+};
\ No newline at end of file
@@ -1,10 +1,175 @@
+//FRAME_ALLOCATION_TRACKING in the preprocessor definitions of the project counts heap allocations per frame and warns about every frame that allocates
+
+#include "AllocationTracker.hpp"
 #include "Simulation.hpp"
+#include "PhysicsBenchmark.hpp"
+#include "HeadlessBenchmark.hpp"
+#include "ParameterSweep.hpp"
+#include <spdlog/sinks/stdout_color_sinks.h>
 #include <imgui/imgui.h>
 #include <imgui/imgui_impl_glfw.h>
 #include <imgui/imgui_impl_opengl3.h>
 
-int main()
+int main(int argc, char* argv[])
 {
+	//Command line options
+	bool headless = false, sweep = false;
+	HeadlessSettings headlessSettings;
+	SweepSettings sweepSettings;
+
+	//The headless report goes to stdout -> log messages (also the ones about the options below) have to go to stderr
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::string(argv[i]) == "--headless")
+		{
+			spdlog::set_default_logger(spdlog::stderr_color_mt("stderr"));
+			break;
+		}
+	}
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+
+		//Measure physics step times for different body and thread counts instead of starting the application
+		if (arg == "--physics-benchmark")
+		{
+			PhysicsBenchmark::runAll();
+			return 0;
+		}
+		//Time batches of ray, sweep and overlap queries
+		else if (arg == "--query-benchmark")
+		{
+			PhysicsBenchmark::runQueries();
+			return 0;
+		}
+		//Compare the broadphases for different body counts and densities
+		else if (arg == "--broadphase-benchmark")
+		{
+			PhysicsBenchmark::runBroadphases();
+			return 0;
+		}
+		//Step times of the SPH fluid for different particle and thread counts, AVX2 against scalar kernels
+		else if (arg == "--fluid-benchmark")
+		{
+			PhysicsBenchmark::runFluid();
+			return 0;
+		}
+		//Barnes-Hut against direct summation for 10k to 1M bodies
+		else if (arg == "--nbody-benchmark")
+		{
+			PhysicsBenchmark::runNBody();
+			return 0;
+		}
+		else if (arg == "--physics-threads" && i + 1 < argc)
+			PHYSICS_THREADS = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--stress")
+			STRESS_MODE = true;
+		else if (arg == "--seed" && i + 1 < argc)
+			SIMULATION_SEED = (uint32_t)std::strtoul(argv[++i], nullptr, 10);
+		else if (arg == "--fixed-step")
+			FIXED_TIMESTEP = true;
+		else if (arg == "--physics-lod")
+			PHYSICS_LOD = true;
+		else if (arg == "--fluid")
+			FLUID_MODE = true;
+		else if (arg == "--fluid-particles" && i + 1 < argc)
+			FLUID_PARTICLES = (unsigned int)std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--sphere-render" && i + 1 < argc)
+		{
+			if (!parsePhysicsOption(argv[++i], SPHERE_RENDER_MODE_NAMES, SPHERE_RENDER_MODE))
+				spdlog::warn("Unknown sphere rendering {}, using {}", argv[i], SPHERE_RENDER_MODE_NAMES[SPHERE_RENDER_MODE]);
+		}
+		else if (arg == "--nbody")
+			NBODY_MODE = true;
+		else if (arg == "--nbody-bodies" && i + 1 < argc)
+			NBODY_BODIES = (unsigned int)std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--nbody-theta" && i + 1 < argc)
+			NBODY_THETA = std::max(0.0f, (float)std::atof(argv[++i]));
+		else if (arg == "--snapshot" && i + 1 < argc)
+		{
+			//Starting from a snapshot is meant for comparable runs -> fixed timestep as well
+			SNAPSHOT_FILE = argv[++i];
+			LOAD_SNAPSHOT = true;
+			FIXED_TIMESTEP = true;
+		}
+		else if (arg == "--replay" && i + 2 < argc)
+		{
+			//Headless: --replay <snapshot> <steps>
+			std::string snapshot = argv[i + 1];
+			PhysicsBenchmark::replay(snapshot, (unsigned int)std::max(0, std::atoi(argv[i + 2])));
+			return 0;
+		}
+		//Headless benchmark: builds the world without window and GL context and writes a JSON report
+		else if (arg == "--headless")
+			headless = true;
+		else if (arg == "--spheres" && i + 1 < argc)
+			headlessSettings._spheres = (unsigned int)std::max(0, std::atoi(argv[++i]));
+		else if (arg == "--steps" && i + 1 < argc)
+			headlessSettings._steps = (unsigned int)std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--warmup" && i + 1 < argc)
+			headlessSettings._warmupSteps = (unsigned int)std::max(0, std::atoi(argv[++i]));
+		else if (arg == "--dt" && i + 1 < argc)
+			headlessSettings._dt = std::max(0.0001f, (float)std::atof(argv[++i]));
+		else if (arg == "--report" && i + 1 < argc)
+			headlessSettings._reportFile = argv[++i];
+		else if (arg == "--solver" && i + 1 < argc)
+		{
+			if (!parsePhysicsOption(argv[++i], PHYSICS_SOLVER_NAMES, headlessSettings._solver))
+				spdlog::warn("Unknown solver {}, using {}", argv[i], PHYSICS_SOLVER_NAMES[headlessSettings._solver]);
+		}
+		else if (arg == "--broadphase" && i + 1 < argc)
+		{
+			if (!parsePhysicsOption(argv[++i], PHYSICS_BROADPHASE_NAMES, headlessSettings._broadphase))
+				spdlog::warn("Unknown broadphase {}, using {}", argv[i], PHYSICS_BROADPHASE_NAMES[headlessSettings._broadphase]);
+		}
+		//Parameter sweep: one headless world per combination of the comma separated lists, results go into a CSV
+		else if (arg == "--sweep")
+			sweep = true;
+		else if ((arg == "--sweep-restitution" || arg == "--sweep-friction" || arg == "--sweep-mass") && i + 1 < argc)
+		{
+			std::vector<float>& values = arg == "--sweep-restitution" ? sweepSettings._restitutions
+				: arg == "--sweep-friction" ? sweepSettings._frictions
+				: sweepSettings._masses;
+
+			if (!ParameterSweep::parseList(argv[++i], values))
+				spdlog::warn("Invalid list {} for {}, keeping the default", argv[i], arg);
+		}
+		else if (arg == "--sweep-spheres" && i + 1 < argc)
+		{
+			if (!ParameterSweep::parseList(argv[++i], sweepSettings._sphereCounts))
+				spdlog::warn("Invalid list {} for {}, keeping the default", argv[i], arg);
+		}
+		else if (arg == "--sweep-seeds" && i + 1 < argc)
+			sweepSettings._seeds = (unsigned int)std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--sweep-steps" && i + 1 < argc)
+			sweepSettings._maxSteps = (unsigned int)std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--sweep-threads" && i + 1 < argc)
+			sweepSettings._threads = (unsigned int)std::max(0, std::atoi(argv[++i]));
+		else if (arg == "--sweep-csv" && i + 1 < argc)
+			sweepSettings._csvFile = argv[++i];
+	}
+
+	//Snapshot replays are only bit-for-bit reproducible with a single physics thread
+	if (LOAD_SNAPSHOT && PHYSICS_THREADS > 1)
+	{
+		spdlog::warn("Starting from a snapshot, ignoring --physics-threads {}", PHYSICS_THREADS);
+		PHYSICS_THREADS = 1;
+	}
+
+	if (sweep)
+	{
+		sweepSettings._seed = SIMULATION_SEED;
+		return ParameterSweep::run(sweepSettings) ? 0 : 1;
+	}
+
+	if (headless)
+	{
+		headlessSettings._threads = PHYSICS_THREADS;
+		headlessSettings._seed = SIMULATION_SEED;
+		return HeadlessBenchmark::run(headlessSettings) ? 0 : 1;
+	}
+
 	//Create application
 	Simulation simulation;
 	simulation.printVersion();
@@ -50,7 +215,48 @@ int main()
 			ImGui::Text("Camera-Yaw: %f, Camera-Pitch: %f", camera.Yaw, camera.Pitch);
 			ImGui::Text("Camera-Front: X: %f, Y: %f, Z: %f", camera.Front.x, camera.Front.y, camera.Front.z);
 			ImGui::Text("---------------------------------------------");
-			ImGui::Text("Rendered Vertices: %d", VERTICES_TO_RENDER);			
+			ImGui::Text("Rendered Vertices: %d", VERTICES_TO_RENDER);
+			ImGui::Text("Spheres: %d meshes, %d impostors (%s, I)", simulation.getMeshSphereCount(), simulation.getSphereCount() - simulation.getMeshSphereCount(), SPHERE_RENDER_MODE_NAMES[SPHERE_RENDER_MODE]);
+			ImGui::Text("Physics: %.3f ms/step (%d threads)", PHYSICS_STEP_TIME, PHYSICS_THREADS);
+			{
+				//The reduction needs a measurement of both modes -> toggle with L once
+				const PhysicsEngine* physicsEngine = simulation.getPhysicsEngine();
+				float withLod = physicsEngine->getAverageStepTime(true), withoutLod = physicsEngine->getAverageStepTime(false);
+
+				if (physicsEngine->isLodEnabled())
+					ImGui::Text("Physics LOD: %d full, %d reduced, %d frozen", physicsEngine->getLodCount(LOD_FULL), physicsEngine->getLodCount(LOD_REDUCED), physicsEngine->getLodCount(LOD_FROZEN));
+				else
+					ImGui::Text("Physics LOD: off (L)");
+
+				if (withLod > 0.0f && withoutLod > 0.0f)
+					ImGui::Text("Physics LOD step: %.3f ms vs. %.3f ms without (%.0f%% less)", withLod, withoutLod, (1.0f - withLod / withoutLod) * 100.0f);
+			}
+			if (simulation.getCrosshairHit()._bodyIndex >= 0)
+				ImGui::Text("Crosshair: body %d at %.1f", simulation.getCrosshairHit()._bodyIndex, simulation.getCrosshairHit()._fraction * 1000.0f);
+			else
+				ImGui::Text("Crosshair: nothing");
+			if (const SphFluid* fluid = simulation.getFluid())
+			{
+				const SphFluid::StepTimes& times = fluid->getLastStepTimes();
+				ImGui::Text("Fluid: %d particles, %.3f ms/step (grid %.3f, density %.3f, forces %.3f) %s", fluid->getParticleCount(), times.total(), times._grid, times._density, times._forces, fluid->usesSimd() ? "AVX2" : "scalar");
+			}
+			if (const NBodySimulation* nbody = simulation.getNBody())
+			{
+				const NBodySimulation::StepTimes& times = nbody->getLastStepTimes();
+				ImGui::Text("N-body: %d bodies, theta %.2f, %.3f ms/step (tree %.3f, forces %.3f), %.0f interactions/body", nbody->getBodyCount(), nbody->getTheta(), times.total(), times._tree, times._forces, nbody->getInteractionsPerBody());
+			}
+			ImGui::Text("Plane contacts: %d landed, %d left (last step)", simulation.getContactEvents()._newCount, simulation.getContactEvents()._endedCount);
+			ImGui::Text("Instance uploads: %d KB in %d calls", (int)(simulation.getInstanceUploadBytes() / 1024), simulation.getInstanceUploadCalls());
+			ImGui::Text("Frame arena: %d KB", (int)(FrameArena::get().getUsedBytes() / 1024));
+			if (AllocationTracker::isEnabled())
+				ImGui::Text("Heap allocations (last frame): %d", AllocationTracker::getLastFrameAllocations());
+			if (const StressEmitter* stressEmitter = simulation.getStressEmitter())
+			{
+				ImGui::Text("---------------------------------------------");
+				ImGui::Text(stressEmitter->isDone() ? "Stress test (finished):" : "Stress test (running):");
+				for (const StressEmitter::StageReport& report : stressEmitter->getReports())
+					ImGui::Text("%6d spheres | Frame: %8.3f ms | Physics: %8.3f ms", report._spheres, report._frameTime, report._physicsTime);
+			}
 			ImGui::End();
 		}
 
@@ -60,6 +266,10 @@ int main()
 			ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 			simulation.updateDisplay();
 		}
+
+		//Release per-frame memory
+		FrameArena::get().reset();
+		AllocationTracker::endFrame();
 	}
 
 	//CleanUP Stuff
@@ -5,6 +5,7 @@
 #include "IndexBuffer.hpp"
 #include "Shader.hpp"
 #include "LightPositions.hpp"
+#include "FrameArena.hpp"
 
 class Basemodel
 {
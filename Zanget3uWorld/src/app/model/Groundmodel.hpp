@@ -78,10 +78,9 @@ public:
 
 		for(int i = 0; i < numberOfPointlights; i++)
 		{
-			std::string uniformName = "lightPositions[";
-			uniformName += std::to_string(i);
-			uniformName += "]";
-			_shader->SetUniformVec3(uniformName, _lightPositions[i]);
+			FrameString uniformName(24);
+			uniformName << "lightPositions[" << i << "]";
+			_shader->SetUniformVec3(uniformName.c_str(), _lightPositions[i]);
 		}		
 		
 		_vao->bind();
@@ -1,3 +1,6 @@
+//FRAME_ALLOCATION_TRACKING in the preprocessor definitions of the project counts heap allocations per frame and warns about every frame that allocates
+
+#include "AllocationTracker.hpp"
 #include "DisplayManager.hpp"
 #include <imgui/imgui.h>
 #include <imgui/imgui_impl_glfw.h>
@@ -221,7 +224,11 @@ int main()
 			ImGui::Render();
 			ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 			displayManager.updateDisplay();
-		}		
+		}
+
+		//Release per-frame memory
+		FrameArena::get().reset();
+		AllocationTracker::endFrame();
 	}
 	
 	//CleanUP Stuff
@@ -1,12 +1,38 @@
 #version 330 core
 
 in vec2 TexCoords;
+in vec4 SpriteColor;
+flat in int TextureSlot;
 out vec4 FragColor;
 
-uniform sampler2D tex;
-uniform vec3 spriteColor;
+uniform sampler2D textures[16];
+
+//Sampler arrays only take constant indices -> one case per texture unit
+//The gradients get computed outside of the switch, neighbouring pixels can belong to sprites with different textures
+vec4 sampleSlot(int slot, vec2 uv, vec2 dx, vec2 dy)
+{
+    switch (slot)
+    {
+        case 0: return textureGrad(textures[0], uv, dx, dy);
+        case 1: return textureGrad(textures[1], uv, dx, dy);
+        case 2: return textureGrad(textures[2], uv, dx, dy);
+        case 3: return textureGrad(textures[3], uv, dx, dy);
+        case 4: return textureGrad(textures[4], uv, dx, dy);
+        case 5: return textureGrad(textures[5], uv, dx, dy);
+        case 6: return textureGrad(textures[6], uv, dx, dy);
+        case 7: return textureGrad(textures[7], uv, dx, dy);
+        case 8: return textureGrad(textures[8], uv, dx, dy);
+        case 9: return textureGrad(textures[9], uv, dx, dy);
+        case 10: return textureGrad(textures[10], uv, dx, dy);
+        case 11: return textureGrad(textures[11], uv, dx, dy);
+        case 12: return textureGrad(textures[12], uv, dx, dy);
+        case 13: return textureGrad(textures[13], uv, dx, dy);
+        case 14: return textureGrad(textures[14], uv, dx, dy);
+        default: return textureGrad(textures[15], uv, dx, dy);
+    }
+}
 
 void main()
 {
-    FragColor = vec4(spriteColor, 1.0f) * texture(tex, TexCoords);
+    FragColor = SpriteColor * sampleSlot(TextureSlot, TexCoords, dFdx(TexCoords), dFdy(TexCoords));
 }
\ No newline at end of file
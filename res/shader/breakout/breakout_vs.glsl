@@ -1,14 +1,20 @@
 #version 330 core
 
-layout(location = 0) in vec4 aPos; // <vec2 position, vec2 texCoords>
+layout(location = 0) in vec2 aPos;
+layout(location = 1) in vec2 aTexCoords;
+layout(location = 2) in vec4 aColor;
+layout(location = 3) in float aTexture;
 
 out vec2 TexCoords;
+out vec4 SpriteColor;
+flat out int TextureSlot;
 
-uniform mat4 model;
 uniform mat4 projection;
 
 void main()
 {
-    TexCoords = aPos.zw;
-    gl_Position = projection * model * vec4(aPos.xy, 0.0, 1.0);
+    TexCoords = aTexCoords;
+    SpriteColor = aColor;
+    TextureSlot = int(aTexture);
+    gl_Position = projection * vec4(aPos, 0.0, 1.0);
 }
\ No newline at end of file
@@ -1,12 +1,12 @@
 #version 330 core
 
 in vec2 TexCoords;
+in vec4 ParticleColor;
 out vec4 FragColor;
 
 uniform sampler2D tex;
-uniform vec3 particleColor;
 
 void main()
 {
-    FragColor = vec4(particleColor, 1.0f) * texture(tex, TexCoords);
+    FragColor = ParticleColor * texture(tex, TexCoords);
 }
\ No newline at end of file
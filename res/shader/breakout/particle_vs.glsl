@@ -1,14 +1,26 @@
 #version 330 core
 
-layout(location = 0) in vec4 aPos; // <vec2 position, vec2 texCoords>
+layout(location = 0) in vec2 aCorner;
+layout(location = 1) in float aPosX;
+layout(location = 2) in float aPosY;
+layout(location = 3) in float aPosZ;
+layout(location = 4) in float aSize;
+layout(location = 5) in float aRed;
+layout(location = 6) in float aGreen;
+layout(location = 7) in float aBlue;
+layout(location = 8) in float aAlpha;
 
 out vec2 TexCoords;
+out vec4 ParticleColor;
 
-uniform mat4 model;
-uniform mat4 projection;
+uniform mat4 viewProjection;
+uniform vec3 right;
+uniform vec3 up;
 
 void main()
 {
-    TexCoords = aPos.zw;
-    gl_Position = projection * model * vec4(aPos.xy, 0.0, 1.0);
+    TexCoords = aCorner + 0.5;
+    ParticleColor = vec4(aRed, aGreen, aBlue, aAlpha);
+    vec3 position = vec3(aPosX, aPosY, aPosZ) + (right * aCorner.x + up * aCorner.y) * aSize;
+    gl_Position = viewProjection * vec4(position, 1.0);
 }
\ No newline at end of file
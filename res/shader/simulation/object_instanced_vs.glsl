@@ -3,7 +3,8 @@
 layout(location = 0) in vec3 PosIn;
 layout(location = 1) in vec2 TexIn;
 layout(location = 2) in vec3 ColorIn;
-layout(location = 3) in mat4 ModelIn;
+layout(location = 3) in vec4 PositionScaleIn; //xyz = position, w = uniform scale
+layout(location = 4) in vec4 RotationIn; //Unit quaternion (x, y, z, w)
 
 out vec2 TexOut;
 out vec3 ColorOut;
@@ -11,9 +12,19 @@ out vec3 ColorOut;
 uniform mat4 view;
 uniform mat4 projection;
 
+//Rotates v by the quaternion q (cheaper than building a matrix from it)
+vec3 rotate(vec4 q, vec3 v)
+{
+    vec3 t = 2.0 * cross(q.xyz, v);
+    return v + q.w * t + cross(q.xyz, t);
+}
+
 void main()
 {
     TexOut = TexIn;
     ColorOut = ColorIn;
-    gl_Position = projection * view * ModelIn * vec4(PosIn, 1.0);
+
+    //The quaternion arrives quantized -> renormalize it
+    vec3 worldPos = PositionScaleIn.xyz + PositionScaleIn.w * rotate(normalize(RotationIn), PosIn);
+    gl_Position = projection * view * vec4(worldPos, 1.0);
 }
\ No newline at end of file
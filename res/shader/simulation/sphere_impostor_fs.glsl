@@ -0,0 +1,52 @@
+#version 440 core
+
+in vec3 QuadPos;
+flat in vec3 Center;
+flat in float Radius;
+flat in vec3 ColorOut;
+flat in vec4 Rotation;
+out vec4 FragColor;
+
+uniform sampler2D tex;
+uniform mat4 view;
+uniform mat4 projection;
+
+const float PI = 3.14159265358979;
+
+//Rotates v by the inverse of the unit quaternion q
+vec3 rotateInverse(vec4 q, vec3 v)
+{
+    vec3 t = 2.0 * cross(-q.xyz, v);
+    return v + q.w * t + cross(-q.xyz, t);
+}
+
+void main()
+{
+    //Ray from the camera through the fragment against the sphere
+    //The discriminant uses the distance of the center to the ray -> no cancellation for far spheres
+    vec3 direction = normalize(QuadPos);
+    float along = dot(direction, Center);
+    vec3 toRay = Center - direction * along;
+    float discriminant = Radius * Radius - dot(toRay, toRay);
+    if (discriminant < 0.0)
+        discard;
+
+    vec3 hit = direction * (along - sqrt(discriminant));
+    vec3 normal = (hit - Center) / Radius;
+
+    //Depth of the hit point instead of the quad
+    vec4 clip = projection * vec4(hit, 1.0);
+    gl_FragDepth = ((gl_DepthRange.diff * clip.z / clip.w) + gl_DepthRange.near + gl_DepthRange.far) * 0.5;
+
+    //Normal in the sphere's own frame -> same texture coordinates as MeshCreator::createSphere, rotating with the body
+    vec3 local = rotateInverse(Rotation, transpose(mat3(view)) * normal);
+    float u = atan(local.z, local.x) / (2.0 * PI);
+    float v = acos(clamp(local.y, -1.0, 1.0)) / PI;
+
+    //Two candidates for u, the one without the jump at the seam keeps the mipmap selection right
+    float u1 = fract(u);
+    float u2 = fract(u + 0.5) - 0.5;
+    vec2 texCoords = vec2(fwidth(u1) <= fwidth(u2) + 0.001 ? u1 : u2, v);
+
+    FragColor = vec4(ColorOut, 1.0f) * texture(tex, texCoords);
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+#version 440 core
+
+layout(location = 0) in vec2 CornerIn; //Quad corner in [-1, 1]
+layout(location = 2) in vec3 ColorIn;
+layout(location = 3) in vec4 PositionScaleIn; //xyz = center, w = radius
+layout(location = 4) in vec4 RotationIn; //Unit quaternion (x, y, z, w)
+layout(location = 5) in float MeshIn; //1 = the CPU put this sphere into the mesh buffers (SPHERE_AUTO)
+
+out vec3 QuadPos; //View space position on the quad
+flat out vec3 Center; //View space
+flat out float Radius;
+flat out vec3 ColorOut;
+flat out vec4 Rotation;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform bool skipMeshes; //Spheres with MeshIn set get drawn as meshes instead
+
+void main()
+{
+    Center = (view * vec4(PositionScaleIn.xyz, 1.0)).xyz;
+    Radius = PositionScaleIn.w;
+    ColorOut = ColorIn;
+    Rotation = normalize(RotationIn);
+
+    //Camera inside the sphere or sphere drawn as mesh -> degenerate quad, nothing gets rasterized
+    float distance2 = dot(Center, Center);
+    if (distance2 <= Radius * Radius || (skipMeshes && MeshIn > 0.5))
+    {
+        QuadPos = vec3(0.0);
+        gl_Position = vec4(0.0);
+        return;
+    }
+
+    //Quad through the center, facing the camera along the ray to the center
+    //Its half size is the radius of the silhouette cone in that plane -> the quad covers the sphere exactly, even under strong perspective
+    vec3 forward = Center / sqrt(distance2);
+    vec3 right = normalize(abs(forward.y) < 0.99 ? cross(forward, vec3(0.0, 1.0, 0.0)) : cross(forward, vec3(1.0, 0.0, 0.0)));
+    vec3 up = cross(right, forward);
+    float halfSize = Radius * sqrt(distance2 / (distance2 - Radius * Radius));
+
+    QuadPos = Center + (right * CornerIn.x + up * CornerIn.y) * halfSize;
+    gl_Position = projection * vec4(QuadPos, 1.0);
+}
\ No newline at end of file